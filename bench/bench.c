@@ -0,0 +1,386 @@
+/*
+ *  bench.c
+ *
+ *  Benchmark driver for the graph engine.
+ *  Times the basic graph operations (and command
+ *  dispatching) on generated graphs of increasing
+ *  size and density. Results are printed as CSV:
+ *
+ *      op,vertices,arches,ops,ns_per_op,ops_per_s,peak_rss_kb
+ *
+ *  Usage: bench.out [max. # of vertices]
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sys/resource.h>
+
+#include "command.h"
+#include "generate.h"
+#include "graph.h"
+#include "ingest.h"
+#include "misc.h"
+#include "random.h"
+
+#define BNC_SEED                12345u  /* Seed of every generated graph */
+#define BNC_QUERIES             200000u /* Max. # of random operations per measurement */
+#define BNC_DELETES             8u      /* # of vertex deletions per measurement */
+#define BNC_MIN_TIME            0.2     /* Min. measurement time of whole-graph operations (s) */
+#define BNC_DEF_MAX_N           16384u  /* Default max. # of vertices */
+
+
+/* Graph used by the benchmarked command */
+static graph_t *g_bench = NULL;
+
+/* Share of one thread of a concurrent measurement */
+typedef struct
+{
+    const index_t *arch;        /* Arches, pairs */
+    char *added;                /* Per pair, if it has been added (only these are deleted) */
+    size_t beg, end;            /* Its range of pairs */
+    int op;                     /* GPH_ADD, GPH_DELETE or 0 for gph_typ() */
+    ingest_t *ing;              /* If not NULL, arches are put there instead */
+
+} bnc_part_t;
+
+
+/* Gives monotonic time in seconds */
+static double _bnc_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* Gives peak resident set size in KiB */
+static long _bnc_rss(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    return ru.ru_maxrss;
+}
+
+/* Gives # of arches */
+static size_t _bnc_arches(const graph_t *graph)
+{
+    size_t n = 0u;
+    for(size_t i = 0u; i < graph->_n; ++i)
+        n += graph->_list[i]->_narch;
+
+    return n;
+}
+
+/* Prints one result line.
+ *
+ *  op          - operation name
+ *  graph       - the graph used
+ *  ops         - # of operations done
+ *  sec         - time taken
+ */
+static void _bnc_put(const char *op, const graph_t *graph, size_t ops, double sec)
+{
+    fprintf(stdout, "%s,%zu,%zu,%zu,%.1f,%.1f,%ld\n", op, graph->_n, _bnc_arches(graph), ops,
+            sec * 1e9 / (double) ops, (double) ops / sec, _bnc_rss());
+    fflush(stdout);
+}
+
+/* Benchmarked command, "arch <A> <B>" */
+static void *_bnc_command(char **argv, int argc)
+{
+    if(argc < 2)
+        return NULL;
+
+    gph_con(g_bench, (index_t) atoi(argv[0u]), (index_t) atoi(argv[1u]), GPH_ADD);
+    return NULL;
+}
+
+/* Concurrent measurement, thread routine */
+static void *_bnc_part(void *arg)
+{
+    const bnc_part_t *p = (const bnc_part_t *) arg;
+    volatile int sink = 0;
+
+    /* Ingestion, a producer per thread */
+    if(p->ing)
+    {
+        producer_t prod;
+        ing_prd(p->ing, &prod);
+
+        for(size_t i = p->beg; i < p->end; ++i)
+            sink += ing_put(&prod, p->arch[2u * i], p->arch[2u * i + 1u]);
+
+        ing_flu(&prod);
+        return NULL;
+    }
+
+    for(size_t i = p->beg; i < p->end; ++i)
+    {
+        if(p->op == GPH_ADD)
+            p->added[i] = (char) (gph_con(g_bench, p->arch[2u * i], p->arch[2u * i + 1u], GPH_ADD) == 1u);
+        else if(p->op == GPH_DELETE && p->added[i])
+            gph_con(g_bench, p->arch[2u * i], p->arch[2u * i + 1u], GPH_DELETE);
+        else if(p->op == 0)
+            sink += gph_typ(g_bench, p->arch[2u * i], p->arch[2u * i + 1u]);
+    }
+
+    (void) sink;
+    return NULL;
+}
+
+/* Runs gph_con()/gph_typ() on the arches from msc_cpu() threads at once.
+ *
+ *  arch        - arches, pairs
+ *  added       - per pair, if it has been added (set by GPH_ADD, used by GPH_DELETE)
+ *  n           - # of pairs
+ *  op          - GPH_ADD, GPH_DELETE or 0 for gph_typ()
+ *  ing         - if not NULL, arches are put there instead
+ *
+ * Returns time taken or -1.0 if failed.
+ */
+static double _bnc_par(const index_t *arch, char *added, size_t n, int op, ingest_t *ing)
+{
+    pthread_t threads[GLO_MAX_THREADS];
+    bnc_part_t parts[GLO_MAX_THREADS];
+    const size_t nthr = msc_cpu();
+
+    const double t0 = _bnc_now();
+    for(size_t t = 0u; t < nthr; ++t)
+    {
+        parts[t].arch = arch;
+        parts[t].added = added;
+        parts[t].beg = n * t / nthr;
+        parts[t].end = n * (t + 1u) / nthr;
+        parts[t].op = op;
+        parts[t].ing = ing;
+
+        if(pthread_create(&threads[t], NULL, _bnc_part, &parts[t]) != 0)
+            return -1.0;
+    }
+
+    for(size_t t = 0u; t < nthr; ++t)
+        pthread_join(threads[t], NULL);
+
+    return _bnc_now() - t0;
+}
+
+/* Runs all the measurements on one graph size.
+ *
+ *  n           - # of vertices
+ *  deg         - mean degree
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _bnc_run(size_t n, size_t deg)
+{
+    rnd_t rnd;
+    rnd_ini(&rnd, BNC_SEED + n + deg);
+
+    /* gph_add */
+    {
+        graph_t *g = NULL;
+        if((g = gph_new(GLO_DEF_GRAPH_SIZE)) == NULL)
+            return -1;
+
+        const double t0 = _bnc_now();
+        for(size_t i = 0u; i < n; ++i)
+        {
+            if(gph_add(g, NULL) != 1u)
+                return -1;
+        }
+        _bnc_put("gph_add", g, n, _bnc_now() - t0);
+
+        gph_fre(g);
+    }
+
+    if((g_bench = gen_erd(n, (double) deg / (double) (n - 1u), BNC_SEED)) == NULL)
+        return -1;
+
+    /* gph_con (add, then delete only the added arches) */
+    /* Half of the graph size, so the density stays roughly the same */
+    {
+        const size_t nq = (n * deg / 2u < BNC_QUERIES) ? n * deg / 2u : BNC_QUERIES;
+        index_t *arch = NULL;
+        char *added = NULL;
+
+        if((arch = (index_t *) malloc(sizeof(index_t) * 2u * nq)) == NULL ||
+           (added = (char *) malloc(nq)) == NULL)
+        {
+            free(arch);
+            return -1;
+        }
+
+        for(size_t i = 0u; i < 2u * nq; ++i)
+            arch[i] = (index_t) rnd_bnd(&rnd, (uint32_t) n);
+
+        double t0 = _bnc_now();
+        for(size_t i = 0u; i < nq; ++i)
+        {
+            const size_t r = gph_con(g_bench, arch[2u * i], arch[2u * i + 1u], GPH_ADD);
+            if(r == (size_t) -1)
+                return -1;
+
+            added[i] = (char) r;
+        }
+        _bnc_put("gph_con_add", g_bench, nq, _bnc_now() - t0);
+
+        /* gph_typ */
+        volatile int sink = 0;
+        t0 = _bnc_now();
+        for(size_t i = 0u; i < nq; ++i)
+            sink += gph_typ(g_bench, arch[2u * i], arch[2u * i + 1u]);
+        _bnc_put("gph_typ", g_bench, nq, _bnc_now() - t0);
+        (void) sink;
+
+        /* Added arches are deleted in the reverse order */
+        t0 = _bnc_now();
+        for(size_t i = nq; i > 0u; --i)
+        {
+            if(added[i - 1u])
+                gph_con(g_bench, arch[2u * (i - 1u)], arch[2u * (i - 1u) + 1u], GPH_DELETE);
+        }
+        _bnc_put("gph_con_del", g_bench, nq, _bnc_now() - t0);
+
+        /* The same in concurrent mode, from all the CPUs */
+        if(gph_syn(g_bench, 1) != 0)
+            return -1;
+
+        double sec = 0.0;
+        if((sec = _bnc_par(arch, added, nq, GPH_ADD, NULL)) < 0.0)
+            return -1;
+        _bnc_put("gph_con_add_mt", g_bench, nq, sec);
+
+        if((sec = _bnc_par(arch, added, nq, 0, NULL)) < 0.0)
+            return -1;
+        _bnc_put("gph_typ_mt", g_bench, nq, sec);
+
+        if((sec = _bnc_par(arch, added, nq, GPH_DELETE, NULL)) < 0.0)
+            return -1;
+        _bnc_put("gph_con_del_mt", g_bench, nq, sec);
+
+        gph_syn(g_bench, 0);
+
+        /* The same arches ingested into a copy (put from all the CPUs, then merged) */
+        graph_t *copy = NULL;
+        ingest_t *ing = NULL;
+        if((copy = gph_cpy(g_bench)) == NULL || (ing = ing_new(copy)) == NULL)
+            return -1;
+
+        if((sec = _bnc_par(arch, NULL, nq, 0, ing)) < 0.0)
+            return -1;
+        _bnc_put("ing_put_mt", copy, nq, sec);
+
+        t0 = _bnc_now();
+        if(ing_mrg(ing) == (size_t) -1)
+            return -1;
+        _bnc_put("ing_mrg", copy, nq, _bnc_now() - t0);
+
+        ing_fre(ing);
+        gph_fre(copy);
+
+        /* cmd_run (tokenizing and dispatching included), the same arches again */
+        char line[GLO_MAX_USER_INPUT] = {0, };
+        t0 = _bnc_now();
+        for(size_t i = 0u; i < nq; ++i)
+        {
+            snprintf(line, GLO_MAX_USER_INPUT - 1u, "barch %hu %hu", arch[2u * i], arch[2u * i + 1u]);
+            if(cmd_run(line, 0) != CMD_RET_SUCCESS)
+                return -1;
+        }
+        _bnc_put("cmd_run", g_bench, nq, _bnc_now() - t0);
+
+        for(size_t i = nq; i > 0u; --i)
+        {
+            if(added[i - 1u])
+                gph_con(g_bench, arch[2u * (i - 1u)], arch[2u * (i - 1u) + 1u], GPH_DELETE);
+        }
+
+        free(arch);
+        free(added);
+    }
+
+    /* gph_cnt (repeated until measurable) */
+    {
+        size_t ops = 0u, s = 0u, d = 0u, iso = 0u;
+        const double t0 = _bnc_now();
+        do
+        {
+            gph_cnt(g_bench, &s, &d, &iso);
+            ++ops;
+
+        } while(_bnc_now() - t0 < BNC_MIN_TIME);
+        _bnc_put("gph_cnt", g_bench, ops, _bnc_now() - t0);
+    }
+
+    /* gph_out (to /dev/null) */
+    {
+        FILE *null = NULL;
+        if((null = fopen("/dev/null", "w")) == NULL)
+            return -1;
+
+        size_t ops = 0u;
+        const double t0 = _bnc_now();
+        do
+        {
+            gph_out(g_bench, null, GPH_SET_SORT_ASC);
+            ++ops;
+
+        } while(_bnc_now() - t0 < BNC_MIN_TIME);
+        _bnc_put("gph_out", g_bench, ops, _bnc_now() - t0);
+
+        fclose(null);
+    }
+
+    /* gph_del (destructive, so the last one) */
+    {
+        const double t0 = _bnc_now();
+        for(size_t i = 0u; i < BNC_DELETES; ++i)
+        {
+            if(gph_del(g_bench, (index_t) rnd_bnd(&rnd, (uint32_t) g_bench->_n)) == (size_t) -1)
+                return -1;
+        }
+        _bnc_put("gph_del", g_bench, BNC_DELETES, _bnc_now() - t0);
+    }
+
+    gph_fre(g_bench);
+    g_bench = NULL;
+
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_n = BNC_DEF_MAX_N;
+    if(argc > 1 && (sscanf(argv[1], "%zu", &max_n) < 1 || max_n < 16u || max_n > GEN_MAX_VERTICES))
+    {
+        fprintf(stderr, "Usage: %s [max. # of vertices, 16 - %u]\n", argv[0], GEN_MAX_VERTICES);
+        return EXIT_FAILURE;
+    }
+
+    cmd_add("barch", _bnc_command);
+
+    fprintf(stdout, "op,vertices,arches,ops,ns_per_op,ops_per_s,peak_rss_kb\n");
+
+    /* Sparse and dense graphs of increasing size */
+    const size_t degs[] = {4u, 32u};
+    for(size_t n = 256u; n <= max_n; n *= 4u)
+    {
+        for(size_t i = 0u; i < sizeof(degs) / sizeof(degs[0u]); ++i)
+        {
+            if(_bnc_run(n, degs[i]) != 0)
+            {
+                fprintf(stderr, "Critical memory error. Closing...\n");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
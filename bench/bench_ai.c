@@ -0,0 +1,251 @@
+/*
+ *  bench_ai.c
+ *
+ *  Benchmark of the AI client (ai.c and http.c) against
+ *  the local mock server (mock_ollama.out, started here
+ *  for every case), so the cost of the client itself
+ *  is measured independent of the model speed: request
+ *  overhead, streaming and parsing. Results are printed
+ *  as CSV:
+ *
+ *      case,requests,bytes,commands,ns_per_req,req_per_s,mb_per_s,peak_rss_kb
+ *
+ *  bytes is the length of one answer, commands - # of
+ *  commands handed out per answer (streamed cases only),
+ *  mb_per_s - answer bytes per second.
+ *
+ *  Usage: bench_ai.out [# of requests per case]
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "ai.h"
+
+#define BNC_PORT                18434   /* Port of the mock server */
+#define BNC_DEF_REQUESTS        200u    /* Default # of requests per case */
+#define BNC_START_TIME          5.0     /* Max. time the server may take to start (s) */
+#define BNC_MAX_PATH            1024u
+
+
+/* One measured case */
+typedef struct
+{
+    const char *name;
+    const char *args;           /* Server settings (see mock_ollama.c) */
+    int stream;
+    unsigned div;               /* The case does 1/div of the requests */
+
+} bnc_case_t;
+
+static const bnc_case_t g_cases[] =
+{
+    /* Request overhead, the answer is a single token */
+    {"overhead",        "-n 1 -s 64",           0, 1u},
+    {"overhead_stream", "-n 1 -s 64",           1, 1u},
+    /* Parsing, about 11 KiB of answer */
+    {"stream_tokens",   "-n 256 -s 4",          1, 4u},
+    {"stream_split",    "-n 256 -s 4 -c 7",     1, 8u},
+    {"whole_large",     "-n 16384",             0, 8u},
+    /* Model latency, should be all of the time */
+    {"latency_20ms",    "-n 1 -s 64 -l 20",     0, 10u},
+};
+
+
+/* Gives monotonic time in seconds */
+static double _bnc_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* Gives peak resident set size in KiB */
+static long _bnc_rss(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    return ru.ru_maxrss;
+}
+
+/* Counts handed out commands */
+static void _bnc_command(const char *command, void *arg)
+{
+    (void) command;
+    ++*(size_t *) arg;
+}
+
+/* Checks if the server accepts connections */
+static int _bnc_ready(void)
+{
+    const int sd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(BNC_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const int ret = (sd >= 0 && connect(sd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    if(sd >= 0)
+        close(sd);
+
+    return ret;
+}
+
+/* Starts the mock server.
+ *
+ *  path        - server executable
+ *  args        - its settings
+ *
+ * Returns its pid or -1 if failed.
+ */
+static pid_t _bnc_start(const char *path, const char *args)
+{
+    char line[256], port[16];
+    char *argv[32];
+    int argc = 0;
+
+    snprintf(port, sizeof(port), "%d", BNC_PORT);
+    snprintf(line, sizeof(line), "%s", args);
+    argv[argc++] = (char *) path;
+    argv[argc++] = "-q";
+    argv[argc++] = "-p";
+    argv[argc++] = port;
+    for(char *arg = strtok(line, " "); arg != NULL && argc < 31; arg = strtok(NULL, " "))
+        argv[argc++] = arg;
+    argv[argc] = NULL;
+
+    const pid_t pid = fork();
+    if(pid == 0)
+    {
+        execv(path, argv);
+        perror(path);
+        _exit(EXIT_FAILURE);
+    }
+    if(pid < 0)
+        return -1;
+
+    const double t0 = _bnc_now();
+    while(!_bnc_ready())
+    {
+        if(_bnc_now() - t0 > BNC_START_TIME || waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return -1;
+        }
+        usleep(10000);
+    }
+
+    return pid;
+}
+
+/* Runs one case.
+ *
+ *  path        - server executable
+ *  bc          - the case
+ *  requests    - # of requests
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _bnc_run(const char *path, const bnc_case_t *bc, size_t requests)
+{
+    const pid_t pid = _bnc_start(path, bc->args);
+    if(pid < 0)
+    {
+        fprintf(stderr, "The mock server (%s) could not be started.\n", path);
+        return -1;
+    }
+
+    ai_data *data = create_ai_data();
+    int ret = -1;
+    if(data == NULL || (data->prompt = strdup("make a path of 3 vertices")) == NULL)
+        goto done;
+
+    size_t bytes = 0u, commands = 0u;
+    const double t0 = _bnc_now();
+    for(size_t i = 0u; i < requests; ++i)
+    {
+        commands = 0u;
+        if(bc->stream)
+            speak_to_ollama_stream(data, _bnc_command, &commands);
+        else
+            speak_to_ollama(data);
+
+        if(data->response == NULL)
+            goto done;
+
+        bytes = bc->stream ? 0u : strlen(data->response);
+    }
+    const double sec = _bnc_now() - t0;
+
+    /* Streamed answers are not kept, so they are asked for once more */
+    if(bc->stream)
+    {
+        speak_to_ollama(data);
+        if(data->response == NULL)
+            goto done;
+        bytes = strlen(data->response);
+    }
+
+    fprintf(stdout, "%s,%zu,%zu,%zu,%.1f,%.1f,%.2f,%ld\n", bc->name, requests, bytes, commands,
+            sec * 1e9 / (double) requests, (double) requests / sec,
+            (double) (bytes * requests) / sec / 1e6, _bnc_rss());
+    fflush(stdout);
+    ret = 0;
+
+done:
+    if(data != NULL)
+        destroy_ai_data(data);
+    http_pool_close();
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+
+    return ret;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t requests = BNC_DEF_REQUESTS;
+    if(argc > 1 && (sscanf(argv[1], "%zu", &requests) < 1 || requests < 10u))
+    {
+        fprintf(stderr, "Usage: %s [# of requests per case, at least 10]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* The server is next to this executable */
+    char path[BNC_MAX_PATH];
+    const char *slash = strrchr(argv[0], '/');
+    snprintf(path, sizeof(path), "%.*smock_ollama.out", slash ? (int) (slash - argv[0] + 1) : 0, argv[0]);
+
+    char host[32];
+    snprintf(host, sizeof(host), "127.0.0.1:%d", BNC_PORT);
+    setenv("OLLAMA_HOST", host, 1);
+
+    fprintf(stdout, "case,requests,bytes,commands,ns_per_req,req_per_s,mb_per_s,peak_rss_kb\n");
+
+    for(size_t i = 0u; i < sizeof(g_cases) / sizeof(g_cases[0u]); ++i)
+    {
+        const size_t n = requests / g_cases[i].div;
+        if(_bnc_run(path, &g_cases[i], n ? n : 1u) != 0)
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
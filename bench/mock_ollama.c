@@ -0,0 +1,492 @@
+/*
+ *  mock_ollama.c
+ *
+ *  Local stand-in for the Ollama server, so the AI
+ *  client can be tried and measured without a model.
+ *  Speaks enough of the /api/generate protocol:
+ *  streamed (chunked, one JSON object per line) and
+ *  non-streamed answers, keep-alive connections and
+ *  "GET /" for the installation check. The answer is
+ *  always the same list of commands, cut into tokens.
+ *
+ *  Usage: mock_ollama.out [-p port] [-l latency ms] [-d token delay us]
+ *                         [-c max. bytes per write] [-n repeats]
+ *                         [-s token size] [-r answer] [-q]
+ *
+ *  Point the program at it with OLLAMA_HOST=127.0.0.1:<port>.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "json.h"
+
+#define MCK_DEF_PORT            11435   /* Default port (next to the real one) */
+#define MCK_DEF_ANSWER          "size 3 -f\narch add 0 1\narch add 1 2\nlist\n"
+#define MCK_DEF_TOKEN           4u      /* Default # of answer bytes per token */
+#define MCK_MAX_HEAD            16384u  /* Max. size of request headers */
+#define MCK_MAX_BODY            (64u << 20) /* Max. size of a request body */
+#define MCK_MAX_MODEL           64u     /* Max. length of a model name */
+
+
+/* Server settings */
+typedef struct
+{
+    int port;
+    int latency;                /* Delay before the answer (ms) */
+    int delay;                  /* Delay between streamed tokens (us) */
+    size_t write;               /* Max. # of bytes per write, 0 - no limit */
+    size_t repeats;             /* # of times the answer is repeated */
+    size_t token;               /* # of answer bytes per token */
+    const char *answer;
+    int quiet;
+
+} mck_set_t;
+
+/* Parsed request */
+typedef struct
+{
+    char key[16];               /* Last top-level key */
+    char model[MCK_MAX_MODEL];
+    int stream;
+    size_t prompt;              /* Length of the prompt */
+
+} mck_req_t;
+
+
+static mck_set_t g_set;
+static char *g_answer = NULL;   /* Answer repeated, as sent */
+static size_t g_answer_len = 0u;
+static unsigned long g_requests = 0u;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Sleeps for the given # of microseconds */
+static void _mck_sleep(long us)
+{
+    if(us <= 0)
+        return;
+
+    struct timespec ts = {us / 1000000l, (us % 1000000l) * 1000l};
+    while(nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+/* Sends all the data, at most g_set.write bytes per call.
+ *
+ *  sd          - socket
+ *  data        - data to send
+ *  len         - its length
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _mck_send(int sd, const char *data, size_t len)
+{
+    while(len > 0u)
+    {
+        const size_t part = (g_set.write && g_set.write < len) ? g_set.write : len;
+        const ssize_t sent = send(sd, data, part, MSG_NOSIGNAL);
+        if(sent < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        data += sent;
+        len -= (size_t) sent;
+    }
+
+    return 0;
+}
+
+/* Sends a complete response with a body of known length */
+static int _mck_reply(int sd, int code, const char *type, const char *body, size_t len)
+{
+    char head[256];
+    const int head_len = snprintf(head, sizeof(head),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "\r\n", code, code == 200 ? "OK" : code == 404 ? "Not Found" : "Bad Request", type, len);
+
+    if(_mck_send(sd, head, (size_t) head_len) != 0)
+        return -1;
+
+    return _mck_send(sd, body, len);
+}
+
+/* Sends one chunk of a chunked response */
+static int _mck_chunk(int sd, const char *data, size_t len)
+{
+    struct json_writer w;
+    json_writer_init(&w);
+    json_write_format(&w, "%zx\r\n", len);
+    json_write(&w, data, len);
+    json_write_raw(&w, "\r\n");
+
+    const int ret = w.error ? -1 : _mck_send(sd, w.buf, w.length);
+    json_writer_free(&w);
+
+    return ret;
+}
+
+/* Collects the parts of the request the answer depends on */
+static int _mck_event(void *arg, enum json_event event, const char *value, size_t length, int depth)
+{
+    mck_req_t *req = (mck_req_t *) arg;
+
+    if(depth != 1)
+        return 0;
+
+    if(event == JSON_KEY)
+    {
+        const size_t n = (length < sizeof(req->key) - 1u) ? length : sizeof(req->key) - 1u;
+        memcpy(req->key, value, n);
+        req->key[n] = '\0';
+    }
+    else if(!strcmp(req->key, "stream") && (event == JSON_TRUE || event == JSON_FALSE))
+    {
+        req->stream = (event == JSON_TRUE);
+    }
+    else if(event == JSON_STRING && !strcmp(req->key, "model"))
+    {
+        const size_t n = (length < MCK_MAX_MODEL - 1u) ? length : MCK_MAX_MODEL - 1u;
+        memcpy(req->model, value, n);
+        req->model[n] = '\0';
+    }
+    else if(event == JSON_STRING && !strcmp(req->key, "prompt"))
+    {
+        req->prompt = length;
+    }
+
+    return 0;
+}
+
+/* Answers one /api/generate request.
+ *
+ *  sd          - socket
+ *  body        - request body
+ *  len         - its length
+ *
+ * Returns 0 or -1 if the connection has to be closed.
+ */
+static int _mck_generate(int sd, const char *body, size_t len)
+{
+    mck_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.stream = 1;             /* Ollama streams unless told not to */
+    strcpy(req.model, "mistral");
+
+    struct json_parser parser;
+    json_init(&parser, _mck_event, &req);
+    json_feed(&parser, body, len);
+    const int bad = parser.error;
+    json_free(&parser);
+
+    if(bad)
+    {
+        static const char err[] = "{\"error\":\"invalid request body\"}";
+        return _mck_reply(sd, 400, "application/json", err, sizeof(err) - 1u);
+    }
+
+    pthread_mutex_lock(&g_lock);
+    const unsigned long id = ++g_requests;
+    pthread_mutex_unlock(&g_lock);
+
+    if(!g_set.quiet)
+        fprintf(stderr, "#%lu %s, %s, prompt of %zu bytes\n", id, req.model,
+                req.stream ? "streamed" : "whole", req.prompt);
+
+    _mck_sleep(g_set.latency * 1000l);
+
+    struct json_writer w;
+    json_writer_init(&w);
+    int ret = 0;
+
+    if(!req.stream)
+    {
+        json_write_raw(&w, "{\"model\":");
+        json_write_string(&w, req.model);
+        json_write_raw(&w, ",\"created_at\":\"2024-01-01T00:00:00Z\",\"response\":");
+        json_write_string(&w, g_answer);
+        json_write_format(&w, ",\"done\":true,\"context\":[%lu,%lu,%lu]}", id, id + 1u, id + 2u);
+
+        ret = w.error ? -1 : _mck_reply(sd, 200, "application/json", w.buf, w.length);
+        json_writer_free(&w);
+
+        return ret;
+    }
+
+    static const char head[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/x-ndjson\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n";
+    if(_mck_send(sd, head, sizeof(head) - 1u) != 0)
+    {
+        json_writer_free(&w);
+        return -1;
+    }
+
+    /* One line (and one chunk) per token, as the model generates them */
+    char token[256];
+    for(size_t at = 0u; at < g_answer_len && ret == 0; at += g_set.token)
+    {
+        const size_t n = (g_answer_len - at < g_set.token) ? g_answer_len - at : g_set.token;
+        memcpy(token, g_answer + at, n);
+        token[n] = '\0';
+
+        w.length = 0u;
+        json_write_raw(&w, "{\"model\":");
+        json_write_string(&w, req.model);
+        json_write_raw(&w, ",\"created_at\":\"2024-01-01T00:00:00Z\",\"response\":");
+        json_write_string(&w, token);
+        json_write_raw(&w, ",\"done\":false}\n");
+
+        ret = w.error ? -1 : _mck_chunk(sd, w.buf, w.length);
+        _mck_sleep(g_set.delay);
+    }
+
+    if(ret == 0)
+    {
+        w.length = 0u;
+        json_write_raw(&w, "{\"model\":");
+        json_write_string(&w, req.model);
+        json_write_format(&w, ",\"created_at\":\"2024-01-01T00:00:00Z\",\"response\":\"\","
+                          "\"done\":true,\"context\":[%lu,%lu,%lu]}\n", id, id + 1u, id + 2u);
+        ret = (w.error || _mck_chunk(sd, w.buf, w.length) != 0 || _mck_chunk(sd, "", 0u) != 0) ? -1 : 0;
+    }
+
+    json_writer_free(&w);
+
+    return ret;
+}
+
+/* Finds a header value in the request head (NUL-terminated).
+ *
+ *  head        - request head
+ *  name        - header name
+ *
+ * Returns the value (up to the end of the line) or NULL if missing.
+ */
+static const char *_mck_header(const char *head, const char *name)
+{
+    const size_t n = strlen(name);
+    for(const char *line = strstr(head, "\r\n"); line != NULL; line = strstr(line, "\r\n"))
+    {
+        line += 2;
+        if(!strncasecmp(line, name, n) && line[n] == ':')
+        {
+            line += n + 1u;
+            while(*line == ' ')
+                ++line;
+            return line;
+        }
+    }
+
+    return NULL;
+}
+
+/* Serves one connection until it is closed */
+static void *_mck_serve(void *arg)
+{
+    const int sd = (int) (intptr_t) arg;
+    size_t size = MCK_MAX_HEAD, len = 0u;
+    char *buf = (char *) malloc(size + 1u);
+
+    const int one = 1;
+    setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    while(buf != NULL)
+    {
+        /* Request head */
+        char *end = NULL;
+        buf[len] = '\0';
+        while((end = strstr(buf, "\r\n\r\n")) == NULL)
+        {
+            if(len >= MCK_MAX_HEAD)
+                goto done;
+
+            const ssize_t got = recv(sd, buf + len, MCK_MAX_HEAD - len, 0);
+            if(got <= 0)
+                goto done;
+
+            len += (size_t) got;
+            buf[len] = '\0';
+        }
+
+        *end = '\0';
+        const size_t head_len = (size_t) (end - buf) + 4u;
+        const char *value = _mck_header(buf, "Content-Length");
+        const size_t body_len = value ? strtoul(value, NULL, 10) : 0u;
+        value = _mck_header(buf, "Connection");
+        const int close_after = (value != NULL && !strncasecmp(value, "close", 5u));
+
+        if(body_len > MCK_MAX_BODY)
+            goto done;
+
+        /* Request body */
+        if(head_len + body_len > size)
+        {
+            char *grown = (char *) realloc(buf, head_len + body_len + 1u);
+            if(grown == NULL)
+                goto done;
+
+            buf = grown;
+            size = head_len + body_len;
+        }
+        while(len < head_len + body_len)
+        {
+            const ssize_t got = recv(sd, buf + len, size - len, 0);
+            if(got <= 0)
+                goto done;
+
+            len += (size_t) got;
+        }
+
+        int ret = 0;
+        if(!strncmp(buf, "POST /api/generate ", 19u))
+        {
+            ret = _mck_generate(sd, buf + head_len, body_len);
+        }
+        else if(!strncmp(buf, "GET / ", 6u))
+        {
+            static const char running[] = "Ollama is running";
+            ret = _mck_reply(sd, 200, "text/plain; charset=utf-8", running, sizeof(running) - 1u);
+        }
+        else
+        {
+            static const char missing[] = "404 page not found";
+            ret = _mck_reply(sd, 404, "text/plain", missing, sizeof(missing) - 1u);
+        }
+
+        if(ret != 0 || close_after)
+            break;
+
+        /* Whatever follows belongs to the next request */
+        len -= head_len + body_len;
+        memmove(buf, buf + head_len + body_len, len);
+    }
+
+done:
+    free(buf);
+    close(sd);
+
+    return NULL;
+}
+
+/* Repeats the answer, so its length can be chosen */
+static int _mck_answer(void)
+{
+    const size_t n = strlen(g_set.answer);
+    if((g_answer = (char *) malloc(n * g_set.repeats + 1u)) == NULL)
+        return -1;
+
+    for(size_t i = 0u; i < g_set.repeats; ++i)
+        memcpy(g_answer + i * n, g_set.answer, n);
+
+    g_answer_len = n * g_set.repeats;
+    g_answer[g_answer_len] = '\0';
+
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    g_set.port = MCK_DEF_PORT;
+    g_set.repeats = 1u;
+    g_set.token = MCK_DEF_TOKEN;
+    g_set.answer = MCK_DEF_ANSWER;
+
+    int opt;
+    while((opt = getopt(argc, argv, "p:l:d:c:n:s:r:q")) != -1)
+    {
+        switch(opt)
+        {
+            case 'p': g_set.port = atoi(optarg); break;
+            case 'l': g_set.latency = atoi(optarg); break;
+            case 'd': g_set.delay = atoi(optarg); break;
+            case 'c': g_set.write = strtoul(optarg, NULL, 10); break;
+            case 'n': g_set.repeats = strtoul(optarg, NULL, 10); break;
+            case 's': g_set.token = strtoul(optarg, NULL, 10); break;
+            case 'r': g_set.answer = optarg; break;
+            case 'q': g_set.quiet = 1; break;
+            default:
+                fprintf(stderr, "Usage: %s [-p port] [-l latency ms] [-d token delay us] "
+                        "[-c max. bytes per write] [-n repeats] [-s token size] [-r answer] [-q]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if(g_set.port <= 0 || g_set.port > 65535 || g_set.repeats == 0u ||
+       g_set.token == 0u || g_set.token > 255u)
+    {
+        fprintf(stderr, "Invalid settings.\n");
+        return EXIT_FAILURE;
+    }
+
+    if(_mck_answer() != 0)
+    {
+        fprintf(stderr, "Critical memory error. Closing...\n");
+        return EXIT_FAILURE;
+    }
+
+    const int ld = socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) g_set.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(ld < 0 || setsockopt(ld, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+       bind(ld, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(ld, 64) != 0)
+    {
+        perror("mock_ollama");
+        return EXIT_FAILURE;
+    }
+
+    if(!g_set.quiet)
+        fprintf(stderr, "Listening on 127.0.0.1:%d, answer of %zu bytes in %zu-byte tokens.\n",
+                g_set.port, g_answer_len, g_set.token);
+
+    for(;;)
+    {
+        const int sd = accept(ld, NULL, NULL);
+        if(sd < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
+            break;
+        }
+
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, _mck_serve, (void *) (intptr_t) sd) != 0)
+        {
+            close(sd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    close(ld);
+    free(g_answer);
+
+    return EXIT_FAILURE;
+}
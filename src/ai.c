@@ -1,144 +1,602 @@
 #include "ai.h"
 
 // AI settings
-static const char* const ollama_ip = "127.0.0.1:11434";
+#define AI_DEFAULT_HOST "127.0.0.1"
+#define AI_DEFAULT_PORT "11434"
+static char ollama_ip[256];
+static pthread_once_t ollama_ip_once = PTHREAD_ONCE_INIT;
 static char* model_name = "mistral";
 static bool was_model_name_malloced = FALSE;
-static const char* const prompt_header = "Convert following user input to commands (do not shorten your output), if it is a question then your list of commands should provide an answer for it:\\n";
+static const char* const prompt_header = "Convert following user input to commands (do not shorten your output), if it is a question then your list of commands should provide an answer for it:\n";
+// ai -j: the model answers with edits as JSON (constrained by the schema below) instead of commands
+static const char* const structured_header = "Convert following user input to graph edits instead of commands. \
+Answer ONLY with a JSON object {\"edits\": [...]}, edits are applied in order and each one is one of:\n\
+{\"op\": \"new\"} - clears the graph\n\
+{\"op\": \"size\", \"n\": N} - resizes the graph to N vertices\n\
+{\"op\": \"add\", \"arches\": [A, B]} - adds new vertex with arches to A and B\n\
+{\"op\": \"set\", \"vertex\": A, \"arches\": [B, C]} - vertex A then has arches to B and C only\n\
+{\"op\": \"del\", \"vertices\": [A]} - deletes vertex A\n\
+{\"op\": \"arch_add\", \"from\": A, \"to\": B} - adds arch from A to B\n\
+{\"op\": \"arch_del\", \"from\": A, \"to\": B} - deletes arch from A to B\n\
+User input:\n";
+static const char* const structured_format = "{\"type\":\"object\",\"properties\":{\"edits\":{\"type\":\"array\",\"items\":{\"type\":\"object\",\
+\"properties\":{\"op\":{\"type\":\"string\",\"enum\":[\"new\",\"size\",\"add\",\"set\",\"del\",\"arch_add\",\"arch_del\"]},\
+\"n\":{\"type\":\"integer\"},\"vertex\":{\"type\":\"integer\"},\"from\":{\"type\":\"integer\"},\"to\":{\"type\":\"integer\"},\
+\"arches\":{\"type\":\"array\",\"items\":{\"type\":\"integer\"}},\"vertices\":{\"type\":\"array\",\"items\":{\"type\":\"integer\"}}},\
+\"required\":[\"op\"]}}},\"required\":[\"edits\"]}";
 static const char* const default_system_prompt = "\
 You are command writer from graph generating software. \
 You translate user input into strings of graph manipulation commands. \
-Your answers are ONLY made out of full valid commands. DO NOT shorten your output.\\n\
+Your answers are ONLY made out of full valid commands. DO NOT shorten your output.\n\
 Some commands take input arguments - arguments are highlited with <> brackets and are explained \
-in command description (always remember about appropriate arguments).\\n\
-NEVER try to make up any commands and NEVER respond with command that are not on the list below.\\n\
-Below is list of valid commands with their descriptions:\\n\
-exit - exits the program. This command takes no arguments.\\n\
-help - displays help information. This command takes no arguments.\\n\
-cls - clears the screen. This command takes no arguments.\\n\
-tell - prints out graph's size and number of arches and vertices. This command takes no arguments.\\n\
-list - prints the graph. This command takes no arguments.\\n\
-del <A> - deletes <A> vertex, where <A> argument is an index of deleted vertex.\\n\
-file <name> - saves graph to file, where <name> argument is file name.\\n\
-new - clears graph and ERASES all arches and vertices. This command takes no arguments.\\n\
+in command description (always remember about appropriate arguments).\n\
+NEVER try to make up any commands and NEVER respond with command that are not on the list below.\n\
+Below is list of valid commands with their descriptions:\n\
+exit - exits the program. This command takes no arguments.\n\
+help - displays help information. This command takes no arguments.\n\
+cls - clears the screen. This command takes no arguments.\n\
+tell - prints out graph's size and number of arches and vertices. This command takes no arguments.\n\
+list - prints the graph. This command takes no arguments.\n\
+del <A> - deletes <A> vertex, where <A> argument is an index of deleted vertex.\n\
+file <name> - saves graph to file, where <name> argument is file name.\n\
+new - clears graph and ERASES all arches and vertices. This command takes no arguments.\n\
 find <A> <B> - Checks if arch from vertex <A> to vertex <B> exists. <A> and <B> arguments are \
-indexes of vertices to search for.\\n\
-size <n> - sets graph size to <n>, where <n> argument is positive new number of vertices.\\n\
+indexes of vertices to search for.\n\
+size <n> - sets graph size to <n>, where <n> argument is positive new number of vertices.\n\
 add <A> <B> <C> - adds NEW VERTEX to the graph with connections to vertices <A> <B> <C>, \
 where <A> <B> <C> arguments are indexes of vertices to which new vertex is connected, \
 Number of arguments of this command depends on number of connections user wants, \
-so it can range from 0 if new vertex should not have any connections to as many as user specifies. Arguments for this command DO NOT contain index of newly added vertex, DO NOT add it to argument list.\\n\
+so it can range from 0 if new vertex should not have any connections to as many as user specifies. Arguments for this command DO NOT contain index of newly added vertex, DO NOT add it to argument list.\n\
 set <A>: <B> <C> <D> - updates and modifies connections of vertex <A>, so it is only connected to vertexes <B> <C> <D>. \
 <A> <B> <C> <D> arguments are indexes of vertices which should have connection to vertex <A>. \
 Number of arguments of this command depends on user input. \
 <A> argument MUST be specified, but <B> <C> <D> depend only on number of specified vertices, \
-so it can range from 0 to as much vertices user specifies.\\n\
+so it can range from 0 to as much vertices user specifies.\n\
 arch add <A> <B> - adds new CONNECTION/ARCH between existing vertices <A> and <B>. \
-Arguments <A> and <B> are indexes of existing vertices between which arch is ADDED.\\n\
+Arguments <A> and <B> are indexes of existing vertices between which arch is ADDED.\n\
 arch del <A> <B> - DELETES CONNECTION/ARCH between existing vertices <A> and <B>. \
-Arguments <A> and <B> are indexes of existing vertices between which arch is DELETED.\\n\
-Indexes of vertices are numbers.\\n\
-Your output can ONLY contain these commands, do NOT include ANTYHING else.\\n\
+Arguments <A> and <B> are indexes of existing vertices between which arch is DELETED.\n\
+Indexes of vertices are numbers.\n\
+Your output can ONLY contain these commands, do NOT include ANTYHING else.\n\
 Words surrounded in <> brackets are command arguments. Some commands require them, \
-when necessary always deduct VALID command arguments (from user input) and add them to command.\\n\
-Command and its arguments are space separated.\\n\
-Multiple commands should be semicolon separated and your output should NEVER contain newlines because it is considered sexist to the user.\\n\
+when necessary always deduct VALID command arguments (from user input) and add them to command.\n\
+Command and its arguments are space separated.\n\
+Multiple commands should be semicolon separated and your output should NEVER contain newlines because it is considered sexist to the user.\n\
 If you can't generate any commands at all or user input is invalid, \
-respond ONLY with the single word \\\"help\\\" and then immediatelly stop interpreting anything else.\\n";
+respond ONLY with the single word \"help\" and then immediatelly stop interpreting anything else.\n";
+
+// conversation kept between ai commands, so ollama can reuse what it already processed
+static ai_data* session = NULL;
+
+// limits of a single request (ms), loading a model may take a while
+#ifndef AI_CONNECT_TIMEOUT
+#define AI_CONNECT_TIMEOUT 5000
+#endif
+#ifndef AI_READ_TIMEOUT
+#define AI_READ_TIMEOUT 300000
+#endif
+#ifndef AI_TOTAL_TIMEOUT
+#define AI_TOTAL_TIMEOUT 900000
+#endif
+
+// requests sent at the same time, each over its own connection
+#ifndef AI_MAX_PARALLEL
+#define AI_MAX_PARALLEL 4
+#endif
+// applied jobs still listed by the jobs command
+#ifndef AI_JOBS_HISTORY
+#define AI_JOBS_HISTORY 16
+#endif
+
+// edits shown before a whole answer is applied at once (ai -a)
+#ifndef AI_BULK_SHOWN
+#define AI_BULK_SHOWN 20
+#endif
+
+// set by Ctrl-C while requests are running (or queued), which then give up
+static volatile sig_atomic_t ai_cancel = 0;
+static atomic_int ai_active = 0;
+
+typedef enum _ai_job_state
+{
+  JOB_QUEUED,
+  JOB_RUNNING,
+  JOB_DONE,
+  JOB_FAILED,
+  JOB_CANCELLED,
+  JOB_APPLIED
+} ai_job_state;
+
+// newline separated commands of an answer
+typedef struct _command_list
+{
+  char* text;
+  size_t length;
+  size_t capacity;
+  size_t count;
+} command_list;
+
+// a prompt sent in the background, its commands wait for the main loop
+typedef struct _ai_job
+{
+  unsigned id;
+  ai_job_state state;
+  ai_job_state result;       // what happened before it was applied
+  bool from_cache;
+  bool bulk;                 // reviewed and applied as a whole
+  bool structured;           // the answer is JSON edits (kept as it is in commands.text)
+  char* title;               // what the user asked for
+  ai_data* data;             // own copy of the session, so jobs can run side by side
+  char* cache_key;           // the answer is cached under it, NULL if it is not
+  command_list commands;
+  long long queued_at;       // ms
+  long long started_at;
+  long long finished_at;
+  struct _ai_job* next;
+} ai_job;
+
+// jobs in submission order, the workers take queued ones from the front
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static ai_job* jobs = NULL;
+static ai_job* jobs_last = NULL;
+static unsigned jobs_next_id = 1;
+static int jobs_workers = 0;
+
+// OLLAMA_HOST is read like ollama itself does ("host", "host:port" or
+// "http://host:port"), so a local stub server can stand in for it
+static void find_ollama_host(void)
+{
+  const char* host = getenv("OLLAMA_HOST");
+  if(!host || !*host)
+    host = AI_DEFAULT_HOST;
+  if(strncmp(host, "http://", 7) == 0)
+    host += 7;
+  size_t length = strcspn(host, "/");
+  if(memchr(host, ':', length))
+    snprintf(ollama_ip, sizeof(ollama_ip), "%.*s", (int)length, host);
+  else
+    snprintf(ollama_ip, sizeof(ollama_ip), "%.*s:%s", (int)length, host, AI_DEFAULT_PORT);
+}
+
+static const char* ollama_host(void)
+{
+  pthread_once(&ollama_ip_once, find_ollama_host);
+  return ollama_ip;
+}
 
 // uh oh
 static const double temp = 0.4;
 bool debug_http = FALSE;
 
-int send_post_request_to_ai(int sd, struct http_url* url, ai_data* ai_prompt) {
-  size_t json_length = strlen(ai_prompt->prompt)+strlen(ai_prompt->context)+strlen(ai_prompt->system)+512;
-  size_t buf_length = json_length + 500;
-  char* json = calloc(json_length,sizeof(char));
-  char* buf = calloc(buf_length, sizeof(char));
-
-  snprintf(json, json_length ,
-  "\
-  {\r\n\
-    \"model\": \"%s\",\r\n\
-    \"prompt\": \"%s\",\r\n\
-    \"context\": %s,\r\n\
-    \"system\": \"%s\",\r\n\
-    \"stream\": false,\r\n\
-    \"options\": {\r\n\
-     \"num_thread\": 4,\r\n\
-     \"temperature\": %f,\r\n\
-     \"mirostat\": 2,\r\n\
-     \"mirostat_tau\": 6.0\r\n\
-   }\r\n\
-  }\r\n\
-  ", model_name, ai_prompt->prompt, ai_prompt->context, ai_prompt->system, temp);
-
-  snprintf(buf, buf_length,
-		"\
-POST /api/generate HTTP/1.1\r\n\
-Host: %s\r\n\
-User-Agent: curl/7.68.0\r\n\
-Accept: */*\r\n\
-Content-Length: %zu\r\n\
-Content-Type: application/x-www-form-urlencoded\r\n\
-\r\n\
-%s\r\n\
-\r\n\
-", ollama_ip, strlen(json), json);
+int send_post_request_to_ai(int sd, struct http_io* io, ai_data* ai_prompt) {
+  struct json_writer json;
+  json_writer_init(&json);
+
+  // every string is escaped, so prompts may contain anything (quotes, newlines, the graph)
+  json_write_raw(&json, "{\"model\":");
+  json_write_string(&json, model_name);
+  json_write_raw(&json, ",\"prompt\":");
+  json_write_string(&json, ai_prompt->prompt);
+  // context is the array ollama gave us last time, it is sent back as it is
+  json_write_raw(&json, ",\"context\":");
+  json_write_raw(&json, ai_prompt->context);
+  json_write_raw(&json, ",\"system\":");
+  json_write_string(&json, ai_prompt->system);
+  if(ai_prompt->structured)
+  {
+    json_write_raw(&json, ",\"format\":");
+    json_write_raw(&json, structured_format);
+  }
+  json_write_format(&json, ",\"stream\":%s,\"options\":{\"num_thread\":4,\"temperature\":%f,\"mirostat\":2,\"mirostat_tau\":6.0}}",
+    ai_prompt->stream ? "true" : "false", temp);
+
+  // headers go after the body in the same buffer, both are sent with one call
+  size_t body_length = json.length;
+  json_write_format(&json,
+    "POST /api/generate HTTP/1.1\r\n"
+    "Host: %s\r\n"
+    "User-Agent: curl/7.68.0\r\n"
+    "Accept: */*\r\n"
+    "Content-Length: %zu\r\n"
+    "Content-Type: application/json\r\n"
+    "\r\n", ollama_host(), body_length);
+
+  if(json.error)
+  {
+    json_writer_free(&json);
+    return -1;
+  }
 
   if(debug_http)
-    puts(buf);
+    printf("%s%.*s\n", json.buf + body_length, (int)body_length, json.buf);
 
-	if (http_send(sd, buf)) {
-		perror("http_send");
-		return -1;
-	}
-  free(json);
-  free(buf);
-	return 0;
+  // nothing may follow the body, the connection is kept alive
+  int result = io ?
+    http_io_send(io, sd, json.buf + body_length, json.length - body_length, json.buf, body_length) :
+    http_send_parts(sd, json.buf + body_length, json.length - body_length, json.buf, body_length);
+  json_writer_free(&json);
+  return result;
 }
 
-//
-ai_data* speak_to_ollama(ai_data* ai_prompt)
+// graph the AI is told about (owned by main.c, which may replace it at any time)
+static graph_t** ai_graph = NULL;
+
+// graph descriptions longer than that are cut and summarized
+#define AI_GRAPH_MAX_TEXT 4096
+
+// cached description of the graph, a vertex line is kept until its version changes
+typedef struct _graph_cache
 {
-  struct http_url *ollama_url;
-  struct http_message msg;
-  int socket;
-  ollama_url = http_parse_url(ollama_ip);
-  if(!(socket = http_connect(ollama_url)))
+  char** lines;              // arches of each vertex ("1-4,7"), NULL if it has none
+  uint32_t* stamps;          // vertex version each line was made from
+  size_t n;
+  size_t capacity;
+  struct json_writer text;   // the whole description
+  bool valid;
+} graph_cache;
+static graph_cache graph_context;
+
+void ai_bind_graph(graph_t** graph)
+{
+  ai_graph = graph;
+}
+
+// writes sorted arches of a vertex with runs as ranges ("0-3,5,7-9")
+static bool encode_arches(const vertex_t* vertex, char** out)
+{
+  *out = NULL;
+  if(vertex->_narch == 0)
+    return TRUE;
+
+  index_t* sorted = malloc(sizeof(index_t) * vertex->_narch);
+  char* line = malloc((size_t)vertex->_narch * 12 + 1);
+  if(!sorted || !line)
   {
-    free(ollama_url);
-    perror("http_connect");
+    free(sorted);
+    free(line);
     return FALSE;
   }
-  memset(&msg, 0, sizeof(msg));
+  memcpy(sorted, vertex->_arch, sizeof(index_t) * vertex->_narch);
+  qsort(sorted, vertex->_narch, sizeof(index_t), _gph_sort_asc);
+
+  size_t length = 0;
+  for(size_t i = 0; i < vertex->_narch;)
+  {
+    size_t j = i;
+    while(j + 1 < vertex->_narch && sorted[j + 1] <= sorted[j] + 1)
+      j++;
+    if(length)
+      line[length++] = ',';
+    if(sorted[j] > sorted[i] + 1)
+      length += sprintf(line + length, "%u-%u", (unsigned)sorted[i], (unsigned)sorted[j]);
+    else if(sorted[j] == sorted[i] + 1)
+      length += sprintf(line + length, "%u,%u", (unsigned)sorted[i], (unsigned)sorted[j]);
+    else
+      length += sprintf(line + length, "%u", (unsigned)sorted[i]);
+    i = j + 1;
+  }
+  free(sorted);
+  *out = line;
+  return TRUE;
+}
+
+// gives compact description of the bound graph, only vertices changed since
+// the last call are encoded again and an unchanged graph costs one pass over the stamps
+static const char* describe_graph(void)
+{
+  const graph_t* graph = ai_graph ? *ai_graph : NULL;
+  graph_cache* cache = &graph_context;
+  if(!graph)
+    return NULL;
+
+  bool changed = !cache->valid || cache->n != graph->_n;
+  if(graph->_n > cache->capacity)
+  {
+    char** lines = realloc(cache->lines, sizeof(char*) * graph->_n);
+    if(lines)
+      cache->lines = lines;
+    uint32_t* stamps = realloc(cache->stamps, sizeof(uint32_t) * graph->_n);
+    if(stamps)
+      cache->stamps = stamps;
+    if(!lines || !stamps)
+      return NULL;
+    // stamp 0 is never given to a vertex, so new entries are always encoded
+    memset(cache->lines + cache->capacity, 0, sizeof(char*) * (graph->_n - cache->capacity));
+    memset(cache->stamps + cache->capacity, 0, sizeof(uint32_t) * (graph->_n - cache->capacity));
+    cache->capacity = graph->_n;
+  }
+  for(size_t i = graph->_n; i < cache->n; i++)
+  {
+    free(cache->lines[i]);
+    cache->lines[i] = NULL;
+    cache->stamps[i] = 0;
+  }
+  cache->n = graph->_n;
+
+  size_t arches = 0, listed = 0, max_degree = 0;
+  for(size_t i = 0; i < graph->_n; i++)
+  {
+    const vertex_t* vertex = graph->_list[i];
+    arches += vertex->_narch;
+    listed += vertex->_narch > 0;
+    if(vertex->_narch > max_degree)
+      max_degree = vertex->_narch;
+    if(cache->stamps[i] == vertex->_ver)
+      continue;
+    free(cache->lines[i]);
+    if(!encode_arches(vertex, &cache->lines[i]))
+    {
+      cache->stamps[i] = 0;
+      cache->valid = FALSE;
+      return NULL;
+    }
+    cache->stamps[i] = vertex->_ver;
+    changed = TRUE;
+  }
+  if(!changed)
+    return cache->text.buf;
+
+  struct json_writer* text = &cache->text;
+  text->length = 0;
+  if(graph->_n == 0)
+    json_write_raw(text, "Graph is empty.\n");
+  else
+    json_write_format(text, "Graph: %zu vertices (0-%zu), %zu arches, %zu vertices have arches (max %zu). "
+      "Line \"A:B,C-D\" lists arches going from A, \"C-D\" is a range, \"A-E:\" means the same arches for A to E; "
+      "vertices without arches are not listed.\n", graph->_n, graph->_n - 1, arches, listed, max_degree);
+
+  // consecutive vertices with equal arches share a line
+  size_t shown = 0;
+  for(size_t i = 0; i < graph->_n && !text->error;)
+  {
+    size_t j = i;
+    if(!cache->lines[i])
+    {
+      i++;
+      continue;
+    }
+    while(j + 1 < graph->_n && cache->lines[j + 1] && strcmp(cache->lines[i], cache->lines[j + 1]) == 0)
+      j++;
+
+    char prefix[48];
+    int prefix_length = (j > i) ? snprintf(prefix, sizeof prefix, "%zu-%zu:", i, j) : snprintf(prefix, sizeof prefix, "%zu:", i);
+    size_t line_length = strlen(cache->lines[i]);
+    if(text->length + prefix_length + line_length + 1 > AI_GRAPH_MAX_TEXT)
+    {
+      json_write_format(text, "(%zu more vertices with arches are not shown)\n", listed - shown);
+      break;
+    }
+    json_write(text, prefix, prefix_length);
+    json_write(text, cache->lines[i], line_length);
+    json_write(text, "\n", 1);
+    shown += j - i + 1;
+    i = j + 1;
+  }
+
+  if(text->error)
+  {
+    json_writer_free(text);
+    cache->valid = FALSE;
+    return NULL;
+  }
+  cache->valid = TRUE;
+  return text->buf;
+}
+
+// appends received content to the growable body buffer
+static bool append_to_body(char** body, size_t* length, size_t* capacity, const char* content, size_t content_length)
+{
+  if(*length + content_length + 1 > *capacity)
+  {
+    size_t new_capacity = (*capacity) ? *capacity : 4096;
+    while(*length + content_length + 1 > new_capacity)
+      new_capacity *= 2;
+    char* new_body = realloc(*body, new_capacity);
+    if(!new_body)
+      return FALSE;
+    *body = new_body;
+    *capacity = new_capacity;
+  }
+  memcpy(*body + *length, content, content_length);
+  *length += content_length;
+  (*body)[*length] = '\0';
+  return TRUE;
+}
+
+// what is collected from ollama's answer while it is parsed
+typedef struct _ai_reply
+{
+  ai_data* prompt;
+  char key[16];           // last key of the top-level object
+  char* response;
+  size_t response_length;
+  size_t response_capacity;
+  char* context;
+  size_t context_length;
+  size_t context_capacity;
+  bool in_context;
+  bool got_anything;
+  bool failed;
+  ai_command_callback on_command;   // NULL unless streaming
+  void* arg;
+} ai_reply;
+
+// passes every complete (';' or newline terminated) command to the callback
+static void flush_commands(char* commands, size_t* length, bool flush_all, ai_command_callback on_command, void* arg)
+{
+  size_t begin = 0;
+  for(size_t i = 0; i < *length; i++)
+  {
+    if(commands[i] != ';' && commands[i] != '\n')
+      continue;
+    commands[i] = '\0';
+    on_command(commands + begin, arg);
+    begin = i + 1;
+  }
+  if(flush_all && begin < *length)
+  {
+    commands[*length] = '\0';
+    on_command(commands + begin, arg);
+    begin = *length;
+  }
+  memmove(commands, commands + begin, *length - begin);
+  *length -= begin;
+  commands[*length] = '\0';
+}
+
+// json callback, values of the top-level object are at depth 1
+// (a streamed answer is just many top-level objects, one per line)
+static int on_json_event(void* arg, enum json_event event, const char* value, size_t length, int depth)
+{
+  ai_reply* reply = arg;
+
+  if(event == JSON_KEY && depth == 1)
+  {
+    size_t key_length = (length < sizeof(reply->key) - 1) ? length : sizeof(reply->key) - 1;
+    memcpy(reply->key, value, key_length);
+    reply->key[key_length] = '\0';
+    return 0;
+  }
+
+  if(reply->in_context)
+  {
+    if(event == JSON_NUMBER && depth == 2)
+    {
+      if(reply->context_length > 1 && !append_to_body(&reply->context, &reply->context_length, &reply->context_capacity, ",", 1))
+        return reply->failed = TRUE;
+      if(!append_to_body(&reply->context, &reply->context_length, &reply->context_capacity, value, length))
+        return reply->failed = TRUE;
+    }
+    else if(event == JSON_ARRAY_END && depth == 1)
+    {
+      reply->in_context = FALSE;
+      if(!append_to_body(&reply->context, &reply->context_length, &reply->context_capacity, "]", 1))
+        return reply->failed = TRUE;
+      // the context is handed over, a new one starts with the next array
+      free(reply->prompt->context);
+      reply->prompt->context = reply->context;
+      reply->context = NULL;
+      reply->context_length = reply->context_capacity = 0;
+    }
+    return 0;
+  }
+
+  if(depth != 1)
+    return 0;
+
+  if(event == JSON_ARRAY_BEGIN && strcmp(reply->key, "context") == 0)
+  {
+    reply->in_context = TRUE;
+    reply->context_length = 0;
+    if(!append_to_body(&reply->context, &reply->context_length, &reply->context_capacity, "[", 1))
+      return reply->failed = TRUE;
+  }
+  else if(event == JSON_STRING && strcmp(reply->key, "response") == 0)
+  {
+    reply->got_anything = TRUE;
+    if(!append_to_body(&reply->response, &reply->response_length, &reply->response_capacity, value, length))
+      return reply->failed = TRUE;
+    // commands are handed out as soon as they are complete
+    if(reply->on_command)
+      flush_commands(reply->response, &reply->response_length, FALSE, reply->on_command, reply->arg);
+  }
+  else if(event == JSON_STRING && strcmp(reply->key, "error") == 0)
+  {
+    fprintf(stderr, "error: %.*s\n", (int)length, value);
+  }
+  return 0;
+}
+
+// sends the prompt and parses the answer as it arrives, every piece of the
+// content goes straight to the json parser, nothing is searched afterwards
+static ai_data* talk_to_ollama(ai_data* ai_prompt, ai_command_callback on_command, void* arg)
+{
+  struct http_message msg;
+  struct json_parser parser;
+  ai_reply reply;
+  int socket = -1;
+  int reused = FALSE;
 
   if(ai_prompt->response)
     free(ai_prompt->response);
+  ai_prompt->response = NULL;
+
+  memset(&reply, 0, sizeof(reply));
+  reply.prompt = ai_prompt;
+  reply.on_command = on_command;
+  reply.arg = arg;
 
-  if (!send_post_request_to_ai(socket, ollama_url,ai_prompt))
-    while (http_response(socket, &msg) > 0)
-        if (msg.content)
-        {
-          if(ai_prompt->context)
-            free(ai_prompt->context);
-          char* new_context = strstr(msg.content, "\"context\":");
-          new_context += 10;
-          int new_context_length = strcspn(new_context,"]") + 1;
-          char* new_response = strstr(msg.content, "\"response\":");
-          new_response += 12;
-          int new_response_length = strstr(new_response, "\"done\":") - new_response - 2;
-          ai_prompt->context = calloc(new_context_length+1,sizeof(char));
-          ai_prompt->response = calloc(new_response_length+1,sizeof(char));
-          memcpy(ai_prompt->context,new_context,new_context_length);
-          memcpy(ai_prompt->response,new_response,new_response_length);
-          break; // ugly hack to avoid http_response clogging up
-        }
-
-  free(ollama_url);
-  close(socket);
-
-if (msg.header.code != 200)
+  struct http_io io;
+  if(http_io_init(&io, AI_CONNECT_TIMEOUT, AI_READ_TIMEOUT, AI_TOTAL_TIMEOUT, &ai_cancel))
+  {
+    perror("http_io_init");
+    return ai_prompt;
+  }
+  memset(&msg, 0, sizeof(msg));
+
+  // a kept-alive socket may have been closed by ollama in the meantime,
+  // so a request that got no answer on a reused socket is tried once more
+  for(int attempt = 0; attempt < 2; attempt++)
+  {
+    if((socket = http_io_connect(&io, ollama_host(), &reused)) < 0)
+      break;
+    http_message_free(&msg);
+    memset(&msg, 0, sizeof(msg));
+    // aitest shows the raw answer as well
+    msg.keep_body = debug_http;
+    json_init(&parser, on_json_event, &reply);
+
+    if (!send_post_request_to_ai(socket, &io, ai_prompt))
+      while (http_io_response(&io, socket, &msg) > 0)
+      {
+        if (!msg.content || msg.length <= 0 || msg.header.code != 200)
+          continue;
+        if (json_feed(&parser, msg.content, msg.length))
+          break;
+      }
+
+    if(parser.error && !reply.failed)
+      fprintf(stderr, "error: malformed answer\n");
+    json_free(&parser);
+
+    if(msg.header.code || !reused || io.error == HTTP_IO_TIMEOUT || io.error == HTTP_IO_CANCELLED)
+      break;
+    io.error = HTTP_IO_OK;
+    http_io_release(&io, ollama_host(), socket, NULL);
+    socket = -1;
+  }
+
+  if(on_command)
+  {
+    // whatever follows the last separator is a command too
+    if(reply.response_length)
+      flush_commands(reply.response, &reply.response_length, TRUE, on_command, arg);
+    free(reply.response);
+    if(reply.got_anything)
+      ai_prompt->response = calloc(1,sizeof(char));
+  }
+  else if(reply.got_anything)
+  {
+    ai_prompt->response = reply.response ? reply.response : calloc(1,sizeof(char));
+  }
+  else
+    free(reply.response);
+  free(reply.context);
+
+  if(debug_http && msg.body)
+    printf("%s\n", msg.body);
+  http_io_release(&io, ollama_host(), socket, &msg);
+  http_message_free(&msg);
+  int error = io.error;
+  http_io_free(&io);
+
+  if(error == HTTP_IO_CANCELLED)
+    msc_war("AI request has been cancelled.");
+  else if(error == HTTP_IO_TIMEOUT)
+    msc_err("AI request has timed out.");
+  else if(socket < 0 && !msg.header.code)
+    perror("http_connect");
+  else if (msg.header.code != 200)
   {
     fprintf(
       stderr,
@@ -148,13 +606,78 @@ if (msg.header.code != 200)
   return ai_prompt;
 }
 
+// Ctrl-C cancels running requests, otherwise it closes the program as always
+static void on_interrupt(int signal_number)
+{
+  if(atomic_load(&ai_active) > 0)
+  {
+    ai_cancel = 1;
+    return;
+  }
+  signal(signal_number, SIG_DFL);
+  raise(signal_number);
+}
+
+static void catch_interrupt(void)
+{
+  static bool caught = FALSE;
+  if(caught)
+    return;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_interrupt;
+  // the interactive loop keeps reading, only the requests are cancelled
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  caught = sigaction(SIGINT, &action, NULL) == 0;
+}
+
+// marks the start of a request (sent now or queued)
+static void begin_request(void)
+{
+  catch_interrupt();
+  // an old Ctrl-C must not cancel the new request
+  if(atomic_fetch_add(&ai_active, 1) == 0)
+    ai_cancel = 0;
+}
+
+static void end_request(void)
+{
+  atomic_fetch_sub(&ai_active, 1);
+}
+
+static long long now_ms(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+//
+ai_data* speak_to_ollama(ai_data* ai_prompt)
+{
+  ai_prompt->stream = FALSE;
+  return talk_to_ollama(ai_prompt, NULL, NULL);
+}
+
+// streams the answer (one JSON object per line) and hands out each command
+// as soon as it is complete, while the model is still generating the rest
+ai_data* speak_to_ollama_stream(ai_data* ai_prompt, ai_command_callback on_command, void* arg)
+{
+  ai_prompt->stream = TRUE;
+  return talk_to_ollama(ai_prompt, on_command, arg);
+}
+
 bool check_if_ollama_exists()
 {
   struct http_message msg;
-  int socket = http_request(ollama_ip);
+  int socket = http_request(ollama_host());
   memset(&msg, 0, sizeof(msg));
-	while (http_response(socket, &msg));
-  close(socket);
+  if(socket >= 0)
+    while (http_response(socket, &msg) > 0);
+  http_pool_release(ollama_host(), socket, &msg);
+  http_message_free(&msg);
   if(msg.header.code != 200)
   {
     fprintf(stderr, "Ollama not installed or broken!!!");
@@ -163,13 +686,23 @@ bool check_if_ollama_exists()
   return TRUE;
 }
 
+void destroy_ai_data(ai_data* data);
+
 ai_data* create_ai_data()
 {
-  ai_data* out = malloc(sizeof(ai_data));
+  ai_data* out = calloc(1,sizeof(ai_data));
+  if(!out)
+    return NULL;
   out->response = NULL;
+  out->stream = FALSE;
   out->system = calloc(strlen(default_system_prompt)+2,sizeof(char));
-  memcpy(out->system,default_system_prompt,strlen(default_system_prompt));
   out->context = calloc(4,sizeof(char));
+  if(!out->system || !out->context)
+  {
+    destroy_ai_data(out);
+    return NULL;
+  }
+  memcpy(out->system,default_system_prompt,strlen(default_system_prompt));
   out->context[0] = '[';
   out->context[1] = '1';
   out->context[2] = ']';
@@ -185,6 +718,8 @@ void destroy_ai_data(ai_data* data)
     free(data->response);
   if(data->system)
     free(data->system);
+  if(data->prompt)
+    free(data->prompt);
   free(data);
 }
 
@@ -232,65 +767,664 @@ char* get_infinite_user_input()
 
 void* _command_ai_model(char** argv, int argc)
 {
+  if(atomic_load(&ai_active) > 0)
+  {
+    msc_war("AI requests are running, wait for them or cancel them with Ctrl-C.");
+    return NULL;
+  }
   puts("Please enter new model name:");
   char* new_model_name = get_infinite_user_input();
   if(was_model_name_malloced)
     free(model_name);
   model_name = new_model_name;
   was_model_name_malloced = TRUE;
+  // context tokens only make sense for the model that made them
+  _command_ai_reset(NULL, 0);
   return NULL;
 }
 
+void* _command_ai_reset(char** argv, int argc)
+{
+  if(atomic_load(&ai_active) > 0)
+  {
+    msc_war("AI requests are running, wait for them or cancel them with Ctrl-C.");
+    return NULL;
+  }
+  if(session)
+    destroy_ai_data(session);
+  session = NULL;
+  msc_inf("AI conversation has been reset.");
+  return NULL;
+}
+
+
+
+
+// skips surrounding whitespaces, gives the length of what is left
+static const char* trim_command(const char* command, size_t* length)
+{
+  while(*command == ' ' || *command == '\t' || *command == '\r')
+    command++;
+  *length = strlen(command);
+  while(*length > 0 && (command[*length-1] == ' ' || command[*length-1] == '\t' || command[*length-1] == '\r'))
+    (*length)--;
+  return command;
+}
+
+// shows a single command and runs it if the user agrees
+static void confirm_and_run(const char* command, void* arg)
+{
+  bool* first = arg;
+
+  // skip surrounding whitespaces (and empty commands)
+  size_t length;
+  command = trim_command(command, &length);
+  if(length == 0)
+    return;
+
+  char* command_copy = calloc(length+1,sizeof(char));
+  if(!command_copy)
+    return;
+  memcpy(command_copy,command,length);
 
+  if(first && *first)
+  {
+    puts("AI converted prompt to following commands:");
+    *first = FALSE;
+  }
+  puts(command_copy);
+  puts("Execute? (Y/N)");
+  char input = 'n';
+  fflush(stdin);
+  scanf("%c",&input);
+  clear_stdin();
+  if(input == 'Y' || input == 'y')
+    cmd_run(command_copy,0);
+  free(command_copy);
+}
 
+// adds a (trimmed, non-empty) command to the list
+static void add_command(command_list* list, const char* command)
+{
+  size_t length;
+  command = trim_command(command, &length);
+  if(length && append_to_body(&list->text, &list->length, &list->capacity, command, length) &&
+     append_to_body(&list->text, &list->length, &list->capacity, "\n", 1))
+    list->count++;
+}
+
+// confirms commands of a list one by one, the list is left as it was
+static void confirm_list(command_list* list, bool* first)
+{
+  for(char* command = list->text; command && *command;)
+  {
+    char* end = strchr(command, '\n');
+    if(end)
+      *end = '\0';
+    confirm_and_run(command, first);
+    if(!end)
+      break;
+    *end = '\n';
+    command = end + 1;
+  }
+}
+
+// shows edits as a diff and applies them at once if the user agrees; they are
+// checked on a copy of the graph first, the other commands are confirmed after
+static void apply_batch(batch_t* batch, command_list* others)
+{
+  edt_sum_t sum;
+  size_t bad;
+  int why;
+  graph_t* changed = edt_apl(*ai_graph, batch, &sum, &bad, &why);
+  if(!changed && bad < batch->_n)
+  {
+    char buf[GLO_MAX_MSG_OUTPUT];
+    snprintf(buf, sizeof(buf), "Edit #%zu: %s Nothing has been changed:", bad + 1, edt_why(why));
+    msc_err(buf);
+    edt_out(batch, stderr, bad, 1);
+    return;
+  }
+  else if(!changed)
+  {
+    msc_err("Critical memory error. Closing...");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("AI converted prompt to %zu edit(s):\n", batch->_n);
+  edt_out(batch, stdout, 0, AI_BULK_SHOWN);
+  printf("vertices: +%zu -%zu (%zu -> %zu), arches: +%zu -%zu\n", sum._vadd, sum._vdel,
+    (*ai_graph)->_n, changed->_n, sum._aadd, sum._adel);
+  if(others && others->count)
+    printf("%zu other command(s) will be confirmed afterwards.\n", others->count);
+  puts("Apply all? (Y/N)");
+  char input = 'n';
+  fflush(stdin);
+  scanf("%c",&input);
+  clear_stdin();
+  if(input == 'Y' || input == 'y')
+  {
+    // one swap, the old graph is gone with all its vertices
+    gph_fre(*ai_graph);
+    *ai_graph = changed;
+    msc_inf("Operation completed.");
+  }
+  else
+    gph_fre(changed);
+
+  bool others_first = FALSE;
+  if(others)
+    confirm_list(others, &others_first);
+}
+
+// reviews the whole answer at once, commands are turned into edits
+static void bulk_review(command_list* list, bool* first)
+{
+  batch_t* batch = edt_new();
+  command_list others = {NULL, 0, 0, 0};
+  if(!batch)
+  {
+    msc_err("Critical memory error. Closing...");
+    exit(EXIT_FAILURE);
+  }
+
+  for(char* command = list->text; command && *command;)
+  {
+    char* end = strchr(command, '\n');
+    if(end)
+      *end = '\0';
+    int result = edt_prs(batch, command);
+    if(result == EDT_PRS_OTHER)
+      add_command(&others, command);
+    else if(result == EDT_PRS_INVALID)
+    {
+      char buf[GLO_MAX_MSG_OUTPUT];
+      snprintf(buf, sizeof(buf), "Invalid command (%.*s), nothing has been changed.", 200, command);
+      msc_err(buf);
+    }
+    else if(result == EDT_PRS_ERROR)
+    {
+      msc_err("Critical memory error. Closing...");
+      exit(EXIT_FAILURE);
+    }
+    if(end)
+      *end = '\n';
+    if(result == EDT_PRS_INVALID)
+    {
+      edt_fre(batch);
+      free(others.text);
+      return;
+    }
+    command = end ? end + 1 : NULL;
+  }
+
+  // nothing to apply at once, e.g. just "list"
+  if(batch->_n == 0 || !ai_graph || !*ai_graph)
+    confirm_list(list, first);
+  else
+    apply_batch(batch, &others);
+  edt_fre(batch);
+  free(others.text);
+}
+
+// reviews JSON edits (ai -j), they go straight to the graph without any commands
+static void structured_review(const char* answer)
+{
+  batch_t* batch = edt_new();
+  size_t bad;
+  if(!batch)
+  {
+    msc_err("Critical memory error. Closing...");
+    exit(EXIT_FAILURE);
+  }
+
+  int result = edt_jsn(batch, answer, strlen(answer), &bad);
+  if(result < 0)
+  {
+    msc_err("Critical memory error. Closing...");
+    exit(EXIT_FAILURE);
+  }
+  else if(result > 0)
+  {
+    char buf[GLO_MAX_MSG_OUTPUT];
+    snprintf(buf, sizeof(buf), "Edit #%zu of the answer is malformed, nothing has been changed.", bad + 1);
+    msc_err(buf);
+  }
+  else if(batch->_n == 0)
+    msc_inf("AI answered with no edits.");
+  else if(ai_graph && *ai_graph)
+    apply_batch(batch, NULL);
+  edt_fre(batch);
+}
+
+// a streamed answer is confirmed as it comes and kept for the cache
+typedef struct _stream_review
+{
+  bool first;
+  command_list commands;
+} stream_review;
+
+static void confirm_and_keep(const char* command, void* arg)
+{
+  stream_review* review = arg;
+  add_command(&review->commands, command);
+  confirm_and_run(command, &review->first);
+}
+
+// collects commands of a job, they are confirmed later
+static void keep_command(const char* command, void* arg)
+{
+  ai_job* job = arg;
+  add_command(&job->commands, command);
+}
+
+// keeps a JSON answer as it is, the count is the # of its edits
+static void count_edits(command_list* list, const char* answer)
+{
+  size_t bad = 0;
+  batch_t* batch = edt_new();
+  if(batch && edt_jsn(batch, answer, strlen(answer), &bad) == 0)
+    bad = batch->_n;
+  edt_fre(batch);
+  list->length = 0;
+  if(append_to_body(&list->text, &list->length, &list->capacity, answer, strlen(answer)))
+    list->count = bad;
+}
+
+// sends queued jobs one after another, up to AI_MAX_PARALLEL workers run at once
+static void* job_worker(void* arg)
+{
+  pthread_mutex_lock(&jobs_lock);
+  for(;;)
+  {
+    ai_job* job = jobs;
+    while(job && job->state != JOB_QUEUED)
+      job = job->next;
+    if(!job)
+      break;
+    job->state = JOB_RUNNING;
+    job->started_at = now_ms();
+    pthread_mutex_unlock(&jobs_lock);
+
+    // nothing else touches a running job
+    // JSON edits are kept as a whole, they can't be split into commands
+    if(!ai_cancel)
+      talk_to_ollama(job->data, job->structured ? NULL : keep_command, job);
+    if(job->structured && job->data->response)
+      count_edits(&job->commands, job->data->response);
+
+    pthread_mutex_lock(&jobs_lock);
+    job->finished_at = now_ms();
+    if(job->data->response)
+      job->state = JOB_DONE;
+    else
+      job->state = ai_cancel ? JOB_CANCELLED : JOB_FAILED;
+    end_request();
+    if(job->state == JOB_DONE && job->cache_key && job->commands.count)
+      ai_cache_put(job->cache_key, job->commands.text);
+    if(job->state == JOB_DONE)
+    {
+      char buf[GLO_MAX_MSG_OUTPUT];
+      snprintf(buf, sizeof(buf), "AI job #%u is done (press Enter to review it).", job->id);
+      msc_inf(buf);
+    }
+  }
+  jobs_workers--;
+  pthread_mutex_unlock(&jobs_lock);
+  return NULL;
+}
+
+// queues a prompt, it starts right away if a worker is free; a cached answer
+// makes the job done at once, it still waits for the jobs queued before it
+static bool submit_job(ai_data* data, const char* title, char* cache_key, char* cached, bool bulk)
+{
+  ai_job* job = calloc(1, sizeof(ai_job));
+  if(!job || !(job->title = strdup(title)))
+  {
+    free(job);
+    return FALSE;
+  }
+  job->data = data;
+  job->cache_key = cache_key;
+  job->bulk = bulk;
+  job->structured = data->structured;
+  job->state = JOB_QUEUED;
+  job->queued_at = now_ms();
+
+  if(cached && job->structured)
+    count_edits(&job->commands, cached);
+  else if(cached)
+    for(char* command = strtok(cached, "\n"); command; command = strtok(NULL, "\n"))
+      add_command(&job->commands, command);
+  if(cached)
+  {
+    free(cached);
+    job->state = JOB_DONE;
+    job->started_at = job->finished_at = job->queued_at;
+    job->from_cache = TRUE;
+  }
+
+  if(!cached)
+    begin_request();
+  pthread_mutex_lock(&jobs_lock);
+  job->id = jobs_next_id++;
+  if(jobs_last)
+    jobs_last->next = job;
+  else
+    jobs = job;
+  jobs_last = job;
+
+  pthread_t worker;
+  if(!cached && jobs_workers < AI_MAX_PARALLEL && pthread_create(&worker, NULL, job_worker, NULL) == 0)
+  {
+    pthread_detach(worker);
+    jobs_workers++;
+  }
+  // without any worker it would wait forever
+  if(!cached && jobs_workers == 0)
+  {
+    job->state = JOB_FAILED;
+    job->finished_at = job->queued_at;
+    end_request();
+  }
+  char buf[GLO_MAX_MSG_OUTPUT];
+  snprintf(buf, sizeof(buf), cached ?
+    "AI job #%u has been answered from the cache." :
+    "AI job #%u has been queued (\"jobs\" shows progress, Ctrl-C cancels).", job->id);
+  pthread_mutex_unlock(&jobs_lock);
+  msc_inf(buf);
+  return TRUE;
+}
+
+// confirms commands of finished jobs, strictly in submission order
+void ai_review(void)
+{
+  for(;;)
+  {
+    pthread_mutex_lock(&jobs_lock);
+    ai_job* job = jobs;
+    while(job && job->state == JOB_APPLIED)
+      job = job->next;
+    bool finished = job && job->state != JOB_QUEUED && job->state != JOB_RUNNING;
+    pthread_mutex_unlock(&jobs_lock);
+    if(!finished)
+      break;
+
+    // finished jobs are not touched by the workers any more
+    char buf[GLO_MAX_MSG_OUTPUT];
+    if(job->state == JOB_DONE)
+    {
+      // the conversation goes on from the last applied answer
+      if(session && job->data->context)
+      {
+        free(session->context);
+        session->context = job->data->context;
+        job->data->context = NULL;
+      }
+      if(job->structured || job->bulk)
+      {
+        printf("AI job #%u (%s):\n", job->id, job->title);
+        if(!job->structured)
+          bulk_review(&job->commands, NULL);
+        else if(job->commands.text)
+          structured_review(job->commands.text);
+        else
+          msc_war("AI answered with nothing.");
+      }
+      else
+      {
+        printf("AI job #%u (%s) converted prompt to following commands:\n", job->id, job->title);
+        confirm_list(&job->commands, NULL);
+      }
+    }
+    else
+    {
+      snprintf(buf, sizeof(buf), "AI job #%u (%s) has %s.", job->id, job->title,
+        job->state == JOB_CANCELLED ? "been cancelled" : "failed");
+      msc_war(buf);
+    }
+
+    pthread_mutex_lock(&jobs_lock);
+    job->result = job->state;
+    job->state = JOB_APPLIED;
+    destroy_ai_data(job->data);
+    job->data = NULL;
+    free(job->commands.text);
+    job->commands.text = NULL;
+    free(job->cache_key);
+    job->cache_key = NULL;
+
+    // only some applied jobs are kept for the jobs command
+    size_t applied = 0;
+    for(ai_job* j = jobs; j && j->state == JOB_APPLIED; j = j->next)
+      applied++;
+    while(applied-- > AI_JOBS_HISTORY)
+    {
+      ai_job* oldest = jobs;
+      jobs = oldest->next;
+      if(jobs_last == oldest)
+        jobs_last = NULL;
+      free(oldest->title);
+      free(oldest);
+    }
+    pthread_mutex_unlock(&jobs_lock);
+  }
+}
+
+void* _command_jobs(char** argv, int argc)
+{
+  static const char* const states[] = {"queued", "running", "done", "failed", "cancelled", "applied"};
+  long long now = now_ms();
+  int running = 0, queued = 0;
+
+  pthread_mutex_lock(&jobs_lock);
+  if(!jobs)
+  {
+    pthread_mutex_unlock(&jobs_lock);
+    msc_inf("No AI jobs.");
+    return NULL;
+  }
+  printf("%5s  %-10s %8s %8s %9s  %s\n", "#", "state", "waited", "took", "commands", "prompt");
+  for(ai_job* job = jobs; job; job = job->next)
+  {
+    long long started = (job->state == JOB_QUEUED) ? now : job->started_at;
+    long long finished = (job->state == JOB_QUEUED || job->state == JOB_RUNNING) ? now : job->finished_at;
+    char state[24];
+    if(job->state == JOB_APPLIED)
+      snprintf(state, sizeof(state), "%s", job->result == JOB_DONE ? "applied" : states[job->result]);
+    else
+      snprintf(state, sizeof(state), "%s", states[job->state]);
+    if(job->from_cache)
+      strcat(state, "*");
+    running += job->state == JOB_RUNNING;
+    queued += job->state == JOB_QUEUED;
+
+    printf("%5u  %-10s %7.1fs %7.1fs %9zu  %.40s%s\n", job->id, state,
+      (started - job->queued_at) / 1000.0, (finished - started) / 1000.0,
+      job->commands.count, job->title, strlen(job->title) > 40 ? "..." : "");
+  }
+  printf("%d running, %d queued (up to %d at once), * - answered from the cache\n", running, queued, AI_MAX_PARALLEL);
+  pthread_mutex_unlock(&jobs_lock);
+  return NULL;
+}
 
 void* _command_ai(char** argv, int argc)
 {
+  bool stream = FALSE;
+  bool with_graph = FALSE;
+  bool in_background = FALSE;
+  bool use_cache = TRUE;
+  bool bulk = FALSE;
+  bool structured = FALSE;
+  for(int i = 0; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-s") == 0)
+      stream = TRUE;
+    else if(strcmp(argv[i], "-g") == 0)
+      with_graph = TRUE;
+    else if(strcmp(argv[i], "-b") == 0)
+      in_background = TRUE;
+    else if(strcmp(argv[i], "-n") == 0)
+      use_cache = FALSE;
+    else if(strcmp(argv[i], "-a") == 0)
+      bulk = TRUE;
+    else if(strcmp(argv[i], "-j") == 0)
+      structured = bulk = TRUE;
+    else
+    {
+      msc_err("Invalid flag (only -s, -g, -b, -n, -a and -j are known).");
+      return NULL;
+    }
+  }
 
   puts("Please enter prompt for AI:");
   char* user_input = get_infinite_user_input();
-  ai_data* user_data = create_ai_data();
 
+  // the same conversation is continued until aireset
+  if(!session && !(session = create_ai_data()))
+  {
+    free(user_input);
+    msc_err("Critical memory error. Closing...");
+    exit(EXIT_FAILURE);
+  }
+  ai_data* user_data = session;
 
-  user_data->prompt = calloc(strlen(prompt_header)+strlen(user_input)+1,sizeof(char));
-  memcpy(user_data->prompt,prompt_header,strlen(prompt_header));
+
+  // the graph goes after the user input, so the AI knows which vertices exist
+  const char* graph_text = NULL;
+  if(with_graph && !(graph_text = describe_graph()))
+    msc_war("Could not describe the graph, the prompt is sent without it.");
+  const char* graph_header = "\nCurrent graph:\n";
+  const char* header = structured ? structured_header : prompt_header;
+  size_t prompt_length = strlen(header) + strlen(user_input) + 1;
+  if(graph_text)
+    prompt_length += strlen(graph_header) + strlen(graph_text);
+
+  if(user_data->prompt)
+    free(user_data->prompt);
+  user_data->prompt = calloc(prompt_length,sizeof(char));
+  memcpy(user_data->prompt,header,strlen(header));
+  user_data->structured = structured;
   strcat(user_data->prompt,user_input);
+  if(graph_text)
+  {
+    strcat(user_data->prompt,graph_header);
+    strcat(user_data->prompt,graph_text);
+  }
+
+  // the same question about the same graph gets the same answer, without asking the model;
+  // one referring to earlier prompts of the conversation is neither looked up nor stored
+  bool follow_up = user_data->turns++ > 0 && ai_cache_follow_up(user_input);
+  char* cache_key = follow_up ? NULL : ai_cache_key(model_name, user_data->system, user_input, graph_text);
+  // JSON edits and commands are different answers to the same question
+  if(cache_key && structured)
+  {
+    char* json_key = malloc(strlen(cache_key) + 6);
+    if(json_key)
+      sprintf(json_key, "json\n%s", cache_key);
+    free(cache_key);
+    cache_key = json_key;
+  }
+  char* cached = (cache_key && use_cache) ? ai_cache_get(cache_key) : NULL;
+
+  // the graph can be edited meanwhile, the answer is reviewed in the main loop;
+  // the job gets its own copy of the conversation, so more jobs can run at once
+  if(in_background)
+  {
+    ai_data* job_data = create_ai_data();
+    if(job_data)
+    {
+      free(job_data->context);
+      free(job_data->system);
+      job_data->context = strdup(user_data->context);
+      job_data->system = strdup(user_data->system);
+      job_data->prompt = strdup(user_data->prompt);
+      job_data->stream = stream;
+      job_data->structured = structured;
+    }
+    if(!job_data || !job_data->context || !job_data->system || !job_data->prompt ||
+       !submit_job(job_data, user_input, cache_key, cached, bulk))
+    {
+      if(job_data)
+        destroy_ai_data(job_data);
+      free(cache_key);
+      free(cached);
+      msc_err("Could not queue the AI request.");
+    }
+    free(user_input);
+    return NULL;
+  }
   free(user_input);
 
-  user_data = speak_to_ollama(user_data);
-  char* returned_command_list = user_data->response;
-
-  // remove those stupid \n which ai keeps adding to response
-  char* pos;
-  while ((pos = strstr(returned_command_list, "\\n")) != NULL)
-    memmove(pos, pos + 2, strlen(pos + 2) + 1);
-
-  char* command = strtok(returned_command_list,";");
-  puts("AI converted prompt to following commands:");
-  while(command)
-  {
-    puts(command);
-    puts("Execute? (Y/N)");
-    char input = 'n';
-    fflush(stdin);
-    scanf("%c",&input);
-    clear_stdin();
-    if(input == 'Y' || input == 'y')
-      {
-        char* command_copy = malloc((strlen(command)+1)*sizeof(char));
-        // remove starting whitespaces
-        char* command_beg = command;
-        while(*command_beg == ' ')
-          command_beg++;
-        memcpy(command_copy,command_beg,strlen(command));
-        cmd_run(command_copy,0);
-        free(command_copy);
-      }
-    command = strtok(NULL,";");
+  bool first = TRUE;
+  if(cached)
+  {
+    msc_inf("The answer is taken from the cache (ai -n asks the model again).");
+    command_list commands = {cached, strlen(cached), strlen(cached) + 1, 0};
+    if(structured)
+      structured_review(cached);
+    else if(bulk)
+      bulk_review(&commands, &first);
+    else
+      confirm_list(&commands, &first);
+    free(cached);
+    free(cache_key);
+    return NULL;
+  }
+
+  stream_review review = {TRUE, {NULL, 0, 0, 0}};
+  begin_request();
+  // a whole answer is needed before it can be applied at once
+  if(stream && !bulk)
+  {
+    // commands are confirmed while the model keeps generating
+    speak_to_ollama_stream(user_data, confirm_and_keep, &review);
+  }
+  else
+  {
+    user_data = speak_to_ollama(user_data);
+    if(structured && user_data->response)
+      count_edits(&review.commands, user_data->response);
+    // the response is unescaped, so newlines separate commands as well
+    char* command = (user_data->response && !structured) ? strtok(user_data->response,";\n") : NULL;
+    while(command)
+    {
+      add_command(&review.commands, command);
+      command = strtok(NULL,";\n");
+    }
+    if(structured && review.commands.text)
+      structured_review(review.commands.text);
+    else if(bulk)
+      bulk_review(&review.commands, &first);
+    else
+      confirm_list(&review.commands, &first);
   }
-  destroy_ai_data(user_data);
+  end_request();
 
+  if(user_data->response && review.commands.count && cache_key)
+    ai_cache_put(cache_key, review.commands.text);
+  free(review.commands.text);
+  free(cache_key);
+  return NULL;
+}
+
+void* _command_ai_cache(char** argv, int argc)
+{
+  if(argc == 1 && strcmp(argv[0], "-c") == 0)
+  {
+    ai_cache_clear();
+    msc_inf("AI cache has been cleared.");
+    return NULL;
+  }
+  if(argc > 0)
+  {
+    msc_err("Invalid flag (only -c is known).");
+    return NULL;
+  }
+  char buf[GLO_MAX_MSG_OUTPUT];
+  snprintf(buf, sizeof(buf), "AI cache keeps %zu answer(s).", ai_cache_size());
+  msc_inf(buf);
   return NULL;
 }
 
-//TheNeverMan 2025
+//TheNeverMan 2025
\ No newline at end of file
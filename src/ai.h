@@ -1,28 +1,51 @@
 #pragma once
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "ai_cache.h"
 #include "http.h"
+#include "json.h"
 #include "command.h"
+#include "edit.h"
+#include "graph.h"
 #include "misc.h"
 
+typedef int bool;
+#define TRUE 255
+#define FALSE 0
+
 typedef struct _ai_data
 {
   char* context;
   char* response;
   char* prompt;
   char* system;
+  bool stream;
+  bool structured;           // asks for JSON edits (ai -j)
+  size_t turns;              // # of prompts asked in the conversation
 } ai_data;
 
-typedef int bool;
-#define TRUE 255
-#define FALSE 0
+// called for every complete command while the response is streamed
+typedef void (*ai_command_callback)(const char* command, void* arg);
 
-int send_post_request_to_ai(int sd, struct http_url* url, ai_data* ai_prompt);
+ai_data* create_ai_data();
+void destroy_ai_data(ai_data* data);
+int send_post_request_to_ai(int sd, struct http_io* io, ai_data* ai_prompt);
 ai_data* speak_to_ollama(ai_data* ai_prompt);
+ai_data* speak_to_ollama_stream(ai_data* ai_prompt, ai_command_callback on_command, void* arg);
 bool check_if_ollama_exists();
+void ai_bind_graph(graph_t** graph);
+// confirms commands of finished background jobs, in submission order (called from the main loop)
+void ai_review(void);
 void* _command_ai(char** argv, int argc);
 void* _command_ai_test(char** argv, int argc);
 void* _command_ai_model(char** argv, int argc);
+void* _command_ai_reset(char** argv, int argc);
+void* _command_jobs(char** argv, int argc);
+void* _command_ai_cache(char** argv, int argc);
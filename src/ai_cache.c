@@ -0,0 +1,328 @@
+#include <ctype.h>
+#include <pthread.h>
+
+#include "ai_cache.h"
+
+// prompt-to-commands answers, an open addressing hash map (linear probing)
+typedef struct _ai_cache_entry
+{
+  uint64_t hash;
+  char* key;           // NULL if the slot is free
+  char* commands;
+} ai_cache_entry;
+
+static ai_cache_entry* cache = NULL;
+static size_t cache_capacity = 0;   // always a power of 2
+static size_t cache_count = 0;
+static int cache_loaded = 0;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t ai_cache_hash(const char* text, size_t length)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for(size_t i = 0; i < length; i++)
+  {
+    hash ^= (unsigned char)text[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// lower case, single spaces, no surrounding spaces and no final punctuation,
+// so "Clear the graph." and "clear  the graph" are the same question
+static char* normalize_prompt(const char* prompt)
+{
+  size_t length = 0;
+  char* out = malloc(strlen(prompt) + 1);
+  if(!out)
+    return NULL;
+  for(const char* c = prompt; *c; c++)
+  {
+    if(isspace((unsigned char)*c))
+    {
+      if(length && out[length-1] != ' ')
+        out[length++] = ' ';
+      continue;
+    }
+    out[length++] = tolower((unsigned char)*c);
+  }
+  while(length && strchr(" .!?", out[length-1]))
+    length--;
+  out[length] = '\0';
+  return out;
+}
+
+char* ai_cache_key(const char* model, const char* system, const char* prompt, const char* graph_text)
+{
+  char* normalized = normalize_prompt(prompt);
+  if(!normalized)
+    return NULL;
+  uint64_t system_hash = ai_cache_hash(system, strlen(system));
+  uint64_t graph_hash = graph_text ? ai_cache_hash(graph_text, strlen(graph_text)) : 0;
+
+  size_t key_length = strlen(model) + strlen(normalized) + 2 * 16 + 4;
+  char* key = malloc(key_length);
+  if(key)
+    snprintf(key, key_length, "%s\n%016llx\n%016llx\n%s", model,
+      (unsigned long long)system_hash, (unsigned long long)graph_hash, normalized);
+  free(normalized);
+  return key;
+}
+
+// words pointing back at the conversation; a false alarm only costs a cache miss
+static const char* const follow_up_words[] = {
+  "it", "its", "this", "that", "these", "those", "them", "they", "same", "previous", "above", "before",
+  "earlier", "again", "next", "other", "another", "more", "too", "also", "instead", "undo", "back", "then"
+};
+
+int ai_cache_follow_up(const char* prompt)
+{
+  char* normalized = normalize_prompt(prompt);
+  if(!normalized)
+    return 1;
+  int found = 0;
+  for(char* word = strtok(normalized, " ,.;:!?\"'()"); word && !found; word = strtok(NULL, " ,.;:!?\"'()"))
+    for(size_t i = 0; i < sizeof(follow_up_words) / sizeof(follow_up_words[0]) && !found; i++)
+      found = strcmp(word, follow_up_words[i]) == 0;
+  free(normalized);
+  return found;
+}
+
+static const char* cache_path(void)
+{
+  const char* path = getenv("GRAPH_AI_CACHE");
+  return (path && *path) ? path : AI_CACHE_FILE;
+}
+
+// finds the slot of the key (or the free slot it would go to); cache must not be empty
+static ai_cache_entry* find_slot(const char* key, uint64_t hash)
+{
+  size_t i = hash & (cache_capacity - 1);
+  while(cache[i].key && (cache[i].hash != hash || strcmp(cache[i].key, key) != 0))
+    i = (i + 1) & (cache_capacity - 1);
+  return &cache[i];
+}
+
+// takes over key and commands (not if it fails or the cache is full)
+static int insert(char* key, char* commands)
+{
+  // kept at most 3/4 full, so probing stays short
+  if((cache_count + 1) * 4 > cache_capacity * 3)
+  {
+    size_t old_capacity = cache_capacity;
+    ai_cache_entry* old = cache;
+    size_t new_capacity = old_capacity ? old_capacity * 2 : 64;
+    ai_cache_entry* grown = calloc(new_capacity, sizeof(ai_cache_entry));
+    if(!grown)
+      return -1;
+    cache = grown;
+    cache_capacity = new_capacity;
+    for(size_t i = 0; i < old_capacity; i++)
+      if(old[i].key)
+        *find_slot(old[i].key, old[i].hash) = old[i];
+    free(old);
+  }
+
+  uint64_t hash = ai_cache_hash(key, strlen(key));
+  ai_cache_entry* slot = find_slot(key, hash);
+  if(slot->key)
+  {
+    // newer answer wins
+    free(key);
+    free(slot->commands);
+    slot->commands = commands;
+    return 0;
+  }
+  if(cache_count >= AI_CACHE_MAX_ENTRIES)
+    return 1;
+  slot->hash = hash;
+  slot->key = key;
+  slot->commands = commands;
+  cache_count++;
+  return 0;
+}
+
+// one line of the file
+static int write_entry(FILE* file, const char* key, const char* commands)
+{
+  struct json_writer line;
+  json_writer_init(&line);
+  json_write_raw(&line, "{\"key\":");
+  json_write_string(&line, key);
+  json_write_raw(&line, ",\"commands\":");
+  json_write_string(&line, commands);
+  json_write_raw(&line, "}\n");
+  int ok = !line.error && fwrite(line.buf, 1, line.length, file) == line.length;
+  json_writer_free(&line);
+  return ok ? 0 : -1;
+}
+
+// rewrites the file with just the answers in memory, so replaced
+// and broken lines do not pile up; a failed rewrite keeps the old file
+static void compact(void)
+{
+  const char* path = cache_path();
+  char* temp = malloc(strlen(path) + 5);
+  if(!temp)
+    return;
+  sprintf(temp, "%s.tmp", path);
+
+  FILE* file = fopen(temp, "wb");
+  int ok = file != NULL;
+  for(size_t i = 0; ok && i < cache_capacity; i++)
+    if(cache[i].key)
+      ok = write_entry(file, cache[i].key, cache[i].commands) == 0;
+  if(file && fclose(file) != 0)
+    ok = 0;
+
+  // Windows does not replace an existing file
+  if(ok && rename(temp, path) != 0)
+    ok = remove(path) == 0 && rename(temp, path) == 0;
+  if(!ok)
+    remove(temp);
+  free(temp);
+}
+
+// the file is one JSON object per line: {"key":"...","commands":"..."}
+typedef struct _cache_loader
+{
+  char field[16];
+  char* key;
+  char* commands;
+  size_t lines;        // # of lines read, more than the answers kept if some are stale
+} cache_loader;
+
+static int on_cache_event(void* arg, enum json_event event, const char* value, size_t length, int depth)
+{
+  cache_loader* loader = arg;
+  if(event == JSON_KEY && depth == 1)
+  {
+    size_t field_length = length < sizeof(loader->field) - 1 ? length : sizeof(loader->field) - 1;
+    memcpy(loader->field, value, field_length);
+    loader->field[field_length] = '\0';
+  }
+  else if(event == JSON_STRING && depth == 1)
+  {
+    char** target = strcmp(loader->field, "key") == 0 ? &loader->key :
+                    strcmp(loader->field, "commands") == 0 ? &loader->commands : NULL;
+    if(!target)
+      return 0;
+    free(*target);
+    if(!(*target = malloc(length + 1)))
+      return -1;
+    memcpy(*target, value, length);
+    (*target)[length] = '\0';
+  }
+  else if(event == JSON_OBJECT_END && depth == 0)
+  {
+    loader->lines++;
+    if(loader->key && loader->commands && insert(loader->key, loader->commands) == 0)
+      loader->key = loader->commands = NULL;
+    free(loader->key);
+    free(loader->commands);
+    loader->key = loader->commands = NULL;
+  }
+  return 0;
+}
+
+// reads the file once, a broken line only loses what follows it
+static void load(void)
+{
+  if(cache_loaded)
+    return;
+  cache_loaded = 1;
+
+  FILE* file = fopen(cache_path(), "rb");
+  if(!file)
+    return;
+  struct json_parser parser;
+  cache_loader loader;
+  memset(&loader, 0, sizeof(loader));
+  json_init(&parser, on_cache_event, &loader);
+
+  char buf[65536];
+  size_t bytes;
+  while((bytes = fread(buf, 1, sizeof(buf), file)) > 0)
+    if(json_feed(&parser, buf, bytes))
+      break;
+
+  json_free(&parser);
+  free(loader.key);
+  free(loader.commands);
+  fclose(file);
+
+  if(loader.lines > cache_count)
+    compact();
+}
+
+char* ai_cache_get(const char* key)
+{
+  char* commands = NULL;
+  pthread_mutex_lock(&cache_lock);
+  load();
+  if(cache_count)
+  {
+    ai_cache_entry* slot = find_slot(key, ai_cache_hash(key, strlen(key)));
+    if(slot->key)
+      commands = strdup(slot->commands);
+  }
+  pthread_mutex_unlock(&cache_lock);
+  return commands;
+}
+
+void ai_cache_put(const char* key, const char* commands)
+{
+  char* key_copy = strdup(key);
+  char* commands_copy = strdup(commands);
+  if(!key_copy || !commands_copy)
+  {
+    free(key_copy);
+    free(commands_copy);
+    return;
+  }
+
+  pthread_mutex_lock(&cache_lock);
+  load();
+  if(insert(key_copy, commands_copy))
+  {
+    free(key_copy);
+    free(commands_copy);
+    pthread_mutex_unlock(&cache_lock);
+    return;
+  }
+
+  // appended, so storing an answer does not rewrite the whole file
+  // (a replaced answer leaves its old line, dropped on the next load)
+  FILE* file = fopen(cache_path(), "ab");
+  if(file)
+  {
+    write_entry(file, key, commands);
+    fclose(file);
+  }
+  pthread_mutex_unlock(&cache_lock);
+}
+
+size_t ai_cache_size(void)
+{
+  pthread_mutex_lock(&cache_lock);
+  load();
+  size_t count = cache_count;
+  pthread_mutex_unlock(&cache_lock);
+  return count;
+}
+
+void ai_cache_clear(void)
+{
+  pthread_mutex_lock(&cache_lock);
+  for(size_t i = 0; i < cache_capacity; i++)
+  {
+    free(cache[i].key);
+    free(cache[i].commands);
+  }
+  free(cache);
+  cache = NULL;
+  cache_capacity = cache_count = 0;
+  cache_loaded = 1;
+  remove(cache_path());
+  pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+// file the cache is kept in between runs (can be changed with the GRAPH_AI_CACHE variable)
+#define AI_CACHE_FILE ".graph_ai_cache.json"
+// answers kept at most, new questions are not cached once it is full
+#define AI_CACHE_MAX_ENTRIES 4096
+
+// 64-bit FNV-1a hash
+uint64_t ai_cache_hash(const char* text, size_t length);
+
+// makes a cache key out of everything the answer depends on, graph_text can be NULL
+char* ai_cache_key(const char* model, const char* system, const char* prompt, const char* graph_text);
+
+// tells if a prompt refers to earlier ones ("and the next one?"), its answer depends on the conversation
+int ai_cache_follow_up(const char* prompt);
+
+// gives a copy of the cached (newline separated) command list or NULL
+char* ai_cache_get(const char* key);
+
+// remembers the command list in memory and in the cache file
+void ai_cache_put(const char* key, const char* commands);
+
+// gives # of cached answers
+size_t ai_cache_size(void);
+
+// forgets everything (the file too)
+void ai_cache_clear(void);
@@ -0,0 +1,535 @@
+/*
+ *  algo.c
+ *
+ *  Extends "algo.h".
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifdef __SSE4_2__
+    #include <nmmintrin.h>
+#endif
+
+#include "algo.h"
+#include "misc.h"
+
+#define ALG_TRI_CHUNK           64u     /* TRIANGLES: # of vertices taken by a worker at once */
+
+
+/* Compact (CSR) adjacency, used internally */
+typedef struct _alg_csr_t
+{
+    size_t     *_off;           /* Offsets, n + 1 elements */
+    index_t    *_adj;           /* All the lists, one after another */
+
+} csr_t;
+
+/* TRIANGLES: shared worker state */
+typedef struct _alg_tri_job_t
+{
+    const csr_t    *_fwd;       /* Forward (degree-ordered) adjacency */
+    size_t          _n;         /* # of vertices */
+    atomic_size_t   _next;      /* Next vertex to be taken */
+
+} tri_job_t;
+
+/* TRIANGLES: single worker state */
+typedef struct _alg_tri_wrk_t
+{
+    tri_job_t      *_job;       /* Shared state */
+    uint32_t       *_tri;       /* Private per-vertex counters */
+    size_t          _total;     /* Private # of triangles */
+
+} tri_wrk_t;
+
+
+/* Intersects two ascending, duplicate-free lists.
+ * Each common element gets its counter incremented.
+ *
+ *  a, na       - 1st list and its length
+ *  b, nb       - 2nd list and its length
+ *  tri         - per-vertex counters
+ *
+ * Returns # of common elements.
+ */
+static size_t _alg_isect(const index_t *a, size_t na, const index_t *b, size_t nb, uint32_t *tri)
+{
+    size_t i = 0u, j = 0u, found = 0u;
+
+#ifdef __SSE4_2__
+    /* 8 x 8 all-pairs comparison per step */
+    while(i + 8u <= na && j + 8u <= nb)
+    {
+        const __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i *)(b + j));
+
+        /* Bit k is set if a[i + k] is anywhere in vb */
+        unsigned mask = (unsigned) _mm_cvtsi128_si32(_mm_cmpestrm(vb, 8, va, 8,
+            _SIDD_UWORD_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK));
+
+        while(mask)
+        {
+            const int k = __builtin_ctz(mask);
+            ++tri[a[i + k]];
+            ++found;
+            mask &= mask - 1u;
+        }
+
+        const index_t amax = a[i + 7u];
+        const index_t bmax = b[j + 7u];
+
+        if(amax <= bmax)
+            i += 8u;
+        if(bmax <= amax)
+            j += 8u;
+    }
+#endif
+
+    /* Scalar merge (the rest) */
+    while(i < na && j < nb)
+    {
+        if(a[i] < b[j])
+            ++i;
+        else if(a[i] > b[j])
+            ++j;
+        else
+        {
+            ++tri[a[i]];
+            ++found;
+            ++i;
+            ++j;
+        }
+    }
+
+    return found;
+}
+
+/* TRIANGLES: worker routine */
+static void *_alg_tri_run(void *arg)
+{
+    tri_wrk_t *w = (tri_wrk_t *) arg;
+    const csr_t *f = w->_job->_fwd;
+
+    while(1)
+    {
+        const size_t beg = atomic_fetch_add(&w->_job->_next, ALG_TRI_CHUNK);
+        if(beg >= w->_job->_n)
+            break;
+
+        const size_t end = (beg + ALG_TRI_CHUNK < w->_job->_n) ? beg + ALG_TRI_CHUNK : w->_job->_n;
+
+        /* For each arch u -> v of the forward graph */
+        for(size_t u = beg; u < end; ++u)
+        {
+            for(size_t k = f->_off[u]; k < f->_off[u + 1u]; ++k)
+            {
+                const index_t v = f->_adj[k];
+                const size_t found = _alg_isect(f->_adj + f->_off[u], f->_off[u + 1u] - f->_off[u],
+                                                f->_adj + f->_off[v], f->_off[v + 1u] - f->_off[v], w->_tri);
+
+                w->_tri[u] += found;
+                w->_tri[v] += found;
+                w->_total  += found;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Builds undirected, simple, sorted adjacency of the graph.
+ *
+ *  graph       - the graph
+ *  o_csr       - OUT, the adjacency
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _alg_und(const graph_t *graph, csr_t *o_csr)
+{
+    const size_t n = graph->_n;
+
+    if((o_csr->_off = (size_t *) calloc(n + 1u, sizeof(size_t))) == NULL)
+        return -1;
+
+    /* Counting (both directions, dups included) */
+    for(size_t u = 0u; u < n; ++u)
+    {
+        for(size_t j = 0u; j < graph->_list[u]->_narch; ++j)
+        {
+            const index_t v = graph->_list[u]->_arch[j];
+            if(v == u || v >= n)
+                continue;
+
+            ++o_csr->_off[u + 1u];
+            ++o_csr->_off[v + 1u];
+        }
+    }
+
+    /* Prefix sums */
+    for(size_t u = 0u; u < n; ++u)
+        o_csr->_off[u + 1u] += o_csr->_off[u];
+
+    if((o_csr->_adj = (index_t *) malloc(sizeof(index_t) * (o_csr->_off[n] + 1u))) == NULL)
+    {
+        free(o_csr->_off);
+        return -1;
+    }
+
+    /* Scatter */
+    size_t *pos = NULL;
+    if((pos = (size_t *) malloc(sizeof(size_t) * (n + 1u))) == NULL)
+    {
+        free(o_csr->_adj);
+        free(o_csr->_off);
+        return -1;
+    }
+    memcpy(pos, o_csr->_off, sizeof(size_t) * (n + 1u));
+
+    for(size_t u = 0u; u < n; ++u)
+    {
+        for(size_t j = 0u; j < graph->_list[u]->_narch; ++j)
+        {
+            const index_t v = graph->_list[u]->_arch[j];
+            if(v == u || v >= n)
+                continue;
+
+            o_csr->_adj[pos[u]++] = v;
+            o_csr->_adj[pos[v]++] = (index_t) u;
+        }
+    }
+
+    /* Sorting and deleting dups, compacting in place */
+    size_t k = 0u;
+    for(size_t u = 0u; u < n; ++u)
+    {
+        const size_t beg = o_csr->_off[u];
+        const size_t len = o_csr->_off[u + 1u] - beg;
+
+        qsort(o_csr->_adj + beg, len, sizeof(index_t), _gph_sort_asc);
+
+        o_csr->_off[u] = k;
+        for(size_t j = 0u; j < len; ++j)
+        {
+            if(j > 0u && o_csr->_adj[beg + j] == o_csr->_adj[beg + j - 1u])
+                continue;
+
+            o_csr->_adj[k++] = o_csr->_adj[beg + j];
+        }
+    }
+    o_csr->_off[n] = k;
+
+    free(pos);
+    return 0;
+}
+
+/* Counts triangles of the undirected graph underlying the given one
+ * (arch directions, duplicates and self-loops are ignored).
+ * Vertices are ordered by degree, sorted adjacency lists are intersected
+ * and the work is split across GLO_MAX_THREADS threads at most.
+ *
+ *  graph       - the graph to be analysed
+ *  o_tri       - OUT, # of triangles per vertex (graph->_n elements), can be NULL
+ *  o_deg       - OUT, undirected degree per vertex (graph->_n elements), can be NULL
+ *
+ * Returns # of triangles or -1 if failed.
+ */
+size_t alg_tri(const graph_t *graph, size_t *o_tri, size_t *o_deg)
+{
+    assert(graph);
+
+    const size_t n = graph->_n;
+    size_t total = 0u;
+
+    if(n == 0u)
+        return 0u;
+
+    csr_t und = {0, }, fwd = {0, };
+    if(_alg_und(graph, &und) != 0)
+        return (size_t) -1;
+
+    if(o_deg)
+    {
+        for(size_t u = 0u; u < n; ++u)
+            o_deg[u] = und._off[u + 1u] - und._off[u];
+    }
+
+    /* Forward graph: only arches towards higher (degree, index) rank */
+    /* The lists stay sorted by index, so they can be merged directly */
+    if((fwd._off = (size_t *) malloc(sizeof(size_t) * (n + 1u))) == NULL ||
+       (fwd._adj = (index_t *) malloc(sizeof(index_t) * (und._off[n] / 2u + 1u))) == NULL)
+    {
+        free(fwd._off);
+        free(und._off);
+        free(und._adj);
+        return (size_t) -1;
+    }
+
+    size_t k = 0u;
+    for(size_t u = 0u; u < n; ++u)
+    {
+        const size_t du = und._off[u + 1u] - und._off[u];
+
+        fwd._off[u] = k;
+        for(size_t j = und._off[u]; j < und._off[u + 1u]; ++j)
+        {
+            const index_t v = und._adj[j];
+            const size_t dv = und._off[v + 1u] - und._off[v];
+
+            if(du < dv || (du == dv && u < v))
+                fwd._adj[k++] = v;
+        }
+    }
+    fwd._off[n] = k;
+
+    free(und._off);
+    free(und._adj);
+
+    /* Workers */
+    size_t nthr = msc_cpu();
+    if(nthr > n / ALG_TRI_CHUNK + 1u)
+        nthr = n / ALG_TRI_CHUNK + 1u;
+
+    tri_job_t job;
+    job._fwd = &fwd;
+    job._n   = n;
+    atomic_init(&job._next, 0u);
+
+    tri_wrk_t wrk[GLO_MAX_THREADS];
+    pthread_t thr[GLO_MAX_THREADS];
+    size_t started = 0u;
+    int failed = 0;
+
+    for(size_t t = 0u; t < nthr; ++t)
+    {
+        wrk[t]._job   = &job;
+        wrk[t]._total = 0u;
+
+        if((wrk[t]._tri = (uint32_t *) calloc(n, sizeof(uint32_t))) == NULL)
+        {
+            failed = 1;
+            break;
+        }
+
+        /* The 1st worker is the calling thread */
+        if(t > 0u && pthread_create(&thr[t], NULL, _alg_tri_run, &wrk[t]) != 0)
+        {
+            free(wrk[t]._tri);
+            break;
+        }
+        ++started;
+    }
+
+    if(started > 0u)
+        _alg_tri_run(&wrk[0u]);
+
+    /* Joining and reducing */
+    if(o_tri)
+        memset(o_tri, 0, sizeof(size_t) * n);
+
+    for(size_t t = 0u; t < started; ++t)
+    {
+        if(t > 0u)
+            pthread_join(thr[t], NULL);
+
+        total += wrk[t]._total;
+        for(size_t u = 0u; u < n && o_tri; ++u)
+            o_tri[u] += wrk[t]._tri[u];
+
+        free(wrk[t]._tri);
+    }
+
+    free(fwd._off);
+    free(fwd._adj);
+
+    if(failed || started == 0u)
+        return (size_t) -1;
+
+    return total;
+}
+
+/* Gives histogram bucket of the degree */
+static size_t _alg_bucket(size_t deg)
+{
+    size_t b = 0u;
+    while(deg > 0u && b < ALG_PRF_BUCKETS - 1u)
+    {
+        deg >>= 1u;
+        ++b;
+    }
+
+    return b;
+}
+
+/* Profiles the graph in a single O(V + E) pass.
+ *
+ *  graph       - the graph to be analysed
+ *  o_prf       - OUT, the profile
+ *
+ * Returns 0 or -1 if failed.
+ */
+int alg_prf(const graph_t *graph, profile_t *o_prf)
+{
+    assert(graph && o_prf);
+
+    const size_t n = graph->_n;
+
+    memset(o_prf, 0, sizeof(profile_t));
+    o_prf->_n = n;
+    o_prf->_mem = sizeof(graph_t) + sizeof(vertex_t *) * graph->_nmem;
+    o_prf->_mem_mtx = sizeof(graph_t) + (n * n + 7u) / 8u;
+
+    if(n == 0u)
+        return 0;
+
+    /* In-arches (CSR) and a stamp per vertex */
+    size_t *off = NULL, *stamp = NULL;
+    index_t *in = NULL;
+
+    if((off = (size_t *) calloc(n + 1u, sizeof(size_t))) == NULL ||
+       (stamp = (size_t *) malloc(sizeof(size_t) * n)) == NULL)
+    {
+        free(off);
+        return -1;
+    }
+
+    /* Out-degrees, in-degrees, loops, memory */
+    for(size_t u = 0u; u < n; ++u)
+    {
+        const vertex_t *v = graph->_list[u];
+
+        o_prf->_narch += v->_narch;
+        o_prf->_mem   += sizeof(vertex_t) + sizeof(index_t) * ((v->_narch > 0u) ? v->_narch : 1u);
+
+        ++o_prf->_out_hist[_alg_bucket(v->_narch)];
+        if(v->_narch > o_prf->_out_max)
+            o_prf->_out_max = v->_narch;
+
+        for(size_t j = 0u; j < v->_narch; ++j)
+        {
+            if(v->_arch[j] == u)
+                ++o_prf->_loops;
+            else if(v->_arch[j] < n)
+                ++off[v->_arch[j] + 1u];
+        }
+    }
+
+    for(size_t u = 0u; u < n; ++u)
+    {
+        /* Loops count as in-arches too */
+        size_t deg = off[u + 1u];
+        for(size_t j = 0u; j < graph->_list[u]->_narch; ++j)
+            deg += (graph->_list[u]->_arch[j] == u);
+
+        ++o_prf->_in_hist[_alg_bucket(deg)];
+        if(deg > o_prf->_in_max)
+            o_prf->_in_max = deg;
+
+        off[u + 1u] += off[u];
+    }
+
+    if((in = (index_t *) malloc(sizeof(index_t) * (off[n] + 1u))) == NULL)
+    {
+        free(off);
+        free(stamp);
+        return -1;
+    }
+
+    for(size_t u = 0u; u < n; ++u)
+    {
+        for(size_t j = 0u; j < graph->_list[u]->_narch; ++j)
+        {
+            const index_t v = graph->_list[u]->_arch[j];
+            if(v != u && v < n)
+                in[off[v]++] = (index_t) u;
+        }
+    }
+
+    /* Offsets were moved by one vertex during the scatter */
+    for(size_t u = n; u > 0u; --u)
+        off[u] = off[u - 1u];
+    off[0u] = 0u;
+
+    /* Reciprocity: A -> B is reciprocal if B is among in-arches of A */
+    size_t recip = 0u;
+    for(size_t u = 0u; u < n; ++u)
+        stamp[u] = (size_t) -1;
+
+    for(size_t u = 0u; u < n; ++u)
+    {
+        for(size_t j = off[u]; j < off[u + 1u]; ++j)
+            stamp[in[j]] = u;
+
+        for(size_t j = 0u; j < graph->_list[u]->_narch; ++j)
+        {
+            const index_t v = graph->_list[u]->_arch[j];
+            if(v != u && v < n && stamp[v] == u)
+                ++recip;
+        }
+    }
+
+    o_prf->_mean    = (double) o_prf->_narch / (double) n;
+    o_prf->_density = (double) o_prf->_narch / ((double) n * (double) n);
+    o_prf->_recip   = (o_prf->_narch > o_prf->_loops) ? (double) recip / (double) (o_prf->_narch - o_prf->_loops) : 0.0;
+
+    free(off);
+    free(stamp);
+    free(in);
+    return 0;
+}
+
+/* Traverses the graph breadth-first, following arches.
+ *
+ *  graph       - the graph to be traversed
+ *  src         - the first vertex
+ *  o_prev      - OUT, predecessor per vertex (graph->_n elements), GPH_LAST if not reached
+ *                (the first vertex is its own predecessor)
+ *  o_dist      - OUT, # of arches from src per vertex (graph->_n elements), can be NULL
+ *
+ * Returns # of reached vertices (src included) or -1 if failed.
+ */
+size_t alg_bfs(const graph_t *graph, index_t src, index_t *o_prev, size_t *o_dist)
+{
+    assert(graph && o_prev);
+
+    const size_t n = graph->_n;
+    if(src >= n)
+        return (size_t) -1;
+
+    /* Every vertex gets into the queue once at most */
+    index_t *queue = NULL;
+    if((queue = (index_t *) malloc(sizeof(index_t) * n)) == NULL)
+        return (size_t) -1;
+
+    for(size_t i = 0u; i < n; ++i)
+        o_prev[i] = GPH_LAST;
+
+    size_t head = 0u, tail = 0u;
+    queue[tail++] = src;
+    o_prev[src] = src;
+    if(o_dist)
+        o_dist[src] = 0u;
+
+    while(head < tail)
+    {
+        const index_t u = queue[head++];
+        const vertex_t *v = graph->_list[u];
+
+        for(size_t j = 0u; j < v->_narch; ++j)
+        {
+            const index_t w = v->_arch[j];
+            if(w >= n || o_prev[w] != GPH_LAST)
+                continue;
+
+            o_prev[w] = u;
+            if(o_dist)
+                o_dist[w] = o_dist[u] + 1u;
+            queue[tail++] = w;
+        }
+    }
+
+    free(queue);
+    return tail;
+}
@@ -0,0 +1,79 @@
+/*
+ *  algo.h
+ *
+ *  Graph algorithms working on top
+ *  of "graph.h". None of them modifies
+ *  the analysed graph.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_ALGO_H_FILE_
+#define _GRAPH_ALGO_H_FILE_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "graph.h"
+
+#define ALG_PRF_BUCKETS         17u     /* PROFILE: # of degree histogram buckets (0, 1, 2-3, 4-7, ...) */
+
+
+/* Graph profile */
+typedef struct _alg_profile_t
+{
+    size_t      _n;                         /* # of vertices */
+    size_t      _narch;                     /* # of arches */
+    size_t      _in_hist[ALG_PRF_BUCKETS];  /* In-degree histogram (log2 buckets) */
+    size_t      _out_hist[ALG_PRF_BUCKETS]; /* Out-degree histogram (log2 buckets) */
+    size_t      _in_max;                    /* Max. in-degree */
+    size_t      _out_max;                   /* Max. out-degree */
+    double      _mean;                      /* Mean degree (same for in and out) */
+    size_t      _loops;                     /* # of self-loops (A -> A) */
+    double      _density;                   /* Arches / possible arches */
+    double      _recip;                     /* Fraction of arches (loops excluded) with a reverse arch */
+    size_t      _mem;                       /* Memory used by the current representation in bytes */
+    size_t      _mem_mtx;                   /* Memory a bit matrix would use in bytes */
+
+} profile_t;
+
+
+/* Counts triangles of the undirected graph underlying the given one
+ * (arch directions, duplicates and self-loops are ignored).
+ * Vertices are ordered by degree, sorted adjacency lists are intersected
+ * and the work is split across GLO_MAX_THREADS threads at most.
+ *
+ *  graph       - the graph to be analysed
+ *  o_tri       - OUT, # of triangles per vertex (graph->_n elements), can be NULL
+ *  o_deg       - OUT, undirected degree per vertex (graph->_n elements), can be NULL
+ *
+ * Returns # of triangles or -1 if failed.
+ */
+size_t          alg_tri(const graph_t *graph, size_t *o_tri, size_t *o_deg);
+
+/* Profiles the graph in a single O(V + E) pass.
+ *
+ *  graph       - the graph to be analysed
+ *  o_prf       - OUT, the profile
+ *
+ * Returns 0 or -1 if failed.
+ */
+int             alg_prf(const graph_t *graph, profile_t *o_prf);
+
+/* Traverses the graph breadth-first, following arches.
+ *
+ *  graph       - the graph to be traversed
+ *  src         - the first vertex
+ *  o_prev      - OUT, predecessor per vertex (graph->_n elements), GPH_LAST if not reached
+ *                (the first vertex is its own predecessor)
+ *  o_dist      - OUT, # of arches from src per vertex (graph->_n elements), can be NULL
+ *
+ * Returns # of reached vertices (src included) or -1 if failed.
+ */
+size_t          alg_bfs(const graph_t *graph, index_t src, index_t *o_prev, size_t *o_dist);
+
+#endif /* _GRAPH_ALGO_H_FILE_ */
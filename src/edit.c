@@ -0,0 +1,866 @@
+/*
+ *  edit.c
+ *
+ *  Extends "edit.h".
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include "edit.h"
+
+#define EDT_DEF_SIZE            64u     /* Default allocation size of a batch */
+#define EDT_WHITESPACE          " \t\r\n"
+
+
+/* Gives # of arches */
+static size_t _edt_arches(const graph_t *graph)
+{
+    size_t n = 0u;
+    for(size_t i = 0u; i < graph->_n; ++i)
+        n += graph->_list[i]->_narch;
+
+    return n;
+}
+
+/* Splits off the next word (like strtok(), but
+ * re-entrant, so commands can be parsed by many threads).
+ *
+ *  pos         - IN/OUT, where the rest of the text begins
+ *
+ * Returns the word or NULL if there are no more.
+ */
+static char *_edt_tok(char **pos)
+{
+    char *word = *pos + strspn(*pos, EDT_WHITESPACE);
+    if(*word == '\0')
+    {
+        *pos = word;
+        return NULL;
+    }
+
+    char *end = word + strcspn(word, EDT_WHITESPACE);
+    if(*end != '\0')
+        *end++ = '\0';
+
+    *pos = end;
+    return word;
+}
+
+/* Reads a vertex index.
+ *
+ *  word        - the text
+ *  last        - if 'last' is allowed
+ *  o_index     - OUT, the index (GPH_LAST for 'last')
+ *
+ * Returns 0 or -1 if not an index.
+ */
+static int _edt_idx(const char *word, int last, index_t *o_index)
+{
+    if(last && strcmp(word, "last") == 0)
+    {
+        *o_index = GPH_LAST;
+        return 0;
+    }
+
+    char *end = NULL;
+    if(*word < '0' || *word > '9')
+        return -1;
+
+    const unsigned long index = strtoul(word, &end, 10);
+    if(*end != '\0' || index >= GPH_LAST)
+        return -1;
+
+    *o_index = (index_t) index;
+    return 0;
+}
+
+/* Prints a vertex index ('last' included) */
+static void _edt_put(FILE *stream, index_t index)
+{
+    if(index == GPH_LAST)
+        fprintf(stream, "last");
+    else
+        fprintf(stream, "%hu", index);
+}
+
+/* Checks if an index is valid in the graph, 'last' is resolved.
+ *
+ *  graph       - the graph
+ *  index       - IN/OUT, the index
+ *
+ * Returns 1 if valid.
+ */
+static int _edt_chk(const graph_t *graph, index_t *index)
+{
+    if(*index == GPH_LAST)
+    {
+        if(graph->_n == 0u)
+            return 0;
+
+        *index = (index_t) (graph->_n - 1u);
+    }
+
+    return *index < graph->_n;
+}
+
+/* Checks if a list contains an index */
+static int _edt_has(const index_t *list, size_t n, index_t index)
+{
+    for(size_t i = 0u; i < n; ++i)
+    {
+        if(list[i] == index)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Applies one edit.
+ *
+ *  graph       - IN/OUT, the graph (can be replaced)
+ *  batch       - the batch
+ *  e           - the edit
+ *  tot         - IN/OUT, # of arches of the graph
+ *  sum         - IN/OUT, summary
+ *
+ * Returns 0, EDT_BAD_* value if the edit is invalid or -1 if failed.
+ */
+static int _edt_one(graph_t **graph, const batch_t *batch, const edit_t *e, size_t *tot, edt_sum_t *sum)
+{
+    graph_t *g = *graph;
+    const index_t *list = batch->_pool + e->_off;
+
+    switch(e->_op)
+    {
+        case EDT_NEW:
+        {
+            graph_t *fresh = NULL;
+            if((fresh = gph_new(GLO_DEF_GRAPH_SIZE)) == NULL)
+                return -1;
+
+            sum->_vdel += g->_n;
+            sum->_adel += *tot;
+            *tot = 0u;
+
+            gph_fre(g);
+            *graph = fresh;
+            return 0;
+        }
+
+        case EDT_SIZE:
+        {
+            if(e->_cnt >= GPH_LAST)
+                return EDT_BAD_SIZE;
+
+            if(e->_cnt > g->_n)
+            {
+                sum->_vadd += e->_cnt - g->_n;
+                while(g->_n < e->_cnt)
+                {
+                    if(gph_add(g, NULL) != 1u)
+                        return -1;
+                }
+            }
+            else if(e->_cnt < g->_n)
+            {
+                sum->_vdel += g->_n - e->_cnt;
+                while(g->_n > e->_cnt)
+                    gph_del(g, GPH_LAST);
+
+                const size_t left = _edt_arches(g);
+                sum->_adel += *tot - left;
+                *tot = left;
+            }
+            return 0;
+        }
+
+        case EDT_ADD:
+        {
+            if(g->_n + 1u >= GPH_LAST)
+                return EDT_BAD_SIZE;
+
+            /* The new vertex can point to itself */
+            for(size_t i = 0u; i < e->_cnt; ++i)
+            {
+                if(list[i] > g->_n)
+                    return EDT_BAD_INDEX;
+            }
+
+            if(gph_add(g, NULL) != 1u)
+                return -1;
+            ++(sum->_vadd);
+
+            for(size_t i = 0u; i < e->_cnt; ++i)
+            {
+                const size_t r = gph_con(g, GPH_LAST, list[i], GPH_ADD);
+                if(r == (size_t) -1)
+                    return -1;
+
+                sum->_aadd += r;
+                *tot += r;
+            }
+            return 0;
+        }
+
+        case EDT_SET:
+        {
+            index_t a = e->_a;
+            if(!_edt_chk(g, &a))
+                return EDT_BAD_INDEX;
+
+            for(size_t i = 0u; i < e->_cnt; ++i)
+            {
+                index_t b = list[i];
+                if(!_edt_chk(g, &b))
+                    return EDT_BAD_INDEX;
+            }
+
+            /* Old arches are kept for the summary */
+            vertex_t *old = g->_list[a];
+            if((g->_list[a] = gph_new_vtx(NULL, 0u)) == NULL)
+            {
+                g->_list[a] = old;
+                return -1;
+            }
+
+            for(size_t i = 0u; i < e->_cnt; ++i)
+            {
+                if(gph_con(g, a, list[i], GPH_ADD) == (size_t) -1)
+                {
+                    gph_vfr(g, old);
+                    return -1;
+                }
+            }
+
+            const vertex_t *v = g->_list[a];
+            for(size_t i = 0u; i < old->_narch; ++i)
+                sum->_adel += !_edt_has(v->_arch, v->_narch, old->_arch[i]);
+            for(size_t i = 0u; i < v->_narch; ++i)
+                sum->_aadd += !_edt_has(old->_arch, old->_narch, v->_arch[i]);
+
+            *tot = *tot - old->_narch + v->_narch;
+            gph_vfr(g, old);
+            return 0;
+        }
+
+        case EDT_DEL:
+        {
+            index_t *tab = NULL;
+            if((tab = (index_t *) malloc(sizeof(index_t) * (e->_cnt ? e->_cnt : 1u))) == NULL)
+                return -1;
+
+            for(size_t i = 0u; i < e->_cnt; ++i)
+            {
+                if(list[i] != GPH_LAST && list[i] >= g->_n)
+                {
+                    free(tab);
+                    return EDT_BAD_INDEX;
+                }
+                tab[i] = list[i];
+            }
+
+            /* Descending, so the indexes stay valid (as "del" does) */
+            qsort(tab, e->_cnt, sizeof(index_t), _gph_sort_des);
+
+            const size_t n = g->_n;
+            for(size_t i = 0u; i < e->_cnt; ++i)
+                gph_del(g, tab[i]);
+            free(tab);
+
+            const size_t left = _edt_arches(g);
+            sum->_vdel += n - g->_n;
+            sum->_adel += *tot - left;
+            *tot = left;
+            return 0;
+        }
+
+        case EDT_ARCH_ADD:
+        case EDT_ARCH_DEL:
+        {
+            index_t a = e->_a, b = e->_b;
+            if(!_edt_chk(g, &a) || !_edt_chk(g, &b))
+                return EDT_BAD_INDEX;
+
+            const size_t r = gph_con(g, a, b, (e->_op == EDT_ARCH_ADD) ? GPH_ADD : GPH_DELETE);
+            if(r == (size_t) -1)
+                return -1;
+
+            if(e->_op == EDT_ARCH_ADD)
+            {
+                sum->_aadd += r;
+                *tot += r;
+            }
+            else
+            {
+                sum->_adel += r;
+                *tot -= r;
+            }
+            return 0;
+        }
+
+        default:
+            return EDT_BAD_OP;
+    }
+}
+
+
+/* State of structured edits decoding */
+typedef struct _edt_jsn_t
+{
+    batch_t    *_batch;
+    int         _base;          /* Depth of the edit objects, 0 - not in the list yet */
+    char        _top[16];       /* Last top-level key */
+    char        _key[16];       /* Last key of the edit */
+
+    int         _op;            /* -1 if not given */
+    int         _ha, _hb, _hn;  /* If a, b and n are given */
+    index_t     _a, _b;
+    size_t      _cnt;
+    index_t    *_list;
+    size_t      _nlist;
+    size_t      _nmem;
+
+    size_t      _item;          /* Index of the current edit */
+    int         _ret;           /* 0, 1 - invalid, -1 - failed */
+
+} edt_jsn_t;
+
+/* Names of ops, in EDT_* order */
+static const char *const g_ops[] = {"new", "size", "add", "set", "del", "arch_add", "arch_del"};
+
+/* Reads a JSON value as a vertex index (a number or "last") */
+static int _edt_val(enum json_event event, const char *value, size_t length, index_t *o_index)
+{
+    char word[16];
+    if((event != JSON_NUMBER && event != JSON_STRING) || length >= sizeof(word))
+        return -1;
+
+    memcpy(word, value, length);
+    word[length] = '\0';
+
+    return _edt_idx(word, event == JSON_STRING, o_index);
+}
+
+/* Appends the decoded edit */
+static int _edt_jsn_put(edt_jsn_t *d)
+{
+    int ok = 0;
+    switch(d->_op)
+    {
+        case EDT_NEW:       ok = 1; break;
+        case EDT_SIZE:      ok = d->_hn; break;
+        case EDT_ADD:       ok = 1; break;
+        case EDT_SET:       ok = d->_ha; break;
+        case EDT_DEL:       ok = d->_nlist > 0u; break;
+        case EDT_ARCH_ADD:
+        case EDT_ARCH_DEL:  ok = d->_ha && d->_hb; break;
+    }
+
+    if(!ok)
+        return 1;
+
+    return edt_add(d->_batch, d->_op, d->_a, d->_b, d->_list,
+                   (d->_op == EDT_SIZE) ? d->_cnt : d->_nlist) ? -1 : 0;
+}
+
+/* Decodes edits as the JSON parser goes */
+static int _edt_jsn_event(void *arg, enum json_event event, const char *value, size_t length, int depth)
+{
+    edt_jsn_t *d = (edt_jsn_t *) arg;
+
+    /* Looking for the list */
+    if(d->_base == 0)
+    {
+        if(event == JSON_ARRAY_BEGIN && depth == 0)
+            d->_base = 1;
+        else if(event == JSON_KEY && depth == 1)
+            snprintf(d->_top, sizeof(d->_top), "%.*s", (int) length, value);
+        else if(event == JSON_ARRAY_BEGIN && depth == 1 && strcmp(d->_top, "edits") == 0)
+            d->_base = 2;
+
+        return 0;
+    }
+
+    /* The list is over */
+    if(depth < d->_base)
+    {
+        d->_base = -1;
+        return 0;
+    }
+    if(d->_base < 0)
+        return 0;
+
+    /* An edit */
+    if(depth == d->_base)
+    {
+        if(event == JSON_OBJECT_BEGIN)
+        {
+            d->_op = -1;
+            d->_ha = d->_hb = d->_hn = 0;
+            d->_a = d->_b = 0u;
+            d->_cnt = d->_nlist = 0u;
+            d->_key[0] = '\0';
+            return 0;
+        }
+        if(event == JSON_OBJECT_END && (d->_ret = _edt_jsn_put(d)) == 0)
+        {
+            ++(d->_item);
+            return 0;
+        }
+        if(event != JSON_OBJECT_END)
+            d->_ret = 1;
+
+        return d->_ret;
+    }
+
+    /* Its fields */
+    if(depth == d->_base + 1)
+    {
+        index_t index = 0u;
+
+        if(event == JSON_KEY)
+        {
+            snprintf(d->_key, sizeof(d->_key), "%.*s", (int) length, value);
+        }
+        else if(strcmp(d->_key, "op") == 0)
+        {
+            d->_ret = 1;
+            for(size_t i = 0u; event == JSON_STRING && i < sizeof(g_ops) / sizeof(g_ops[0u]); ++i)
+            {
+                if(strlen(g_ops[i]) == length && memcmp(g_ops[i], value, length) == 0)
+                {
+                    d->_op = (int) i;
+                    d->_ret = 0;
+                }
+            }
+        }
+        else if(strcmp(d->_key, "n") == 0)
+        {
+            char word[24];
+            char *end = NULL;
+            if(event != JSON_NUMBER || length >= sizeof(word) || *value == '-')
+                return d->_ret = 1;
+
+            memcpy(word, value, length);
+            word[length] = '\0';
+            d->_cnt = strtoul(word, &end, 10);
+            d->_hn = 1;
+            if(*end != '\0')
+                d->_ret = 1;
+        }
+        else if(strcmp(d->_key, "vertex") == 0 || strcmp(d->_key, "from") == 0)
+        {
+            if(_edt_val(event, value, length, &index) != 0)
+                return d->_ret = 1;
+
+            d->_a = index;
+            d->_ha = 1;
+        }
+        else if(strcmp(d->_key, "to") == 0)
+        {
+            if(_edt_val(event, value, length, &index) != 0)
+                return d->_ret = 1;
+
+            d->_b = index;
+            d->_hb = 1;
+        }
+
+        return d->_ret;
+    }
+
+    /* Listed vertices */
+    if(depth == d->_base + 2 && (strcmp(d->_key, "arches") == 0 || strcmp(d->_key, "vertices") == 0))
+    {
+        index_t index = 0u;
+        if(_edt_val(event, value, length, &index) != 0)
+            return d->_ret = 1;
+
+        if(d->_nlist >= d->_nmem)
+        {
+            const size_t nmem = d->_nmem ? d->_nmem * 2u : EDT_DEF_SIZE;
+            index_t *temp = NULL;
+            if((temp = (index_t *) realloc(d->_list, sizeof(index_t) * nmem)) == NULL)
+                return d->_ret = -1;
+
+            d->_list = temp;
+            d->_nmem = nmem;
+        }
+        d->_list[(d->_nlist)++] = index;
+    }
+
+    return 0;
+}
+
+
+/* Allocates new, empty batch.
+ *
+ * Returns NULL if failed.
+ */
+batch_t *edt_new(void)
+{
+    batch_t *batch = NULL;
+    if((batch = (batch_t *) calloc(1u, sizeof(batch_t))) == NULL)
+        return NULL;
+
+    if((batch->_list = (edit_t *) malloc(sizeof(edit_t) * EDT_DEF_SIZE)) == NULL ||
+       (batch->_pool = (index_t *) malloc(sizeof(index_t) * EDT_DEF_SIZE)) == NULL)
+    {
+        free(batch->_list);
+        free(batch);
+        return NULL;
+    }
+
+    batch->_nmem = EDT_DEF_SIZE;
+    batch->_nmempool = EDT_DEF_SIZE;
+
+    return batch;
+}
+
+/* Frees batch.
+ *
+ *  batch       - the victim
+ */
+void edt_fre(batch_t *batch)
+{
+    if(batch == NULL)
+        return;
+
+    free(batch->_list);
+    free(batch->_pool);
+    free(batch);
+}
+
+/* Appends an edit.
+ *
+ *  batch       - destination
+ *  op          - EDT_*
+ *  a, b        - vertices (if used by op)
+ *  list        - listed vertices, can be NULL
+ *  cnt         - their # (or the new size for EDT_SIZE)
+ *
+ * Returns 0 or -1 if failed.
+ */
+int edt_add(batch_t *batch, int op, index_t a, index_t b, const index_t *list, size_t cnt)
+{
+    assert(batch && (list || cnt == 0u || op == EDT_SIZE));
+
+    /* Reallocating if needed */
+    if(batch->_n >= batch->_nmem)
+    {
+        edit_t *temp = NULL;
+        if((temp = (edit_t *) realloc(batch->_list, sizeof(edit_t) * batch->_nmem * 2u)) == NULL)
+            return -1;
+
+        batch->_list = temp;
+        batch->_nmem *= 2u;
+    }
+
+    const size_t nlist = (op == EDT_SIZE) ? 0u : cnt;
+    if(batch->_npool + nlist > batch->_nmempool)
+    {
+        size_t nmem = batch->_nmempool * 2u;
+        while(nmem < batch->_npool + nlist)
+            nmem *= 2u;
+
+        index_t *temp = NULL;
+        if((temp = (index_t *) realloc(batch->_pool, sizeof(index_t) * nmem)) == NULL)
+            return -1;
+
+        batch->_pool = temp;
+        batch->_nmempool = nmem;
+    }
+
+    edit_t *e = &batch->_list[batch->_n];
+    e->_op = op;
+    e->_a = a;
+    e->_b = b;
+    e->_cnt = cnt;
+    e->_off = batch->_npool;
+
+    if(nlist > 0u)
+        memcpy(batch->_pool + batch->_npool, list, sizeof(index_t) * nlist);
+
+    batch->_npool += nlist;
+    ++(batch->_n);
+
+    return 0;
+}
+
+/* Parses a command and appends its edit.
+ *
+ *  batch       - destination
+ *  command     - the command
+ *
+ * Returns appropiate EDT_PRS_* value.
+ */
+int edt_prs(batch_t *batch, const char *command)
+{
+    assert(batch && command);
+
+    char *copy = NULL;
+    index_t *list = NULL;
+    if((copy = strdup(command)) == NULL ||
+       (list = (index_t *) malloc(sizeof(index_t) * (strlen(command) / 2u + 1u))) == NULL)
+    {
+        free(copy);
+        return EDT_PRS_ERROR;
+    }
+
+    int ret = EDT_PRS_INVALID, op = -1;
+    index_t a = 0u, b = 0u;
+    size_t cnt = 0u;
+
+    char *pos = copy;
+    char *name = _edt_tok(&pos);
+    char *word = NULL;
+
+    if(name == NULL)
+    {
+        ret = EDT_PRS_OTHER;
+    }
+
+    /* new [-f] */
+    else if(strcmp(name, "new") == 0)
+    {
+        op = EDT_NEW;
+        while((word = _edt_tok(&pos)) != NULL)
+        {
+            if(strcmp(word, "-f") != 0)
+                op = -1;
+        }
+    }
+
+    /* size <n> [-f] */
+    else if(strcmp(name, "size") == 0)
+    {
+        char *end = NULL;
+        if((word = _edt_tok(&pos)) != NULL && *word >= '0' && *word <= '9')
+        {
+            cnt = strtoul(word, &end, 10);
+            op = (*end == '\0') ? EDT_SIZE : -1;
+        }
+        while((word = _edt_tok(&pos)) != NULL)
+        {
+            if(strcmp(word, "-f") != 0)
+                op = -1;
+        }
+    }
+
+    /* add [A B C ...], also "del <A B C ...>" */
+    else if(strcmp(name, "add") == 0 || strcmp(name, "del") == 0)
+    {
+        const int del = (strcmp(name, "del") == 0);
+        op = del ? EDT_DEL : EDT_ADD;
+        while((word = _edt_tok(&pos)) != NULL && op != -1)
+        {
+            if(_edt_idx(word, del, &list[cnt++]) != 0)
+                op = -1;
+        }
+        if(del && cnt == 0u)
+            op = -1;
+    }
+
+    /* set <A>: [B C D ...] */
+    else if(strcmp(name, "set") == 0)
+    {
+        size_t len = 0u;
+        if((word = _edt_tok(&pos)) != NULL && (len = strlen(word)) > 1u && word[len - 1u] == ':')
+        {
+            word[len - 1u] = '\0';
+            op = (_edt_idx(word, 1, &a) == 0) ? EDT_SET : -1;
+        }
+        while((word = _edt_tok(&pos)) != NULL && op != -1)
+        {
+            if(_edt_idx(word, 1, &list[cnt++]) != 0)
+                op = -1;
+        }
+    }
+
+    /* arch <add/del> <A> <B> */
+    else if(strcmp(name, "arch") == 0)
+    {
+        char *what = _edt_tok(&pos);
+        char *wa = _edt_tok(&pos);
+        char *wb = _edt_tok(&pos);
+
+        if(what && wa && wb && _edt_idx(wa, 1, &a) == 0 && _edt_idx(wb, 1, &b) == 0)
+        {
+            if(strcmp(what, "add") == 0)
+                op = EDT_ARCH_ADD;
+            else if(strcmp(what, "del") == 0)
+                op = EDT_ARCH_DEL;
+        }
+    }
+
+    /* Not an edit */
+    else
+    {
+        ret = EDT_PRS_OTHER;
+    }
+
+    if(op != -1)
+        ret = (edt_add(batch, op, a, b, list, cnt) == 0) ? EDT_PRS_EDIT : EDT_PRS_ERROR;
+
+    free(copy);
+    free(list);
+
+    return ret;
+}
+
+/* Decodes structured edits (JSON) and appends them.
+ *
+ *  batch       - destination
+ *  text        - the JSON document
+ *  len         - its length
+ *  o_bad       - OUT, index of the invalid edit (# of edits if malformed)
+ *
+ * Returns 0, 1 if invalid or -1 if failed.
+ */
+int edt_jsn(batch_t *batch, const char *text, size_t len, size_t *o_bad)
+{
+    assert(batch && text && o_bad);
+
+    edt_jsn_t d;
+    memset(&d, 0, sizeof(d));
+    d._batch = batch;
+
+    struct json_parser parser;
+    json_init(&parser, _edt_jsn_event, &d);
+    json_feed(&parser, text, len);
+
+    /* No list at all or cut in the middle */
+    if(d._ret == 0 && (parser.error || d._base >= 0))
+        d._ret = 1;
+
+    json_free(&parser);
+    free(d._list);
+
+    *o_bad = d._item;
+    return d._ret;
+}
+
+/* Applies the batch on a copy of the graph.
+ *
+ *  graph       - the graph (not changed)
+ *  batch       - edits to be applied
+ *  o_sum       - OUT, what has been changed
+ *  o_bad       - OUT, index of the invalid edit (_n if out of memory)
+ *  o_why       - OUT, why it is invalid (EDT_BAD_*), can be NULL
+ *
+ * Returns the changed copy or NULL if failed.
+ */
+graph_t *edt_apl(const graph_t *graph, const batch_t *batch, edt_sum_t *o_sum, size_t *o_bad, int *o_why)
+{
+    assert(graph && batch && o_sum && o_bad);
+
+    memset(o_sum, 0, sizeof(edt_sum_t));
+    *o_bad = batch->_n;
+    if(o_why)
+        *o_why = EDT_BAD_NONE;
+
+    /* Untouched lists stay shared with the graph */
+    graph_t *g = NULL;
+    if((g = gph_shr(graph)) == NULL)
+        return NULL;
+
+    size_t tot = _edt_arches(g);
+
+    for(size_t i = 0u; i < batch->_n; ++i)
+    {
+        const int r = _edt_one(&g, batch, &batch->_list[i], &tot, o_sum);
+        if(r != 0)
+        {
+            if(r > 0)
+                *o_bad = i;
+            if(r > 0 && o_why)
+                *o_why = r;
+
+            gph_fre(g);
+            return NULL;
+        }
+    }
+
+    return g;
+}
+
+/* Describes why an edit is invalid.
+ *
+ *  why         - EDT_BAD_* value
+ *
+ * Returns the message (a sentence).
+ */
+const char *edt_why(int why)
+{
+    switch(why)
+    {
+        case EDT_BAD_INDEX:     return "Invalid vertex index.";
+        case EDT_BAD_SIZE:      return "Too many vertices (max. 65534).";
+        case EDT_BAD_OP:        return "Unknown edit.";
+        default:                return "Invalid edit.";
+    }
+}
+
+/* Prints edits in diff form, one per line.
+ *
+ *  batch       - the batch
+ *  stream      - output stream
+ *  from        - index of the first printed edit
+ *  max         - max. # of printed edits
+ */
+void edt_out(const batch_t *batch, FILE *stream, size_t from, size_t max)
+{
+    assert(batch && stream);
+
+    for(size_t i = from; i < batch->_n && i - from < max; ++i)
+    {
+        const edit_t *e = &batch->_list[i];
+        const index_t *list = batch->_pool + e->_off;
+
+        switch(e->_op)
+        {
+            case EDT_NEW:
+                fprintf(stream, "- (all the vertices)");
+                break;
+
+            case EDT_SIZE:
+                fprintf(stream, "= size %zu", e->_cnt);
+                break;
+
+            case EDT_ADD:
+                fprintf(stream, "+ vertex ->");
+                break;
+
+            case EDT_SET:
+                fprintf(stream, "~ vertex ");
+                _edt_put(stream, e->_a);
+                fprintf(stream, " ->");
+                break;
+
+            case EDT_DEL:
+                fprintf(stream, "- vertex");
+                break;
+
+            case EDT_ARCH_ADD:
+            case EDT_ARCH_DEL:
+                fprintf(stream, "%c arch ", (e->_op == EDT_ARCH_ADD) ? '+' : '-');
+                _edt_put(stream, e->_a);
+                fprintf(stream, " -> ");
+                _edt_put(stream, e->_b);
+                break;
+        }
+
+        if(e->_op == EDT_ADD || e->_op == EDT_SET || e->_op == EDT_DEL)
+        {
+            for(size_t j = 0u; j < e->_cnt; ++j)
+            {
+                fprintf(stream, " ");
+                _edt_put(stream, list[j]);
+            }
+        }
+
+        fprintf(stream, "\n");
+    }
+
+    if(batch->_n > from + max)
+        fprintf(stream, "... (%zu more)\n", batch->_n - from - max);
+}
@@ -0,0 +1,167 @@
+/*
+ *  edit.h
+ *
+ *  Batches of graph edits. Commands (e.g. the
+ *  ones generated by the AI) are parsed into
+ *  a list of edits, which is checked and applied
+ *  on a copy of the graph in one pass, so a batch
+ *  is taken either as a whole or not at all.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_EDIT_H_FILE_
+#define _GRAPH_EDIT_H_FILE_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graph.h"
+#include "json.h"
+
+#define EDT_NEW                 (0x00)  /* Clears the graph */
+#define EDT_SIZE                (0x01)  /* Resizes the graph to _cnt vertices */
+#define EDT_ADD                 (0x02)  /* Adds a vertex with arches to the listed ones */
+#define EDT_SET                 (0x03)  /* Replaces arches of _a with the listed ones */
+#define EDT_DEL                 (0x04)  /* Deletes the listed vertices */
+#define EDT_ARCH_ADD            (0x05)  /* Adds _a -> _b arch */
+#define EDT_ARCH_DEL            (0x06)  /* Deletes _a -> _b arch */
+
+#define EDT_PRS_EDIT            0       /* PARSE: An edit has been added */
+#define EDT_PRS_OTHER           1       /* PARSE: Not an edit (e.g. "list"), nothing added */
+#define EDT_PRS_INVALID         2       /* PARSE: Malformed edit command, nothing added */
+#define EDT_PRS_ERROR           -1      /* PARSE: Critical memory error */
+
+#define EDT_BAD_NONE            0       /* APPLY: No invalid edit */
+#define EDT_BAD_INDEX           1       /* APPLY: Vertex index out of the graph */
+#define EDT_BAD_SIZE            2       /* APPLY: Too many vertices */
+#define EDT_BAD_OP              3       /* APPLY: Unknown edit */
+
+
+/* An edit */
+typedef struct _edt_edit_t
+{
+    int         _op;            /* EDT_* */
+    index_t     _a;             /* Vertex (can be GPH_LAST) */
+    index_t     _b;             /* Arch target (can be GPH_LAST) */
+    size_t      _cnt;           /* # of listed vertices (or the new size) */
+    size_t      _off;           /* Offset of the listed vertices in the pool */
+
+} edit_t;
+
+/* A batch of edits */
+typedef struct _edt_batch_t
+{
+    edit_t     *_list;          /* Edits, in order */
+    size_t      _n;
+    size_t      _nmem;
+
+    index_t    *_pool;          /* Vertex lists of all the edits */
+    size_t      _npool;
+    size_t      _nmempool;
+
+} batch_t;
+
+/* Summary of an applied batch */
+typedef struct _edt_sum_t
+{
+    size_t      _vadd;          /* # of added vertices */
+    size_t      _vdel;          /* # of deleted vertices */
+    size_t      _aadd;          /* # of added arches */
+    size_t      _adel;          /* # of deleted arches */
+
+} edt_sum_t;
+
+
+/* Allocates new, empty batch.
+ *
+ * Returns NULL if failed.
+ */
+batch_t        *edt_new(void);
+
+/* Frees batch.
+ *
+ *  batch       - the victim
+ */
+void            edt_fre(batch_t *batch);
+
+/* Appends an edit.
+ *
+ *  batch       - destination
+ *  op          - EDT_*
+ *  a, b        - vertices (if used by op)
+ *  list        - listed vertices, can be NULL
+ *  cnt         - their # (or the new size for EDT_SIZE)
+ *
+ * Returns 0 or -1 if failed.
+ */
+int             edt_add(batch_t *batch, int op, index_t a, index_t b, const index_t *list, size_t cnt);
+
+/* Parses a command ("arch add 0 1", "set 2: 0 1", ...)
+ * the same way it would be run and appends its edit.
+ *
+ *  batch       - destination
+ *  command     - the command
+ *
+ * Returns appropiate EDT_PRS_* value.
+ */
+int             edt_prs(batch_t *batch, const char *command);
+
+/* Decodes structured edits (JSON) and appends them:
+ * {"edits": [{"op": "arch_add", "from": 0, "to": 1}, ...]}
+ * or just the array. Ops and their fields:
+ *
+ *      new                         - clears the graph
+ *      size     n                  - resizes the graph
+ *      add      arches             - adds a vertex
+ *      set      vertex, arches     - replaces arches of the vertex
+ *      del      vertices           - deletes the vertices
+ *      arch_add from, to           - adds an arch
+ *      arch_del from, to           - deletes an arch
+ *
+ * Vertices are numbers or "last".
+ *
+ *  batch       - destination
+ *  text        - the JSON document
+ *  len         - its length
+ *  o_bad       - OUT, index of the invalid edit (# of edits if malformed)
+ *
+ * Returns 0, 1 if invalid or -1 if failed.
+ */
+int             edt_jsn(batch_t *batch, const char *text, size_t len, size_t *o_bad);
+
+/* Applies the batch on a clone of the graph (gph_shr()),
+ * with the same effect the commands would have one by one.
+ * Nothing is applied if any edit is invalid.
+ *
+ *  graph       - the graph (not changed, can be read meanwhile)
+ *  batch       - edits to be applied
+ *  o_sum       - OUT, what has been changed
+ *  o_bad       - OUT, index of the invalid edit (_n if out of memory)
+ *  o_why       - OUT, why it is invalid (EDT_BAD_*), can be NULL
+ *
+ * Returns the changed copy or NULL if failed.
+ */
+graph_t        *edt_apl(const graph_t *graph, const batch_t *batch, edt_sum_t *o_sum, size_t *o_bad, int *o_why);
+
+/* Describes why an edit is invalid.
+ *
+ *  why         - EDT_BAD_* value
+ *
+ * Returns the message (a sentence).
+ */
+const char     *edt_why(int why);
+
+/* Prints edits in diff form, one per line.
+ *
+ *  batch       - the batch
+ *  stream      - output stream
+ *  from        - index of the first printed edit
+ *  max         - max. # of printed edits
+ */
+void            edt_out(const batch_t *batch, FILE *stream, size_t from, size_t max);
+
+#endif /* _GRAPH_EDIT_H_FILE_ */
@@ -0,0 +1,172 @@
+/*
+ *  epoch.c
+ *
+ *  Extends "epoch.h".
+ *
+ *  A reader stores the global epoch in its slot
+ *  before it loads the current snapshot. A snapshot
+ *  replaced in epoch E can be seen only by readers
+ *  with epoch <= E, so it is freed once all the
+ *  taken slots hold a later one.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "epoch.h"
+
+#define EPC_FREE                0u      /* Slot not taken */
+
+
+/* Current snapshot */
+static _Atomic(snap_t *) g_current = NULL;
+
+/* Global epoch, starts at 1 (0 marks free slots) */
+static atomic_uint_fast64_t g_epoch = 1u;
+
+/* Epochs of the readers inside */
+static atomic_uint_fast64_t g_slots[EPC_MAX_READERS];
+
+/* Retired snapshots, newest first */
+static snap_t *g_retired = NULL;
+static size_t g_nsnap = 0u;
+static uint64_t g_nid = 0u;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* Frees a snapshot */
+static void _epc_fre(snap_t *snap)
+{
+    gph_fre(snap->_graph);
+    free(snap);
+}
+
+/* Publishes new snapshot, the current one is retired.
+ *
+ *  graph       - the copy, taken over (freed along with the snapshot)
+ *
+ * Returns 0 or -1 if failed (the copy is not taken then).
+ */
+int epc_pub(graph_t *graph)
+{
+    assert(graph);
+
+    snap_t *snap = NULL;
+    if((snap = (snap_t *) malloc(sizeof(snap_t))) == NULL)
+        return -1;
+
+    pthread_mutex_lock(&g_lock);
+    snap->_graph = graph;
+    snap->_id = ++g_nid;
+    snap->_retired = 0u;
+    snap->_next = NULL;
+    ++g_nsnap;
+
+    /* Readers coming after the swap get the new one */
+    snap_t *old = atomic_exchange(&g_current, snap);
+    const uint64_t epoch = atomic_fetch_add(&g_epoch, 1u);
+
+    if(old)
+    {
+        old->_retired = epoch;
+        old->_next = g_retired;
+        g_retired = old;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    epc_rcl();
+    return 0;
+}
+
+/* Enters a read side section and gives the current
+ * snapshot, valid until the section is left.
+ *
+ *  o_snap      - OUT, the snapshot (NULL if none published)
+ *
+ * Returns the reader slot or -1 if all of them are taken.
+ */
+int epc_ent(const snap_t **o_snap)
+{
+    assert(o_snap);
+
+    /* Taking a later epoch would not protect the snapshot loaded */
+    const uint_fast64_t epoch = atomic_load(&g_epoch);
+
+    for(size_t i = 0u; i < EPC_MAX_READERS; ++i)
+    {
+        uint_fast64_t expected = EPC_FREE;
+        if(atomic_compare_exchange_strong(&g_slots[i], &expected, epoch))
+        {
+            *o_snap = atomic_load(&g_current);
+            return (int) i;
+        }
+    }
+
+    *o_snap = NULL;
+    return -1;
+}
+
+/* Leaves a read side section. Can be called
+ * from other thread than the one that entered.
+ *
+ *  slot        - the reader slot
+ */
+void epc_lev(int slot)
+{
+    assert(slot >= 0 && (size_t) slot < EPC_MAX_READERS);
+
+    atomic_store(&g_slots[slot], EPC_FREE);
+}
+
+/* Frees retired snapshots no reader can see anymore.
+ *
+ * Returns # of freed snapshots.
+ */
+size_t epc_rcl(void)
+{
+    pthread_mutex_lock(&g_lock);
+
+    /* The oldest epoch inside */
+    uint64_t oldest = UINT64_MAX;
+    for(size_t i = 0u; i < EPC_MAX_READERS; ++i)
+    {
+        const uint64_t epoch = atomic_load(&g_slots[i]);
+        if(epoch != EPC_FREE && epoch < oldest)
+            oldest = epoch;
+    }
+
+    size_t freed = 0u;
+    snap_t **link = &g_retired;
+    while(*link)
+    {
+        snap_t *snap = *link;
+        if(snap->_retired < oldest)
+        {
+            *link = snap->_next;
+            _epc_fre(snap);
+            ++freed;
+        }
+        else
+            link = &snap->_next;
+    }
+
+    g_nsnap -= freed;
+    pthread_mutex_unlock(&g_lock);
+
+    return freed;
+}
+
+/* Gives # of published snapshots that are still in memory.
+ *
+ * Returns the number (the current one included).
+ */
+size_t epc_cnt(void)
+{
+    pthread_mutex_lock(&g_lock);
+    const size_t n = g_nsnap;
+    pthread_mutex_unlock(&g_lock);
+
+    return n;
+}
@@ -0,0 +1,79 @@
+/*
+ *  epoch.h
+ *
+ *  Snapshots of the graph for readers on other
+ *  threads. A snapshot is an immutable copy,
+ *  published at once; the previous one is retired
+ *  and freed only after every reader that could
+ *  have seen it has left (epoch based reclamation).
+ *
+ *  Publishing and reclaiming is done by a single
+ *  thread (the one editing the graph), readers
+ *  can enter and leave from any thread.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_EPOCH_H_FILE_
+#define _GRAPH_EPOCH_H_FILE_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graph.h"
+
+#define EPC_MAX_READERS         64u     /* Max. # of readers inside at once */
+
+
+/* A snapshot */
+typedef struct _epc_snap_t
+{
+    graph_t    *_graph;         /* The copy, must not be changed */
+    uint64_t    _id;            /* # of the snapshot (1, 2, ...) */
+    uint64_t    _retired;       /* Epoch it has been retired in, 0 if current */
+
+    struct _epc_snap_t *_next;  /* Next retired snapshot */
+
+} snap_t;
+
+
+/* Publishes new snapshot, the current one is retired.
+ *
+ *  graph       - the copy, taken over (freed along with the snapshot)
+ *
+ * Returns 0 or -1 if failed (the copy is not taken then).
+ */
+int             epc_pub(graph_t *graph);
+
+/* Enters a read side section and gives the current
+ * snapshot, valid until the section is left.
+ *
+ *  o_snap      - OUT, the snapshot (NULL if none published)
+ *
+ * Returns the reader slot or -1 if all of them are taken.
+ */
+int             epc_ent(const snap_t **o_snap);
+
+/* Leaves a read side section. Can be called
+ * from other thread than the one that entered.
+ *
+ *  slot        - the reader slot
+ */
+void            epc_lev(int slot);
+
+/* Frees retired snapshots no reader can see anymore.
+ *
+ * Returns # of freed snapshots.
+ */
+size_t          epc_rcl(void);
+
+/* Gives # of published snapshots that are still in memory.
+ *
+ * Returns the number (the current one included).
+ */
+size_t          epc_cnt(void);
+
+#endif /* _GRAPH_EPOCH_H_FILE_ */
@@ -0,0 +1,473 @@
+/*
+ *  generate.c
+ *
+ *  Extends "generate.h".
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include "generate.h"
+
+/* Growable arch array */
+typedef struct _gen_buf_t
+{
+    index_t    *_arch;          /* Pairs (A, B) one after another */
+    size_t      _n;             /* # of pairs */
+    size_t      _nmem;          /* Allocated # of pairs */
+
+} gen_buf_t;
+
+
+/* Inits the array.
+ *
+ *  buf         - the array
+ *  n           - # of pairs to preallocate
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _gen_ini(gen_buf_t *buf, size_t n)
+{
+    buf->_n    = 0u;
+    buf->_nmem = (n > 0u) ? n : 1u;
+
+    if((buf->_arch = (index_t *) malloc(sizeof(index_t) * 2u * buf->_nmem)) == NULL)
+        return -1;
+
+    return 0;
+}
+
+/* Appends an arch, resizes if needed.
+ *
+ *  buf         - the array
+ *  a, b        - the arch
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _gen_put(gen_buf_t *buf, size_t a, size_t b)
+{
+    if(buf->_n >= buf->_nmem)
+    {
+        index_t *temp = NULL;
+        if((temp = (index_t *) realloc(buf->_arch, sizeof(index_t) * 4u * buf->_nmem)) == NULL)
+            return -1;
+
+        buf->_arch  = temp;
+        buf->_nmem *= 2u;
+    }
+
+    buf->_arch[2u * buf->_n]      = (index_t) a;
+    buf->_arch[2u * buf->_n + 1u] = (index_t) b;
+    ++(buf->_n);
+
+    return 0;
+}
+
+/* Turns the array into a graph and frees it.
+ *
+ *  buf         - the array
+ *  n           - # of vertices
+ *
+ * Returns NULL if failed.
+ */
+static graph_t *_gen_end(gen_buf_t *buf, size_t n)
+{
+    graph_t *g = gph_bld(n, buf->_arch, buf->_n);
+    free(buf->_arch);
+    buf->_arch = NULL;
+
+    return g;
+}
+
+/* Erdos-Renyi G(n, p) graph. Each of n * (n - 1)
+ * possible arches (no self-loops) exists with probability p.
+ *
+ *  n           - # of vertices
+ *  p           - arch probability
+ *  seed        - generator seed
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gen_erd(size_t n, double p, uint64_t seed)
+{
+    assert(n <= GEN_MAX_VERTICES && p >= 0.0 && p <= 1.0);
+
+    gen_buf_t buf;
+    rnd_t rnd;
+    rnd_ini(&rnd, seed);
+
+    const uint64_t slots = (n > 1u) ? (uint64_t) n * (n - 1u) : 0u;
+    if(_gen_ini(&buf, (size_t) ((double) slots * p * 1.01) + 16u) != 0)
+        return NULL;
+
+    /* Geometric skipping over the slots, O(n + arches) */
+    const double lq = log(1.0 - p);
+    uint64_t idx = 0u;
+
+    for(int first = 1; p > 0.0 && slots > 0u; first = 0)
+    {
+        uint64_t skip = 0u;
+        if(p < 1.0)
+        {
+            const double s = floor(log(1.0 - rnd_dbl(&rnd)) / lq);
+            if(s >= (double) slots)
+                break;
+
+            skip = (uint64_t) s;
+        }
+
+        idx += skip + (first ? 0u : 1u);
+        if(idx >= slots)
+            break;
+
+        /* Slot -> arch, skipping the diagonal */
+        const size_t a = (size_t) (idx / (n - 1u));
+        size_t b = (size_t) (idx % (n - 1u));
+        b += (b >= a);
+
+        if(_gen_put(&buf, a, b) != 0)
+        {
+            free(buf._arch);
+            return NULL;
+        }
+    }
+
+    return _gen_end(&buf, n);
+}
+
+/* Barabasi-Albert graph (preferential attachment).
+ * Starts with a (m + 1)-clique, each next vertex gets
+ * two-way arches to m distinct vertices chosen by degree.
+ *
+ *  n           - # of vertices, more than m
+ *  m           - # of arches per new vertex, at least 1
+ *  seed        - generator seed
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gen_bar(size_t n, size_t m, uint64_t seed)
+{
+    assert(n <= GEN_MAX_VERTICES && m > 0u && n > m);
+
+    gen_buf_t buf;
+    rnd_t rnd;
+    rnd_ini(&rnd, seed);
+
+    /* Each arch end is stored once, so picking one uniformly is picking by degree */
+    const size_t nend = (m + 1u) * m + 2u * (n - m - 1u) * m;
+    index_t *ends = NULL, *pick = NULL;
+    size_t k = 0u;
+
+    if((ends = (index_t *) malloc(sizeof(index_t) * nend)) == NULL ||
+       (pick = (index_t *) malloc(sizeof(index_t) * m)) == NULL)
+    {
+        free(ends);
+        return NULL;
+    }
+
+    if(_gen_ini(&buf, nend) != 0)
+    {
+        free(ends);
+        free(pick);
+        return NULL;
+    }
+
+    /* The clique */
+    for(size_t a = 0u; a <= m; ++a)
+    {
+        for(size_t b = 0u; b <= m; ++b)
+        {
+            if(a == b)
+                continue;
+
+            if(_gen_put(&buf, a, b) != 0)
+                goto FAIL;
+
+            ends[k++] = (index_t) a;
+        }
+    }
+
+    /* Attaching */
+    for(size_t v = m + 1u; v < n; ++v)
+    {
+        /* m distinct targets */
+        for(size_t i = 0u; i < m; ++i)
+        {
+            index_t t = 0u;
+            size_t j = 0u;
+            do
+            {
+                t = ends[rnd_bnd(&rnd, (uint32_t) k)];
+                for(j = 0u; j < i && pick[j] != t; ++j);
+
+            } while(j < i);
+
+            pick[i] = t;
+        }
+
+        for(size_t i = 0u; i < m; ++i)
+        {
+            if(_gen_put(&buf, v, pick[i]) != 0 || _gen_put(&buf, pick[i], v) != 0)
+                goto FAIL;
+
+            ends[k++] = (index_t) v;
+            ends[k++] = pick[i];
+        }
+    }
+
+    free(ends);
+    free(pick);
+    return _gen_end(&buf, n);
+
+    FAIL:;
+
+    free(ends);
+    free(pick);
+    free(buf._arch);
+    return NULL;
+}
+
+/* R-MAT (Kronecker) graph. Each arch is placed by recursive
+ * choice of a quadrant of the adjacency matrix (probabilities
+ * a, b, c and 1 - a - b - c). Dups are merged.
+ *
+ *  scale       - log2 of # of vertices, up to GEN_MAX_RMAT_SCALE
+ *  narch       - # of arches to be drawn
+ *  a, b, c     - quadrant probabilities
+ *  seed        - generator seed
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gen_rmt(size_t scale, size_t narch, double a, double b, double c, uint64_t seed)
+{
+    assert(scale <= GEN_MAX_RMAT_SCALE && a >= 0.0 && b >= 0.0 && c >= 0.0 && a + b + c <= 1.0);
+
+    gen_buf_t buf;
+    rnd_t rnd;
+    rnd_ini(&rnd, seed);
+
+    if(_gen_ini(&buf, narch) != 0)
+        return NULL;
+
+    for(size_t i = 0u; i < narch; ++i)
+    {
+        size_t u = 0u, v = 0u;
+
+        for(size_t bit = (size_t) 1u << scale >> 1u; bit > 0u; bit >>= 1u)
+        {
+            const double r = rnd_dbl(&rnd);
+
+            if(r < a)
+                /* Top left */;
+            else if(r < a + b)
+                v |= bit;
+            else if(r < a + b + c)
+                u |= bit;
+            else
+            {
+                u |= bit;
+                v |= bit;
+            }
+        }
+
+        if(_gen_put(&buf, u, v) != 0)
+        {
+            free(buf._arch);
+            return NULL;
+        }
+    }
+
+    return _gen_end(&buf, (size_t) 1u << scale);
+}
+
+/* 2D grid graph, each vertex has two-way arches to its
+ * (up to 4) neighbours.
+ *
+ *  w, h        - grid dimensions
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gen_grd(size_t w, size_t h)
+{
+    assert(w * h <= GEN_MAX_VERTICES);
+
+    gen_buf_t buf;
+    if(_gen_ini(&buf, 4u * w * h) != 0)
+        return NULL;
+
+    for(size_t y = 0u; y < h; ++y)
+    {
+        for(size_t x = 0u; x < w; ++x)
+        {
+            const size_t v = y * w + x;
+
+            if((x + 1u < w && (_gen_put(&buf, v, v + 1u) != 0 || _gen_put(&buf, v + 1u, v) != 0)) ||
+               (y + 1u < h && (_gen_put(&buf, v, v + w) != 0 || _gen_put(&buf, v + w, v) != 0)))
+            {
+                free(buf._arch);
+                return NULL;
+            }
+        }
+    }
+
+    return _gen_end(&buf, w * h);
+}
+
+/* Tells if a param is a whole number.
+ *
+ *  x           - the param
+ *
+ * Returns 1 if it is, 0 otherwise.
+ */
+static int _gen_int(double x)
+{
+    return floor(x) == x;
+}
+
+/* Parses and checks arguments of "gen" command
+ * (<model> <params ...> [-s seed] [-f]).
+ *
+ *  argv        - the arguments
+ *  argc        - their #
+ *  o_spec      - OUT, what is to be generated
+ *  o_err       - OUT, error message (GLO_MAX_MSG_OUTPUT chars)
+ *
+ * Returns 0 or 1 if invalid.
+ */
+int gen_prs(char **argv, int argc, gen_spec_t *o_spec, char *o_err)
+{
+    assert(argv && o_spec && o_err);
+
+    memset(o_spec, 0, sizeof(gen_spec_t));
+    o_spec->_seed = (uint64_t) time(NULL);
+    o_err[0u] = '\0';
+
+    /* Validation */
+    if(argc < 1)
+    {
+        snprintf(o_err, GLO_MAX_MSG_OUTPUT - 1u, "Missing parameters.");
+        return 1;
+    }
+
+    /* Params and flags */
+    for(int i = 1; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-f") == 0)
+            o_spec->_force = 1;
+
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            unsigned long long seed = 0u;
+            if(i + 1 >= argc || sscanf(argv[++i], "%llu", &seed) < 1)
+            {
+                snprintf(o_err, GLO_MAX_MSG_OUTPUT - 1u, "Expected positive integer.");
+                return 1;
+            }
+            o_spec->_seed = (uint64_t) seed;
+        }
+
+        else if(o_spec->_npar < GEN_MAX_PARAMS && sscanf(argv[i], "%lf", &o_spec->_par[o_spec->_npar]) == 1 &&
+                isfinite(o_spec->_par[o_spec->_npar]) && o_spec->_par[o_spec->_npar] >= 0.0)
+            ++(o_spec->_npar);
+
+        /* Wrong param */
+        else
+        {
+            snprintf(o_err, GLO_MAX_MSG_OUTPUT - 1u, "Invalid parameter (%s).", argv[i]);
+            return 1;
+        }
+    }
+
+    /* Checking params for each model */
+    const double *par = o_spec->_par;
+    const int npar = o_spec->_npar;
+    const char *err = NULL;
+
+    if(strcmp(argv[0u], "er") == 0)
+    {
+        o_spec->_model = GEN_ERD;
+        if(npar != 2)
+            err = "Expected <n> <p>.";
+        else if(! _gen_int(par[0u]))
+            err = "Expected integer n.";
+        else if(par[0u] > GEN_MAX_VERTICES || par[1u] > 1.0)
+            err = "Expected n <= 65534 and p <= 1.";
+        else if(par[0u] * (par[0u] - 1.0) * par[1u] > GEN_MAX_ARCHES)
+            err = "Expected n * (n - 1) * p <= 33554432 arches.";
+    }
+    else if(strcmp(argv[0u], "ba") == 0)
+    {
+        o_spec->_model = GEN_BAR;
+        if(npar != 2)
+            err = "Expected <n> <m>.";
+        else if(! _gen_int(par[0u]) || ! _gen_int(par[1u]))
+            err = "Expected integer n and m.";
+        else if(par[0u] > GEN_MAX_VERTICES || par[1u] < 1.0 || par[0u] <= par[1u])
+            err = "Expected n <= 65534 and 1 <= m < n.";
+        else if(2.0 * par[0u] * par[1u] > GEN_MAX_ARCHES)
+            err = "Expected 2 * n * m <= 33554432 arches.";
+    }
+    else if(strcmp(argv[0u], "rmat") == 0)
+    {
+        o_spec->_model = GEN_RMT;
+        if(npar != 2 && npar != 5)
+            err = "Expected <scale> <arches> [a b c].";
+        else if(! _gen_int(par[0u]) || ! _gen_int(par[1u]))
+            err = "Expected integer scale and arches.";
+        else if(par[0u] > GEN_MAX_RMAT_SCALE)
+            err = "Expected scale <= 15.";
+        else if(par[1u] > GEN_MAX_ARCHES)
+            err = "Expected arches <= 33554432.";
+        else if(npar == 5 && par[2u] + par[3u] + par[4u] > 1.0)
+            err = "Expected a + b + c <= 1.";
+    }
+    else if(strcmp(argv[0u], "grid") == 0)
+    {
+        o_spec->_model = GEN_GRD;
+        if(npar != 2)
+            err = "Expected <w> <h>.";
+        else if(! _gen_int(par[0u]) || ! _gen_int(par[1u]))
+            err = "Expected integer w and h.";
+        else if(par[0u] * par[1u] > GEN_MAX_VERTICES)
+            err = "Expected w * h <= 65534.";
+    }
+    else
+        err = "Unknown model (er/ba/rmat/grid).";
+
+    if(err)
+    {
+        snprintf(o_err, GLO_MAX_MSG_OUTPUT - 1u, "%s", err);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Generates a graph parsed by gen_prs().
+ *
+ *  spec        - what is to be generated
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gen_run(const gen_spec_t *spec)
+{
+    assert(spec);
+
+    const double *par = spec->_par;
+
+    switch (spec->_model)
+    {
+    case GEN_ERD:
+        return gen_erd((size_t) par[0u], par[1u], spec->_seed);
+
+    case GEN_BAR:
+        return gen_bar((size_t) par[0u], (size_t) par[1u], spec->_seed);
+
+    case GEN_RMT:
+        if(spec->_npar == 5)
+            return gen_rmt((size_t) par[0u], (size_t) par[1u], par[2u], par[3u], par[4u], spec->_seed);
+        return gen_rmt((size_t) par[0u], (size_t) par[1u], 0.57, 0.19, 0.19, spec->_seed);
+
+    default:
+        return gen_grd((size_t) par[0u], (size_t) par[1u]);
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ *  generate.h
+ *
+ *  Random graph generators, used for load
+ *  testing and benchmarking. Arches are
+ *  generated into one array first and then
+ *  turned into a graph at once (gph_bld).
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_GENERATE_H_FILE_
+#define _GRAPH_GENERATE_H_FILE_
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "global.h"
+#include "graph.h"
+#include "random.h"
+
+#define GEN_MAX_VERTICES        (UINT16_MAX - 1u)   /* Max. # of vertices of a generated graph */
+#define GEN_MAX_RMAT_SCALE      15u                 /* Max. R-MAT scale (2^scale vertices) */
+#define GEN_MAX_PARAMS          5                   /* Max. # of numeric params of "gen" command */
+#define GEN_MAX_ARCHES          (1u << 25)          /* Max. # of arches "gen" command may draw */
+
+#define GEN_ERD                 0                   /* MODEL: Erdos-Renyi */
+#define GEN_BAR                 1                   /* MODEL: Barabasi-Albert */
+#define GEN_RMT                 2                   /* MODEL: R-MAT */
+#define GEN_GRD                 3                   /* MODEL: Grid */
+
+
+/* Parsed "gen" command */
+typedef struct _gen_spec_t
+{
+    int         _model;                 /* GEN_* model */
+    double      _par[GEN_MAX_PARAMS];   /* Numeric params, in order */
+    int         _npar;                  /* Their # */
+    uint64_t    _seed;                  /* Generator seed (time if not given) */
+    int         _force;                 /* 1 if "-f" was given */
+
+} gen_spec_t;
+
+
+/* Erdos-Renyi G(n, p) graph. Each of n * (n - 1)
+ * possible arches (no self-loops) exists with probability p.
+ *
+ *  n           - # of vertices
+ *  p           - arch probability
+ *  seed        - generator seed
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gen_erd(size_t n, double p, uint64_t seed);
+
+/* Barabasi-Albert graph (preferential attachment).
+ * Starts with a (m + 1)-clique, each next vertex gets
+ * two-way arches to m distinct vertices chosen by degree.
+ *
+ *  n           - # of vertices, more than m
+ *  m           - # of arches per new vertex, at least 1
+ *  seed        - generator seed
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gen_bar(size_t n, size_t m, uint64_t seed);
+
+/* R-MAT (Kronecker) graph. Each arch is placed by recursive
+ * choice of a quadrant of the adjacency matrix (probabilities
+ * a, b, c and 1 - a - b - c). Dups are merged.
+ *
+ *  scale       - log2 of # of vertices, up to GEN_MAX_RMAT_SCALE
+ *  narch       - # of arches to be drawn
+ *  a, b, c     - quadrant probabilities
+ *  seed        - generator seed
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gen_rmt(size_t scale, size_t narch, double a, double b, double c, uint64_t seed);
+
+/* 2D grid graph, each vertex has two-way arches to its
+ * (up to 4) neighbours.
+ *
+ *  w, h        - grid dimensions
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gen_grd(size_t w, size_t h);
+
+/* Parses and checks arguments of "gen" command
+ * (<model> <params ...> [-s seed] [-f]).
+ *
+ *  argv        - the arguments
+ *  argc        - their #
+ *  o_spec      - OUT, what is to be generated
+ *  o_err       - OUT, error message (GLO_MAX_MSG_OUTPUT chars)
+ *
+ * Returns 0 or 1 if invalid.
+ */
+int             gen_prs(char **argv, int argc, gen_spec_t *o_spec, char *o_err);
+
+/* Generates a graph parsed by gen_prs().
+ *
+ *  spec        - what is to be generated
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gen_run(const gen_spec_t *spec);
+
+#endif /* _GRAPH_GENERATE_H_FILE_ */
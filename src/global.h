@@ -15,5 +15,6 @@
 #define GLO_DEF_GRAPH_SIZE      64u     /* Default allocation size for a graph */
 #define GLO_PRINT_LINE_NUM      1u      /* Number of vertices printed per line */
 #define GLO_PRINT_ALIGMENT      32u     /* Printing distances */
+#define GLO_MAX_THREADS         16u     /* Max. # of worker threads per algorithm */
 
 #endif /* _GRAPH_GLOBAL_H_FILE_ */
\ No newline at end of file
@@ -6,7 +6,215 @@
  *  By Aleksander Slepowronski.
  */
 
+ #include <pthread.h>
+ #include <stdatomic.h>
+
  #include "graph.h" 
+ #include "misc.h"
+
+/* Locks of a graph in concurrent mode */
+struct _gph_sync_t
+{
+    pthread_rwlock_t    _stripe[GPH_SYNC_STRIPES];      /* Vertex i is guarded by _stripe[i % GPH_SYNC_STRIPES] */
+    pthread_mutex_t     _grow;                          /* Taken by gph_add */
+    vertex_t          **_old[GPH_SYNC_MAX_LISTS];       /* Outgrown vertex lists, still read by others */
+    size_t              _nold;
+
+};
+
+/* Last given version stamp */
+static uint32_t g_stamp = 0u;
+
+/* Gives a vertex new version stamp (unique among all the vertices) */
+static inline void _gph_tch(vertex_t *v)
+{
+    v->_ver = __atomic_add_fetch(&g_stamp, 1u, __ATOMIC_RELAXED);
+}
+
+/* Gives # of vertices, safe against concurrent gph_add() */
+static inline size_t _gph_len(const graph_t *graph)
+{
+    return __atomic_load_n(&graph->_n, __ATOMIC_ACQUIRE);
+}
+
+/* Gives a vertex, safe against concurrent gph_add() */
+static inline vertex_t *_gph_vtx(const graph_t *graph, size_t index)
+{
+    return __atomic_load_n(&graph->_list, __ATOMIC_ACQUIRE)[index];
+}
+
+/* CONCURRENT: locks stripes of A and B (A only if B is GPH_LAST), in order */
+static void _gph_lck(const graph_t *graph, index_t a, index_t b, int write)
+{
+    if(graph->_sync == NULL)
+        return;
+
+    size_t sa = a % GPH_SYNC_STRIPES, sb = (b == GPH_LAST) ? sa : b % GPH_SYNC_STRIPES;
+    if(sb < sa)
+    {
+        const size_t t = sa;
+        sa = sb;
+        sb = t;
+    }
+
+    if(write)
+        pthread_rwlock_wrlock(&graph->_sync->_stripe[sa]);
+    else
+        pthread_rwlock_rdlock(&graph->_sync->_stripe[sa]);
+
+    if(sb != sa && write)
+        pthread_rwlock_wrlock(&graph->_sync->_stripe[sb]);
+    else if(sb != sa)
+        pthread_rwlock_rdlock(&graph->_sync->_stripe[sb]);
+}
+
+/* CONCURRENT: unlocks what _gph_lck() has locked */
+static void _gph_unl(const graph_t *graph, index_t a, index_t b)
+{
+    if(graph->_sync == NULL)
+        return;
+
+    const size_t sa = a % GPH_SYNC_STRIPES, sb = (b == GPH_LAST) ? sa : b % GPH_SYNC_STRIPES;
+
+    pthread_rwlock_unlock(&graph->_sync->_stripe[sa]);
+    if(sb != sa)
+        pthread_rwlock_unlock(&graph->_sync->_stripe[sb]);
+}
+
+/* Tells if a list lives in the arena of the graph (it cannot be freed alone) */
+static inline int _gph_own(const graph_t *graph, const index_t *list)
+{
+    return graph->_arena && list >= graph->_arena && list < graph->_arena + graph->_narena;
+}
+
+/* Resizes the list of a vertex. One living in the arena is moved out.
+ *
+ *  graph       - the graph of the vertex
+ *  v           - the vertex
+ *  n           - new length (> 0)
+ *
+ * Returns 0 or -1 if failed (the list stays as it was).
+ */
+static int _gph_rsz(const graph_t *graph, vertex_t *v, size_t n)
+{
+    index_t *temp = NULL;
+
+    if(_gph_own(graph, v->_arch))
+    {
+        if((temp = (index_t *) malloc(sizeof(index_t) * n)) == NULL)
+            return -1;
+        memcpy(temp, v->_arch, sizeof(index_t) * ((v->_narch < n) ? v->_narch : n));
+    }
+    else if((temp = (index_t *) realloc(v->_arch, sizeof(index_t) * n)) == NULL)
+        return -1;
+
+    v->_arch = temp;
+    return 0;
+}
+
+/* Makes the list of a vertex writable in place. One living
+ * in the arena is copied out, as the arena may be shared.
+ *
+ *  graph       - the graph of the vertex
+ *  v           - the vertex
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _gph_mut(const graph_t *graph, vertex_t *v)
+{
+    if(! _gph_own(graph, v->_arch))
+        return 0;
+
+    return _gph_rsz(graph, v, (v->_narch > 0u) ? v->_narch : 1u);
+}
+
+/* Gives up the arena of a graph, the last graph sharing it frees it */
+static void _gph_arl(graph_t *graph)
+{
+    if(graph->_arefs == NULL || __atomic_sub_fetch(graph->_arefs, 1u, __ATOMIC_ACQ_REL) == 0u)
+    {
+        free(graph->_arena);
+        free(graph->_arefs);
+    }
+
+    graph->_arena  = NULL;
+    graph->_narena = 0u;
+    graph->_arefs  = NULL;
+}
+
+/* Tells if most of the arches of a graph are outside its arena */
+static int _gph_spr(const graph_t *graph)
+{
+    size_t in = 0u, out = 0u;
+    for(size_t i = 0u; i < graph->_n; ++i)
+    {
+        const vertex_t *v = graph->_list[i];
+        if(_gph_own(graph, v->_arch))
+            in += v->_narch;
+        else
+            out += v->_narch;
+    }
+
+    return out > in;
+}
+
+/* Makes the count of graphs sharing a new arena.
+ *
+ * Returns the count (1) or NULL if failed.
+ */
+static size_t *_gph_arc(void)
+{
+    size_t *refs = NULL;
+    if((refs = (size_t *) malloc(sizeof(size_t))) != NULL)
+        *refs = 1u;
+
+    return refs;
+}
+
+/* Packs the lists of a graph into a new arena of its own
+ * (empty lists are left as they are).
+ *
+ *  graph       - the graph
+ *
+ * Returns 0 or -1 if failed (nothing is changed).
+ */
+static int _gph_pck(graph_t *graph)
+{
+    size_t total = 0u;
+    for(size_t i = 0u; i < graph->_n; ++i)
+        total += graph->_list[i]->_narch;
+
+    index_t *arena = NULL;
+    size_t *refs = NULL;
+    if((arena = (index_t *) malloc(sizeof(index_t) * ((total > 0u) ? total : 1u))) == NULL ||
+       (refs = _gph_arc()) == NULL)
+    {
+        free(arena);
+        return -1;
+    }
+
+    size_t off = 0u;
+    for(size_t i = 0u; i < graph->_n; ++i)
+    {
+        vertex_t *v = graph->_list[i];
+        if(v->_narch == 0u)
+            continue;
+
+        memcpy(arena + off, v->_arch, sizeof(index_t) * v->_narch);
+        if(! _gph_own(graph, v->_arch))
+            free(v->_arch);
+
+        v->_arch = arena + off;
+        off += v->_narch;
+    }
+
+    _gph_arl(graph);
+    graph->_arena  = arena;
+    graph->_narena = total;
+    graph->_arefs  = refs;
+
+    return 0;
+}
 
 /* Creates new vertex.
  *
@@ -24,7 +232,7 @@ vertex_t *gph_new_vtx(index_t *conn, index_t nconn)
         return NULL;
 
     /* List alloc */
-    if((v->_arch = (index_t *) calloc(1u, sizeof(index_t))) == NULL)
+    if((v->_arch = (index_t *) calloc((conn && nconn > 0u) ? nconn : 1u, sizeof(index_t))) == NULL)
     {
         free(v);
         return NULL;
@@ -37,6 +245,7 @@ vertex_t *gph_new_vtx(index_t *conn, index_t nconn)
         v->_narch = nconn;
     }
 
+    _gph_tch(v);
     return v;
 }
 
@@ -82,12 +291,429 @@ graph_t *gph_new(size_t n)
         }
     }
 
-    g->_n    = 0u;
-    g->_nmem = n;
+    g->_n      = 0u;
+    g->_nmem   = n;
+    g->_arena  = NULL;
+    g->_narena = 0u;
+    g->_arefs  = NULL;
+    g->_sync   = NULL;
 
     return g;
 }
 
+/* BUILD: shared state */
+typedef struct _gph_bld_job_t
+{
+    size_t          _n;         /* # of vertices */
+    const index_t  *_arch;      /* Arches, pairs */
+    size_t          _narch;     /* # of arches */
+    size_t          _nthr;      /* # of threads */
+
+    size_t         *_pos;       /* Per thread and vertex: # of arches, then where they go (_nthr x _n) */
+    size_t         *_off;       /* Where each list starts in the arena (_n + 1) */
+    index_t        *_arena;     /* All the lists */
+    size_t         *_len;       /* Length of each list without duplicates */
+    atomic_size_t   _next;      /* Next vertex to be sorted */
+    atomic_int      _fail;      /* Set if any thread ran out of memory */
+
+} bld_job_t;
+
+/* BUILD: single thread state */
+typedef struct _gph_bld_wrk_t
+{
+    bld_job_t      *_job;
+    size_t          _t;         /* Thread # */
+    void         *(*_fn)(struct _gph_bld_wrk_t *);
+
+} bld_wrk_t;
+
+/* BUILD: runs a phase on all the threads (the 1st one is the calling one) */
+static void *_gph_bld_thr(void *arg)
+{
+    bld_wrk_t *w = (bld_wrk_t *) arg;
+    return w->_fn(w);
+}
+
+/* BUILD: runs a phase on all the threads, the calling one included */
+static void _gph_bld_par(bld_job_t *job, void *(*fn)(bld_wrk_t *))
+{
+    pthread_t thr[GLO_MAX_THREADS];
+    bld_wrk_t wrk[GLO_MAX_THREADS];
+    size_t started = 1u;
+
+    for(size_t t = 0u; t < job->_nthr; ++t)
+    {
+        wrk[t]._job = job;
+        wrk[t]._t = t;
+        wrk[t]._fn = fn;
+    }
+
+    /* Whatever could not be started is done here after the joins */
+    for(; started < job->_nthr; ++started)
+    {
+        if(pthread_create(&thr[started], NULL, _gph_bld_thr, &wrk[started]) != 0)
+            break;
+    }
+
+    fn(&wrk[0u]);
+    for(size_t t = 1u; t < started; ++t)
+        pthread_join(thr[t], NULL);
+
+    for(size_t t = started; t < job->_nthr; ++t)
+        fn(&wrk[t]);
+}
+
+/* BUILD, 1st phase: counts arches of each vertex in the slice of the thread */
+static void *_gph_bld_cnt(bld_wrk_t *w)
+{
+    const bld_job_t *job = w->_job;
+    size_t *cnt = job->_pos + w->_t * job->_n;
+    const size_t beg = job->_narch * w->_t / job->_nthr, end = job->_narch * (w->_t + 1u) / job->_nthr;
+
+    for(size_t i = beg; i < end; ++i)
+    {
+        const index_t a = job->_arch[2u * i], b = job->_arch[2u * i + 1u];
+        if(a < job->_n && b < job->_n)
+            ++cnt[a];
+    }
+
+    return NULL;
+}
+
+/* BUILD, 2nd phase: scatters the slice of the thread into the arena */
+static void *_gph_bld_sct(bld_wrk_t *w)
+{
+    const bld_job_t *job = w->_job;
+    size_t *pos = job->_pos + w->_t * job->_n;
+    const size_t beg = job->_narch * w->_t / job->_nthr, end = job->_narch * (w->_t + 1u) / job->_nthr;
+
+    for(size_t i = beg; i < end; ++i)
+    {
+        const index_t a = job->_arch[2u * i], b = job->_arch[2u * i + 1u];
+        if(a < job->_n && b < job->_n)
+            job->_arena[pos[a]++] = b;
+    }
+
+    return NULL;
+}
+
+/* BUILD, 3rd phase: deduplicates and sorts lists, a chunk of vertices at a time */
+static void *_gph_bld_srt(bld_wrk_t *w)
+{
+    bld_job_t *job = w->_job;
+    const size_t n = job->_n;
+
+    /* Last vertex that has seen each one (+ 1), and a sorting buffer */
+    uint32_t *seen = NULL;
+    index_t *tmp = NULL;
+    if((seen = (uint32_t *) calloc(n, sizeof(uint32_t))) == NULL ||
+       (tmp = (index_t *) malloc(sizeof(index_t) * n)) == NULL)
+    {
+        free(seen);
+        atomic_store(&job->_fail, 1);
+        return NULL;
+    }
+
+    while(1)
+    {
+        const size_t beg = atomic_fetch_add(&job->_next, GPH_BLD_CHUNK);
+        if(beg >= n)
+            break;
+
+        const size_t end = (beg + GPH_BLD_CHUNK < n) ? beg + GPH_BLD_CHUNK : n;
+        for(size_t a = beg; a < end; ++a)
+        {
+            index_t *list = job->_arena + job->_off[a];
+            const size_t len = job->_off[a + 1u] - job->_off[a];
+
+            /* Dedup, first ones are kept */
+            size_t k = 0u;
+            for(size_t i = 0u; i < len; ++i)
+            {
+                if(seen[list[i]] == (uint32_t) a + 1u)
+                    continue;
+
+                seen[list[i]] = (uint32_t) a + 1u;
+                list[k++] = list[i];
+            }
+            job->_len[a] = k;
+
+            /* Sort, insertion for short lists, LSD radix (2 x 8 bits) otherwise */
+            if(k < GPH_BLD_RADIX_MIN)
+            {
+                for(size_t i = 1u; i < k; ++i)
+                {
+                    const index_t x = list[i];
+                    size_t j = i;
+                    for(; j > 0u && list[j - 1u] > x; --j)
+                        list[j] = list[j - 1u];
+                    list[j] = x;
+                }
+                continue;
+            }
+
+            index_t *src = list, *dst = tmp;
+            for(unsigned shift = 0u; shift < 16u; shift += 8u)
+            {
+                size_t cnt[256] = {0u, };
+                for(size_t i = 0u; i < k; ++i)
+                    ++cnt[(src[i] >> shift) & 0xFFu];
+
+                size_t sum = 0u;
+                for(size_t d = 0u; d < 256u; ++d)
+                {
+                    const size_t c = cnt[d];
+                    cnt[d] = sum;
+                    sum += c;
+                }
+
+                for(size_t i = 0u; i < k; ++i)
+                    dst[cnt[(src[i] >> shift) & 0xFFu]++] = src[i];
+
+                index_t *t = src;
+                src = dst;
+                dst = t;
+            }
+        }
+    }
+
+    free(seen);
+    free(tmp);
+    return NULL;
+}
+
+/* Builds a graph out of an arch array at once.
+ * Each list comes out sorted ascending, without duplicates.
+ * The lists are built in parallel into one block (arena),
+ * owned by the graph.
+ *
+ *  n           - # of vertices
+ *  arch        - arches, pairs one after another (A0, B0, A1, B1, ...)
+ *  narch       - # of arches (pairs)
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gph_bld(size_t n, const index_t *arch, size_t narch)
+{
+    assert(n < UINT16_MAX && (arch || narch == 0u));
+
+    graph_t *g = NULL;
+    if((g = gph_new((n > 0u) ? n : 1u)) == NULL)
+        return NULL;
+
+    g->_n = n;
+    if(n == 0u || narch == 0u)
+        return g;
+
+    bld_job_t job;
+    job._n = n;
+    job._arch = arch;
+    job._narch = narch;
+    job._nthr = (narch / GPH_BLD_MIN_PER_THREAD < msc_cpu()) ? narch / GPH_BLD_MIN_PER_THREAD : msc_cpu();
+    job._nthr = (job._nthr > 0u) ? job._nthr : 1u;
+    job._pos = NULL;
+    job._off = NULL;
+    job._len = NULL;
+    atomic_init(&job._next, 0u);
+    atomic_init(&job._fail, 0);
+
+    if((job._pos = (size_t *) calloc(job._nthr * n, sizeof(size_t))) == NULL ||
+       (job._off = (size_t *) malloc(sizeof(size_t) * (n + 1u))) == NULL ||
+       (job._len = (size_t *) malloc(sizeof(size_t) * n)) == NULL)
+        goto FAIL;
+
+    /* Degrees */
+    _gph_bld_par(&job, _gph_bld_cnt);
+
+    /* Offsets: by vertex, then by thread within the vertex (so arches keep their order) */
+    size_t total = 0u;
+    for(size_t a = 0u; a < n; ++a)
+    {
+        job._off[a] = total;
+        for(size_t t = 0u; t < job._nthr; ++t)
+        {
+            const size_t c = job._pos[t * n + a];
+            job._pos[t * n + a] = total;
+            total += c;
+        }
+    }
+    job._off[n] = total;
+
+    if(total == 0u)
+    {
+        free(job._pos);
+        free(job._off);
+        free(job._len);
+        return g;
+    }
+
+    if((job._arena = (index_t *) malloc(sizeof(index_t) * total)) == NULL)
+        goto FAIL;
+    g->_arena = job._arena;
+    g->_narena = total;
+    if((g->_arefs = _gph_arc()) == NULL)
+        goto FAIL;
+
+    /* Lists */
+    _gph_bld_par(&job, _gph_bld_sct);
+    _gph_bld_par(&job, _gph_bld_srt);
+    if(atomic_load(&job._fail))
+        goto FAIL;
+
+    /* Vertices get their part of the arena */
+    for(size_t a = 0u; a < n; ++a)
+    {
+        vertex_t *v = g->_list[a];
+        if(job._len[a] > 0u)
+        {
+            free(v->_arch);
+            v->_arch = job._arena + job._off[a];
+            v->_narch = (index_t) job._len[a];
+        }
+        _gph_tch(v);
+    }
+
+    free(job._pos);
+    free(job._off);
+    free(job._len);
+    return g;
+
+    FAIL:;
+    free(job._pos);
+    free(job._off);
+    free(job._len);
+    gph_fre(g);
+    return NULL;
+}
+
+/* Makes a deep copy of graph.
+ *
+ *  graph       - the original
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gph_cpy(const graph_t *graph)
+{
+    assert(graph);
+
+    graph_t *g = NULL;
+    if((g = gph_new((graph->_n > 0u) ? graph->_n : 1u)) == NULL)
+        return NULL;
+
+    for(size_t i = 0u; i < graph->_n; ++i)
+    {
+        const vertex_t *v = graph->_list[i];
+        vertex_t *copy = NULL;
+
+        if((copy = gph_new_vtx(v->_arch, v->_narch)) == NULL)
+        {
+            gph_fre(g);
+            return NULL;
+        }
+        copy->_ver = v->_ver;
+
+        free(g->_list[i]->_arch);
+        free(g->_list[i]);
+        g->_list[i] = copy;
+        ++(g->_n);
+    }
+
+    return g;
+}
+
+/* Makes a clone of graph, sharing its arena lists.
+ *
+ *  graph       - the original (not changed)
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gph_shr(const graph_t *graph)
+{
+    assert(graph);
+
+    graph_t *g = NULL;
+    if((g = gph_new(1u)) == NULL)
+        return NULL;
+
+    /* Slots only, the vertices are made below */
+    if(graph->_n > 1u)
+    {
+        vertex_t **temp = NULL;
+        if((temp = (vertex_t **) realloc(g->_list, sizeof(vertex_t *) * graph->_n)) == NULL)
+        {
+            gph_fre(g);
+            return NULL;
+        }
+
+        g->_list = temp;
+        for(size_t i = g->_nmem; i < graph->_n; ++i)
+            g->_list[i] = NULL;
+        g->_nmem = graph->_n;
+    }
+
+    /* The arena is shared before any list is */
+    if(graph->_arena)
+    {
+        __atomic_add_fetch(graph->_arefs, 1u, __ATOMIC_ACQ_REL);
+        g->_arena  = graph->_arena;
+        g->_narena = graph->_narena;
+        g->_arefs  = graph->_arefs;
+    }
+
+    for(size_t i = 0u; i < graph->_n; ++i)
+    {
+        const vertex_t *v = graph->_list[i];
+        vertex_t *copy = NULL;
+
+        /* Lists in the arena are shared, the rest is copied */
+        if(! _gph_own(graph, v->_arch))
+            copy = gph_new_vtx(v->_arch, v->_narch);
+        else if((copy = (vertex_t *) calloc(1u, sizeof(vertex_t))) != NULL)
+        {
+            copy->_arch  = v->_arch;
+            copy->_narch = v->_narch;
+        }
+
+        if(copy == NULL)
+        {
+            gph_fre(g);
+            return NULL;
+        }
+        copy->_ver = v->_ver;
+
+        if(g->_list[i])
+            gph_vfr(g, g->_list[i]);
+        g->_list[i] = copy;
+        ++(g->_n);
+    }
+
+    /* Mostly copied: packed, so its clones are cheap */
+    if(_gph_spr(graph) && _gph_pck(g) != 0)
+    {
+        gph_fre(g);
+        return NULL;
+    }
+
+    return g;
+}
+
+/* Makes a clone of graph, sharing its lists.
+ *
+ *  graph       - the original (its lists may be moved)
+ *
+ * Returns NULL if failed.
+ */
+graph_t *gph_cln(graph_t *graph)
+{
+    assert(graph);
+
+    /* Mostly outside the arena: packed first */
+    if(_gph_spr(graph) && _gph_pck(graph) != 0)
+        return NULL;
+
+    return gph_shr(graph);
+}
+
 /* Frees graph.
  *
  *  graph       - the victim
@@ -98,16 +724,83 @@ void gph_fre(graph_t *graph)
 
     /* For each vertex */
     for(size_t i = 0; i < graph->_n; ++i)
+        gph_vfr(graph, graph->_list[i]);
+
+    /* Spare ones (preallocated) */
+    for(size_t i = graph->_n; i < graph->_nmem; ++i)
     {
-        free(graph->_list[i]->_arch);
-        free(graph->_list[i]);
+        if(graph->_list[i])
+            gph_vfr(graph, graph->_list[i]);
     }
 
+    gph_syn(graph, 0);
+    _gph_arl(graph);
     free(graph->_list);
     free(graph);
     graph = NULL;
 }
 
+/* Frees a vertex of the graph (taken out of it before).
+ *
+ *  graph       - the graph
+ *  v           - the victim
+ */
+void gph_vfr(graph_t *graph, vertex_t *v)
+{
+    assert(graph && v);
+
+    if(! _gph_own(graph, v->_arch))
+        free(v->_arch);
+    free(v);
+}
+
+/* Turns concurrent mode on or off. Must not be
+ * called while other threads use the graph.
+ *
+ *  graph       - the graph
+ *  on          - 1 - on, 0 - off
+ *
+ * Returns 0 or -1 if failed.
+ */
+int gph_syn(graph_t *graph, int on)
+{
+    assert(graph);
+
+    struct _gph_sync_t *s = graph->_sync;
+
+    /* Off */
+    if(on == 0)
+    {
+        if(s == NULL)
+            return 0;
+
+        for(size_t i = 0u; i < GPH_SYNC_STRIPES; ++i)
+            pthread_rwlock_destroy(&s->_stripe[i]);
+        pthread_mutex_destroy(&s->_grow);
+
+        for(size_t i = 0u; i < s->_nold; ++i)
+            free(s->_old[i]);
+
+        free(s);
+        graph->_sync = NULL;
+        return 0;
+    }
+
+    /* On */
+    if(s != NULL)
+        return 0;
+
+    if((s = (struct _gph_sync_t *) calloc(1u, sizeof(struct _gph_sync_t))) == NULL)
+        return -1;
+
+    for(size_t i = 0u; i < GPH_SYNC_STRIPES; ++i)
+        pthread_rwlock_init(&s->_stripe[i], NULL);
+    pthread_mutex_init(&s->_grow, NULL);
+
+    graph->_sync = s;
+    return 0;
+}
+
 /* Adds new vertex to the graph. Resizes if needed. 
  *
  * graph        - destination
@@ -119,47 +812,96 @@ size_t gph_add(graph_t *graph, vertex_t *copy)
 {
     assert(graph);
 
+    /* Adding is serialised, readers are not stopped */
+    if(graph->_sync)
+        pthread_mutex_lock(&graph->_sync->_grow);
+
+    size_t result = 1u;
+    const size_t n = graph->_n;
+
     /* Reallocating if needed */
-    if(graph->_n >= graph->_nmem)
+    if(n >= graph->_nmem)
     {
         vertex_t **temp = NULL;
-        if((temp = (vertex_t **) realloc(graph->_list, sizeof(vertex_t *) * graph->_nmem * 2u)) == NULL)
-            return (size_t) -1;
 
-        graph->_list = temp;
+        /* Concurrent: readers may still be using the old list, it is kept */
+        if(graph->_sync && graph->_sync->_nold >= GPH_SYNC_MAX_LISTS)
+            temp = NULL;
+        else if(graph->_sync)
+        {
+            if((temp = (vertex_t **) malloc(sizeof(vertex_t *) * graph->_nmem * 2u)) != NULL)
+                memcpy(temp, graph->_list, sizeof(vertex_t *) * n);
+        }
+        else
+            temp = (vertex_t **) realloc(graph->_list, sizeof(vertex_t *) * graph->_nmem * 2u);
+
+        if(temp == NULL)
+        {
+            result = (size_t) -1;
+            goto END;
+        }
 
-        /* New vertices init (if copy is NULL) */
-        for(size_t i = graph->_n; (i < graph->_nmem * 2u) && (copy == NULL); ++i)
+        /* New vertices init (empty slots if copy is given) */
+        for(size_t i = n; i < graph->_nmem * 2u; ++i)
         {
-            if((graph->_list[i] = gph_new_vtx(NULL, 0u)) == NULL)
+            if(copy)
+                temp[i] = NULL;
+            else if((temp[i] = gph_new_vtx(NULL, 0u)) == NULL)
             {
                 /* Partial list freeing if failed */
-                for(size_t j = graph->_n; j < i; ++j)
-                    free(graph->_list[j]);
+                for(size_t j = n; j < i; ++j)
+                    gph_vfr(graph, temp[j]);
+
+                /* Nothing published, the list keeps its size (realloc() has moved it though) */
+                if(graph->_sync)
+                    free(temp);
+                else
+                    graph->_list = temp;
 
-                return (size_t) -1;
+                result = (size_t) -1;
+                goto END;
             }
         }
 
+        /* Published after the init, so a reader never gets a half-made list */
+        if(graph->_sync)
+            graph->_sync->_old[graph->_sync->_nold++] = graph->_list;
+        __atomic_store_n(&graph->_list, temp, __ATOMIC_RELEASE);
+
         graph->_nmem *= 2u;
+
+        if(copy)
+            graph->_list[n] = copy;
     }
 
     /* No copy, creating fresh vertex */
     else if(copy == NULL)
     {
-        free(graph->_list[graph->_n]);
-        if((graph->_list[graph->_n] = gph_new_vtx(NULL, 0u)) == NULL)
-            return (size_t) -1; 
+        if(graph->_list[n])
+            gph_vfr(graph, graph->_list[n]);
+        if((graph->_list[n] = gph_new_vtx(NULL, 0u)) == NULL)
+        {
+            result = (size_t) -1;
+            goto END;
+        }
     }
 
     /* Copy */
     else 
     {
-        graph->_list[graph->_n] = copy;
+        if(graph->_list[n])
+            gph_vfr(graph, graph->_list[n]);
+        graph->_list[n] = copy;
     }
     
-    (graph->_n)++;
-    return 1u;
+    /* Readers see the vertex from now on */
+    __atomic_store_n(&graph->_n, n + 1u, __ATOMIC_RELEASE);
+
+    END:;
+    if(graph->_sync)
+        pthread_mutex_unlock(&graph->_sync->_grow);
+
+    return result;
 }
 
 /* Removes vertex from graph. Moves
@@ -174,6 +916,10 @@ size_t gph_del(graph_t *graph, index_t index)
 {
     assert(graph);
 
+    /* Indexes of others would change under their hands */
+    if(graph->_sync)
+        return (size_t) -1;
+
     if(index == GPH_LAST && graph->_n > 0u)
         index = graph->_n - 1u;
     else if(index == GPH_LAST)
@@ -185,6 +931,7 @@ size_t gph_del(graph_t *graph, index_t index)
 
     /* How many have been affected? */
     size_t result = 0u;
+    vertex_t *victim = graph->_list[index];
 
     /* Moving pointers to the left */
     for(size_t i = index; i < graph->_n - 1u; ++i)
@@ -194,6 +941,10 @@ size_t gph_del(graph_t *graph, index_t index)
     }
     (graph->_n)--;
 
+    /* The freed slot must not point at the last vertex (gph_add() frees it) */
+    gph_vfr(graph, victim);
+    graph->_list[graph->_n] = NULL;
+
     /* Fixing arches for each vertex */
     for(size_t i = 0u; i < graph->_n; ++i)
     {
@@ -204,7 +955,13 @@ size_t gph_del(graph_t *graph, index_t index)
         for(size_t j = 0u; j < graph->_list[i]->_narch; ++j)
         {
             if(graph->_list[i]->_arch[j] >= index && graph->_list[i]->_arch[j] > 0u)
+            {
+                if(_gph_mut(graph, graph->_list[i]) != 0)
+                    return (size_t) -1;
+
                 (graph->_list[i]->_arch[j])--;
+                _gph_tch(graph->_list[i]);
+            }
         }
 
         /* Deleting dups */
@@ -239,43 +996,52 @@ size_t gph_con(graph_t *graph, index_t a, index_t b, int op)
 {
     assert(graph && (op == GPH_ADD || op == GPH_DELETE));
 
+    const size_t n = _gph_len(graph);
+
     /* Conversion */
-    if(a == GPH_LAST && graph->_n > 0u)
-        a = graph->_n - 1u;
+    if(a == GPH_LAST && n > 0u)
+        a = n - 1u;
     else if(a == GPH_LAST)
         a = 0u;
     
-    if(b == GPH_LAST && graph->_n > 0u)
-        b = graph->_n - 1u;
+    if(b == GPH_LAST && n > 0u)
+        b = n - 1u;
     else if(b == GPH_LAST)
         b = 0u;
 
     /* Validation */
-    if(a >= graph->_n || b >= graph->_n)
+    if(a >= n || b >= n)
         return 0u;
 
+    vertex_t *v = _gph_vtx(graph, a);
+    size_t result = 0u;
+    _gph_lck(graph, a, GPH_LAST, 1);
+
     /* ADDING */
     
     if(op != GPH_ADD)
         goto DEL;
 
     /* Search for a duplicate */
-    for(size_t i = 0u; i < graph->_list[a]->_narch; ++i)
+    for(size_t i = 0u; i < v->_narch; ++i)
     {
-        if(graph->_list[a]->_arch[i] == b)
-            return 0u;
+        if(v->_arch[i] == b)
+            goto END;
     }
 
     /* List realloc */
-    index_t *temp = NULL;
-    if((temp = (index_t *) realloc(graph->_list[a]->_arch, sizeof(index_t) * (graph->_list[a]->_narch + 1u))) == NULL)
-        return (size_t) -1;
+    if(_gph_rsz(graph, v, v->_narch + 1u) != 0)
+    {
+        result = (size_t) -1;
+        goto END;
+    }
 
-    graph->_list[a]->_arch = temp;
-    graph->_list[a]->_arch[graph->_list[a]->_narch] = b;
-    ++(graph->_list[a]->_narch);
+    v->_arch[v->_narch] = b;
+    ++(v->_narch);
+    _gph_tch(v);
     
-    return 1u;
+    result = 1u;
+    goto END;
 
 
     /* DELETING */
@@ -283,28 +1049,108 @@ size_t gph_con(graph_t *graph, index_t a, index_t b, int op)
     DEL:;
 
     /* Validation */
-    if(graph->_list[a]->_narch == 0u)
-        return 0u;
+    if(v->_narch == 0u)
+        goto END;
 
     /* Looking for the arch */
     index_t arch_idx = 0u;
-    for(; arch_idx < graph->_list[a]->_narch; ++arch_idx)
+    for(; arch_idx < v->_narch; ++arch_idx)
     {
-        if(graph->_list[a]->_arch[arch_idx] == b)
+        if(v->_arch[arch_idx] == b)
             break;
         
     }
 
     /* Found? */
-    if(arch_idx == graph->_list[a]->_narch)
-        return 0u; /* Nah */
+    if(arch_idx == v->_narch)
+        goto END; /* Nah */
 
     /* Moving to the left */
-    for(index_t i = arch_idx; i < graph->_list[a]->_narch - 1u; ++i)
-        graph->_list[a]->_arch[i] = graph->_list[a]->_arch[i + 1u];
+    if(_gph_mut(graph, v) != 0)
+    {
+        result = (size_t) -1;
+        goto END;
+    }
+
+    for(index_t i = arch_idx; i < v->_narch - 1u; ++i)
+        v->_arch[i] = v->_arch[i + 1u];
+
+    (v->_narch)--;
+    _gph_tch(v);
+    result = 1u;
 
-    (graph->_list[a]->_narch)--;
-    return 1u;
+    END:;
+    _gph_unl(graph, a, GPH_LAST);
+    return result;
+}
+
+/* Adds arches from A to all the listed vertices at once
+ * (a single list realloc). Ones already there are skipped.
+ *
+ *  graph       - the graph containing A and the listed vertices
+ *  a           - A index
+ *  list        - the vertices, ascending, without duplicates
+ *  nlist       - their #
+ *
+ * Returns # of added arches or -1 if failed.
+ */
+size_t gph_ext(graph_t *graph, index_t a, const index_t *list, size_t nlist)
+{
+    assert(graph && (list || nlist == 0u));
+
+    const size_t n = _gph_len(graph);
+
+    /* Validation (only the last one needs checking, the list is ascending) */
+    if(a >= n || nlist == 0u)
+        return 0u;
+    while(nlist > 0u && list[nlist - 1u] >= n)
+        --nlist;
+
+    /* Arches already there, marked (the list is small, so on the stack if possible) */
+    char mark[GPH_EXT_STACK], *drop = mark;
+    if(nlist > GPH_EXT_STACK && (drop = (char *) malloc(nlist)) == NULL)
+        return (size_t) -1;
+    memset(drop, 0, nlist);
+
+    vertex_t *v = _gph_vtx(graph, a);
+    size_t result = 0u;
+    _gph_lck(graph, a, GPH_LAST, 1);
+
+    size_t fresh = nlist;
+    for(size_t i = 0u; i < v->_narch; ++i)
+    {
+        const index_t *found = (const index_t *) bsearch(&v->_arch[i], list, nlist, sizeof(index_t), _gph_sort_asc);
+        if(found && drop[found - list] == 0)
+        {
+            drop[found - list] = 1;
+            --fresh;
+        }
+    }
+
+    /* Nothing new, or too many for the list length */
+    if(fresh == 0u || v->_narch + fresh > UINT16_MAX)
+        goto END;
+
+    if(_gph_rsz(graph, v, v->_narch + fresh) != 0)
+    {
+        result = (size_t) -1;
+        goto END;
+    }
+
+    for(size_t i = 0u; i < nlist; ++i)
+    {
+        if(drop[i] == 0)
+            v->_arch[(v->_narch)++] = list[i];
+    }
+    _gph_tch(v);
+    result = fresh;
+
+    END:;
+    _gph_unl(graph, a, GPH_LAST);
+    if(drop != mark)
+        free(drop);
+
+    return result;
 }
 
 /* Indicates the type of arch between A and B.
@@ -319,27 +1165,31 @@ int gph_typ(const graph_t *graph, index_t a, index_t b)
 {
     assert(graph);
 
+    const size_t n = _gph_len(graph);
+
     /* Conversion */
-    if(a == GPH_LAST && graph->_n > 0u)
-        a = graph->_n - 1u;
+    if(a == GPH_LAST && n > 0u)
+        a = n - 1u;
     else if(a == GPH_LAST)
         a = 0u;
     
-    if(b == GPH_LAST && graph->_n > 0u)
-        b = graph->_n - 1u;
+    if(b == GPH_LAST && n > 0u)
+        b = n - 1u;
     else if(b == GPH_LAST)
         b = 0u;
 
     /* Validation */
-    if(a >= graph->_n || b >= graph->_n)
+    if(a >= n || b >= n)
         return -1;
 
+    const vertex_t *va = _gph_vtx(graph, a), *vb = _gph_vtx(graph, b);
     int type = GPH_NONE;
+    _gph_lck(graph, a, b, 0);
 
     /* Searching A -> B */
-    for(index_t i = 0u; i < graph->_list[a]->_narch; ++i)
+    for(index_t i = 0u; i < va->_narch; ++i)
     {
-        if(graph->_list[a]->_arch[i] == b)
+        if(va->_arch[i] == b)
         {
             /* Found */
             ++type;
@@ -348,9 +1198,9 @@ int gph_typ(const graph_t *graph, index_t a, index_t b)
     }
 
     /* Searching B -> A */
-    for(index_t i = 0u; i < graph->_list[b]->_narch; ++i)
+    for(index_t i = 0u; i < vb->_narch; ++i)
     {
-        if(graph->_list[b]->_arch[i] == a && type == GPH_ONEWAY)
+        if(vb->_arch[i] == a && type == GPH_ONEWAY)
         {
             /* Found */
             ++type;
@@ -358,6 +1208,7 @@ int gph_typ(const graph_t *graph, index_t a, index_t b)
         }
     }
 
+    _gph_unl(graph, a, b);
     return type;
 }
 
@@ -378,37 +1229,59 @@ void gph_out(const graph_t *graph, FILE *stream, int settings)
         return;
     }
 
+    /* Lists are sorted on the side, the graph can be shared with other readers */
+    index_t *sorted = NULL;
+    if(settings & (GPH_SET_SORT_ASC | GPH_SET_SORT_DES))
+    {
+        size_t max = 1u;
+        for(size_t i = 0u; i < graph->_n; ++i)
+            if(graph->_list[i]->_narch > max)
+                max = graph->_list[i]->_narch;
+
+        /* Printed unsorted if there is no memory */
+        sorted = (index_t *) malloc(sizeof(index_t) * max);
+    }
+
     for(size_t i = 0u; i < graph->_n; ++i)
     {
-        /* GPH_SET_SORT_ASC */
-        if(settings & GPH_SET_SORT_ASC)
-            qsort(graph->_list[i]->_arch, graph->_list[i]->_narch, sizeof(index_t), _gph_sort_asc);
+        const index_t *arch = graph->_list[i]->_arch;
+        const size_t narch = graph->_list[i]->_narch;
 
-        /* GPH_SET_SORT_DES */
-        else if(settings & GPH_SET_SORT_DES)
-            qsort(graph->_list[i]->_arch, graph->_list[i]->_narch, sizeof(index_t), _gph_sort_des);
+        if(sorted)
+        {
+            memcpy(sorted, arch, sizeof(index_t) * narch);
+            arch = sorted;
+
+            /* GPH_SET_SORT_ASC */
+            if(settings & GPH_SET_SORT_ASC)
+                qsort(sorted, narch, sizeof(index_t), _gph_sort_asc);
+
+            /* GPH_SET_SORT_DES */
+            else
+                qsort(sorted, narch, sizeof(index_t), _gph_sort_des);
+        }
 
 
         fprintf(stream, "%16zu: [", i);
 
-        for(size_t j = 0u; j < graph->_list[i]->_narch; ++j)
+        for(size_t j = 0u; j < narch; ++j)
         {
             /* GPH_SET_MARK_DUAL */
             if(settings & GPH_SET_MARK_DUAL && (stream == stdout || stream == stderr))
             {
-                if(i == graph->_list[i]->_arch[j])
+                if(i == arch[j])
                     col_set(MAGENTA);
             
-                else if(gph_typ(graph, i, graph->_list[i]->_arch[j]) == GPH_TWOWAY)
+                else if(gph_typ(graph, i, arch[j]) == GPH_TWOWAY)
                     col_set(CYAN);
             }
             
-            fprintf(stream, "%hu", graph->_list[i]->_arch[j]);
+            fprintf(stream, "%hu", arch[j]);
 
             if(settings & GPH_SET_MARK_DUAL && (stream == stdout || stream == stderr))
                 col_set(COLOR_DEFAULT);
 
-            if(j < graph->_list[i]->_narch - 1u)
+            if(j < narch - 1u)
                 fprintf(stream, ", ");
         }
         fprintf(stream, "]\t");
@@ -422,6 +1295,8 @@ void gph_out(const graph_t *graph, FILE *stream, int settings)
             fprintf(stream, buf);
         }
     }
+
+    free(sorted);
 }
 
 /* Gives statistics
@@ -464,6 +1339,15 @@ void gph_cnt(const graph_t *graph, size_t *o_single, size_t *o_double, size_t *o
     (*o_double) /= 2u;
 }
 
+/* Gives the last version stamp given to any vertex.
+ *
+ * Returns the stamp.
+ */
+uint32_t gph_stp(void)
+{
+    return __atomic_load_n(&g_stamp, __ATOMIC_RELAXED);
+}
+
 
 
 /* Sorts indexes ascending */
@@ -4,6 +4,12 @@
  *  Implements simple graph object.
  *  Each graph consists of finite number
  *  of vertices, connected via arches.
+ *
+ *  A graph in concurrent mode (see gph_syn())
+ *  can be used by many threads at once, but only
+ *  through gph_add(), gph_con(), gph_ext() and gph_typ().
+ *  Lists are guarded by striped locks, adding
+ *  vertices does not stop the others.
  * 
  *  By Aleksander Slepowronski.
  */
@@ -33,6 +39,15 @@
 #define GPH_SET_SORT_ASC        (1 << 1)        /* PRINT: Sorts arches for each vertex (ascending) */
 #define GPH_SET_SORT_DES        (1 << 2)        /* PRINT: Sorts arches for each vertex (descending) */
 
+#define GPH_SYNC_STRIPES        64u             /* CONCURRENT: # of vertex locks */
+#define GPH_SYNC_MAX_LISTS      32u             /* CONCURRENT: Max. # of times the vertex list can grow */
+
+#define GPH_EXT_STACK           256u            /* EXTEND: Max. # of listed vertices checked without malloc */
+
+#define GPH_BLD_MIN_PER_THREAD  65536u          /* BUILD: Min. # of arches worth another thread */
+#define GPH_BLD_CHUNK           64u             /* BUILD: # of lists sorted by a thread at once */
+#define GPH_BLD_RADIX_MIN       64u             /* BUILD: Min. list length sorted with radix sort */
+
 
 /* An index */
 typedef uint16_t index_t;
@@ -42,6 +57,7 @@ typedef struct _gph_vertx_t
 {
     index_t   *_arch;          /* List of arches coming from this vertex */
     index_t   _narch;         /* The list length */
+    uint32_t  _ver;           /* Version stamp, new one on every change of the list */
 
 } vertex_t;
 
@@ -53,6 +69,12 @@ typedef struct _gph_graph_t
 
     vertex_t  **_list;           /* List of vertices (pointers) */
 
+    index_t    *_arena;          /* Lists made by gph_bld() or gph_cln(), one block (NULL if none) */
+    size_t      _narena;         /* Its length */
+    size_t     *_arefs;          /* # of graphs sharing the arena (NULL if no arena) */
+
+    struct _gph_sync_t *_sync;   /* Locks (concurrent mode), NULL otherwise */
+
 } graph_t;
 
 
@@ -73,12 +95,77 @@ vertex_t       *gph_new_vtx(index_t *conn, index_t nconn);
  */
 graph_t        *gph_new(size_t n);
 
+/* Builds a graph out of an arch array at once.
+ * Each list comes out sorted ascending, without duplicates.
+ * The lists are built in parallel into one block (arena),
+ * owned by the graph.
+ *
+ *  n           - # of vertices
+ *  arch        - arches, pairs one after another (A0, B0, A1, B1, ...)
+ *  narch       - # of arches (pairs)
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gph_bld(size_t n, const index_t *arch, size_t narch);
+
+/* Makes a deep copy of graph. Vertices keep
+ * their version stamps (the lists are the same).
+ *
+ *  graph       - the original
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gph_cpy(const graph_t *graph);
+
+/* Makes a clone of graph, sharing its lists. Lists in
+ * the arena are never changed in place (they are copied
+ * out first), so both graphs can be edited freely. If
+ * most of the lists are outside the arena, they are
+ * packed into a new one first, so the next clones are cheap.
+ * Not to be called while other threads use the graph.
+ *
+ *  graph       - the original (its lists may be moved)
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gph_cln(graph_t *graph);
+
+/* Makes a clone of graph like gph_cln(), but the original
+ * is not touched at all, so other threads can go on reading
+ * it meanwhile. If most of the lists are outside the arena,
+ * the clone gets them packed into an arena of its own.
+ *
+ *  graph       - the original
+ *
+ * Returns NULL if failed.
+ */
+graph_t        *gph_shr(const graph_t *graph);
+
 /* Frees graph.
  *
  *  graph       - the victim
  */
 void            gph_fre(graph_t *graph);
 
+/* Frees a vertex of the graph (taken out of it before).
+ * Needed instead of free(), as the list may live in the arena.
+ *
+ *  graph       - the graph
+ *  v           - the victim
+ */
+void            gph_vfr(graph_t *graph, vertex_t *v);
+
+/* Turns concurrent mode on or off. Must not be
+ * called while other threads use the graph.
+ * Vertices cannot be deleted in concurrent mode.
+ *
+ *  graph       - the graph
+ *  on          - 1 - on, 0 - off
+ *
+ * Returns 0 or -1 if failed.
+ */
+int             gph_syn(graph_t *graph, int on);
+
 /* Adds new vertex to graph. 
  *
  *  graph       - destination
@@ -94,7 +181,7 @@ size_t          gph_add(graph_t *graph, vertex_t *copy);
  *  graph       - the graph to be affected
  *  n           - the vertex index, GPH_LAST can be used
  * 
- * Returns # of deleted vertices or -1 if failed.
+ * Returns # of deleted vertices or -1 if failed (or in concurrent mode).
  */
 size_t          gph_del(graph_t *graph, index_t index);
 
@@ -109,6 +196,18 @@ size_t          gph_del(graph_t *graph, index_t index);
  */
 size_t          gph_con(graph_t *graph, index_t a, index_t b, int op);
 
+/* Adds arches from A to all the listed vertices at once
+ * (a single list realloc). Ones already there are skipped.
+ *
+ *  graph       - the graph containing A and the listed vertices
+ *  a           - A index
+ *  list        - the vertices, ascending, without duplicates
+ *  nlist       - their #
+ *
+ * Returns # of added arches or -1 if failed.
+ */
+size_t          gph_ext(graph_t *graph, index_t a, const index_t *list, size_t nlist);
+
 /* Indicates the type of arch between A and B.
  *
  *  graph       - the graph to be analysed
@@ -136,6 +235,13 @@ void            gph_out(const graph_t *graph, FILE *stream, int settings);
  */
 void            gph_cnt(const graph_t *graph, size_t *o_single, size_t *o_double, size_t *o_isolated);
 
+/* Gives the last version stamp given to any vertex.
+ * It changes whenever a list of any graph changes.
+ *
+ * Returns the stamp.
+ */
+uint32_t        gph_stp(void);
+
 
 
 /* Sorts indexes ascending */
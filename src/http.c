@@ -4,14 +4,23 @@
 #else
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 
 #include "http.h"
@@ -24,6 +33,274 @@
 #define HTTP_TIME_OUT 360
 #endif
 
+#ifndef HTTP_READ_SIZE
+/* initial size of the receive buffer, also the size of most reads */
+#define HTTP_READ_SIZE 65536
+#endif
+
+#ifndef HTTP_MAX_BUFFER
+/* the receive buffer grows up to this size for data that can't be
+ * parsed yet (a very long header line); beyond that reading fails */
+#define HTTP_MAX_BUFFER (16 << 20)
+#endif
+
+#ifndef HTTP_IO_TICK
+/* longest single wait in non-blocking mode (ms); cancellation is
+ * noticed at least this often */
+#define HTTP_IO_TICK 100
+#endif
+
+#ifndef HTTP_POOL_HOSTS
+#define HTTP_POOL_HOSTS 4
+#endif
+
+#ifndef HTTP_POOL_IDLE
+#define HTTP_POOL_IDLE 4
+#endif
+
+#ifndef HTTP_POOL_MAX_AGE
+#define HTTP_POOL_MAX_AGE 30
+#endif
+
+/* pool entry; one per host, keeps the resolved address and idle sockets */
+struct http_pool_entry {
+	char host[256];
+	int resolved;
+	struct sockaddr_storage addr;
+	socklen_t addrlen;
+	int family;
+	int socktype;
+	int protocol;
+	int idle[HTTP_POOL_IDLE];
+	time_t since[HTTP_POOL_IDLE];
+	int nidle;
+};
+
+static struct http_pool_entry http_pool[HTTP_POOL_HOSTS];
+static int http_pool_next;
+static pthread_mutex_t http_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Close socket
+ *
+ * @param sd - socket
+ */
+static void http_close(int sd) {
+#ifdef WIN32
+	closesocket(sd);
+#else
+	close(sd);
+#endif
+}
+
+/**
+ * Get monotonic time in milliseconds
+ */
+static long long http_now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Switch socket between blocking and non-blocking mode
+ *
+ * @param sd - socket
+ * @param blocking - non-zero for blocking mode
+ */
+static int http_set_blocking(int sd, int blocking) {
+#ifdef _WIN32
+	u_long mode = !blocking;
+
+	return ioctlsocket(sd, FIONBIO, &mode) ? -1 : 0;
+#else
+	int flags = fcntl(sd, F_GETFL, 0);
+
+	if (flags < 0) {
+		return -1;
+	}
+
+	flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+
+	return fcntl(sd, F_SETFL, flags);
+#endif
+}
+
+/**
+ * Check if the last socket call failed only because it would block
+ */
+static int http_would_block(void) {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+#endif
+}
+
+/**
+ * Wait until socket is readable (or writable); gives up when
+ * the request is cancelled or a deadline passes
+ *
+ * @param io - non-blocking mode state
+ * @param sd - socket
+ * @param write - non-zero to wait for writability
+ * @param limit - max. wait in milliseconds, 0 means no limit
+ */
+static int http_io_wait(struct http_io *io, int sd, int write, int limit) {
+	long long now = http_now();
+	long long deadline = limit > 0 ? now + limit : 0;
+
+	if (io->deadline && (!deadline || io->deadline < deadline)) {
+		deadline = io->deadline;
+	}
+
+#ifdef __linux__
+	{
+		struct epoll_event ev;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = write ? EPOLLOUT : EPOLLIN;
+		ev.data.fd = sd;
+
+		if (io->sd != sd) {
+			if (io->sd > -1) {
+				epoll_ctl(io->fd, EPOLL_CTL_DEL, io->sd, NULL);
+			}
+
+			if (epoll_ctl(io->fd, EPOLL_CTL_ADD, sd, &ev)) {
+				io->sd = -1;
+				io->error = HTTP_IO_FAILED;
+				return -1;
+			}
+
+			io->sd = sd;
+		} else if (epoll_ctl(io->fd, EPOLL_CTL_MOD, sd, &ev)) {
+			io->error = HTTP_IO_FAILED;
+			return -1;
+		}
+	}
+#endif
+
+	for (;; now = http_now()) {
+		int tick = HTTP_IO_TICK;
+		int n;
+
+		if (io->cancel && *io->cancel) {
+			io->error = HTTP_IO_CANCELLED;
+			return -1;
+		}
+
+		if (deadline) {
+			if (now >= deadline) {
+				io->error = HTTP_IO_TIMEOUT;
+				return -1;
+			}
+
+			if (deadline - now < tick) {
+				tick = (int) (deadline - now);
+			}
+		}
+
+#ifdef __linux__
+		{
+			struct epoll_event ev;
+
+			n = epoll_wait(io->fd, &ev, 1, tick);
+		}
+#else
+		{
+			fd_set set;
+			struct timeval tv;
+
+			tv.tv_sec = tick / 1000;
+			tv.tv_usec = (tick % 1000) * 1000;
+
+			FD_ZERO(&set);
+			FD_SET(sd, &set);
+
+			n = write ?
+				select(sd + 1, NULL, &set, NULL, &tv) :
+				select(sd + 1, &set, NULL, NULL, &tv);
+		}
+#endif
+
+		if (n > 0) {
+			return 0;
+		}
+
+		/* a signal (e.g. Ctrl-C) interrupts the wait, the
+		 * cancel flag is checked right away */
+		if (n < 0 && errno != EINTR) {
+			io->error = HTTP_IO_FAILED;
+			return -1;
+		}
+	}
+}
+
+/**
+ * Create socket and connect it to the address; in non-blocking
+ * mode the connection must be made within the connect limit
+ *
+ * @param io - non-blocking mode state, may be NULL
+ * @param family - address family
+ * @param socktype - socket type
+ * @param protocol - protocol
+ * @param addr - address
+ * @param addrlen - address length
+ */
+static int http_connect_to(
+		struct http_io *io,
+		int family,
+		int socktype,
+		int protocol,
+		const struct sockaddr *addr,
+		socklen_t addrlen) {
+	int sd;
+
+	if ((sd = socket(family, socktype, protocol)) < 0) {
+		return -1;
+	}
+
+	if (!io) {
+		if (connect(sd, addr, addrlen) < 0) {
+			http_close(sd);
+			return -1;
+		}
+
+		return sd;
+	}
+
+	if (http_set_blocking(sd, 0)) {
+		http_close(sd);
+		return -1;
+	}
+
+	if (connect(sd, addr, addrlen) < 0) {
+		int error = 0;
+		socklen_t l = sizeof(error);
+
+		if (!http_would_block() ||
+				http_io_wait(io, sd, 1, io->connect_timeout) ||
+				getsockopt(sd, SOL_SOCKET, SO_ERROR,
+					(char *) &error, &l) ||
+				error) {
+			if (io->sd == sd) {
+#ifdef __linux__
+				epoll_ctl(io->fd, EPOLL_CTL_DEL, sd, NULL);
+#endif
+				io->sd = -1;
+			}
+
+			http_close(sd);
+			return -1;
+		}
+	}
+
+	return sd;
+}
+
 /**
  * Parse URL into protocol, hostname and query part; the returned
  * structure needs to be freed after use
@@ -74,11 +351,17 @@ struct http_url *http_parse_url(const char *url) {
 }
 
 /**
- * Resolve URL and try to connect
+ * Resolve URL and try to connect; the address that worked is
+ * stored in the pool entry if one is given
  *
+ * @param io - non-blocking mode state, may be NULL
  * @param hu - URL structure
+ * @param pe - pool entry, may be NULL
  */
-int http_connect(struct http_url *hu) {
+static int http_resolve(
+		struct http_io *io,
+		struct http_url *hu,
+		struct http_pool_entry *pe) {
 	struct addrinfo hints, *si, *p;
 	int sd = -1;
 
@@ -110,32 +393,29 @@ int http_connect(struct http_url *hu) {
 
 	/* loop through all results until connect is successful */
 	for (p = si; p; p = p->ai_next) {
-		if ((sd = socket(
+		if ((sd = http_connect_to(
+				io,
 				p->ai_family,
 				p->ai_socktype,
-				p->ai_protocol)) < 0) {
-			continue;
+				p->ai_protocol,
+				p->ai_addr,
+				p->ai_addrlen)) > -1) {
+			break;
 		}
 
-		if (connect(sd, p->ai_addr, p->ai_addrlen) < 0) {
-#ifdef WIN32
-			closesocket(sd);
-#else
-			close(sd);
-#endif
-			continue;
+		/* no point in trying other addresses */
+		if (io && io->error) {
+			break;
 		}
-
-		break;
 	}
 
-	if (!p && sd > -1) {
-#ifdef WIN32
-		closesocket(sd);
-#else
-		close(sd);
-#endif
-		sd = -1;
+	if (sd > -1 && pe && p->ai_addrlen <= sizeof(pe->addr)) {
+		memcpy(&pe->addr, p->ai_addr, p->ai_addrlen);
+		pe->addrlen = p->ai_addrlen;
+		pe->family = p->ai_family;
+		pe->socktype = p->ai_socktype;
+		pe->protocol = p->ai_protocol;
+		pe->resolved = 1;
 	}
 
 	freeaddrinfo(si);
@@ -143,6 +423,15 @@ int http_connect(struct http_url *hu) {
 	return sd;
 }
 
+/**
+ * Resolve URL and try to connect
+ *
+ * @param hu - URL structure
+ */
+int http_connect(struct http_url *hu) {
+	return http_resolve(NULL, hu, NULL);
+}
+
 /**
  * Send HTTP request
  *
@@ -170,6 +459,103 @@ int http_send(int sd, const char *rq) {
 	return 0;
 }
 
+/**
+ * Send HTTP request made of two parts (e.g. headers and body)
+ * with a single system call, without joining them first; in
+ * non-blocking mode a full socket buffer is waited for within
+ * the read limit
+ *
+ * @param io - non-blocking mode state, may be NULL
+ * @param sd - socket
+ * @param head - first part
+ * @param head_length - first part length
+ * @param body - second part
+ * @param body_length - second part length
+ */
+static int http_send_io(struct http_io *io, int sd,
+		const char *head, size_t head_length,
+		const char *body, size_t body_length) {
+#ifdef _WIN32
+	WSABUF bufs[2];
+	DWORD bytes;
+
+	bufs[0].buf = (char *) head;
+	bufs[0].len = (ULONG) head_length;
+	bufs[1].buf = (char *) body;
+	bufs[1].len = (ULONG) body_length;
+
+	/* blocking sockets send everything or fail; a non-blocking
+	 * one that would block has sent nothing yet */
+	while (WSASend(sd, bufs, 2, &bytes, 0, NULL, NULL)) {
+		if (!io || !http_would_block() ||
+				http_io_wait(io, sd, 1, io->read_timeout)) {
+			return -1;
+		}
+	}
+#else
+	struct iovec iov[2];
+	struct msghdr mh;
+	int flags = 0;
+
+#ifdef MSG_NOSIGNAL
+	/* a kept-alive connection closed by the peer must not kill us */
+	flags = MSG_NOSIGNAL;
+#endif
+
+	iov[0].iov_base = (void *) head;
+	iov[0].iov_len = head_length;
+	iov[1].iov_base = (void *) body;
+	iov[1].iov_len = body_length;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = iov;
+	mh.msg_iovlen = 2;
+
+	while (iov[0].iov_len + iov[1].iov_len > 0) {
+		ssize_t bytes = sendmsg(sd, &mh, flags);
+		size_t skip;
+		int i;
+
+		if (bytes < 0 && io && http_would_block()) {
+			if (http_io_wait(io, sd, 1, io->read_timeout)) {
+				return -1;
+			}
+
+			continue;
+		}
+
+		if (bytes < 0) {
+			return -1;
+		}
+
+		/* skip what was sent, partial writes are rare */
+		for (i = 0, skip = bytes; i < 2; ++i) {
+			size_t l = skip < iov[i].iov_len ? skip : iov[i].iov_len;
+
+			iov[i].iov_base = (char *) iov[i].iov_base + l;
+			iov[i].iov_len -= l;
+			skip -= l;
+		}
+	}
+#endif
+
+	return 0;
+}
+
+/**
+ * Send HTTP request made of two parts (e.g. headers and body)
+ * with a single system call, without joining them first
+ *
+ * @param sd - socket
+ * @param head - first part
+ * @param head_length - first part length
+ * @param body - second part
+ * @param body_length - second part length
+ */
+int http_send_parts(int sd, const char *head, size_t head_length,
+		const char *body, size_t body_length) {
+	return http_send_io(NULL, sd, head, head_length, body, body_length);
+}
+
 /**
  * Cut off trailing CRLF
  *
@@ -234,6 +620,25 @@ static char *http_parse_content(
 				return bod;
 			}
 
+			/* last chunk; the message ends with the empty
+			 * line after the (optional) trailer */
+			if (!strtol(bod, NULL, 16)) {
+				char *p = eoc + 1;
+				char *lf;
+
+				for (; (lf = strchr(p, '\n')); p = lf + 1) {
+					if (lf == p || (lf == p + 1 && *p == '\r')) {
+						msg->state.done = 1;
+						msg->content = lf + 1;
+						msg->length = 0;
+						return lf + 1;
+					}
+				}
+
+				/* trailer is incomplete */
+				return bod;
+			}
+
 			*eoc = 0;
 			sscanf(bod, "%x", &msg->state.chunk);
 
@@ -357,21 +762,72 @@ static char *http_parse_message(
 			msg->state.chunk = 0;
 		} else if (!strcasecmp(bod, "Content-Length")) {
 			msg->header.length = atoi(value);
+		} else if (!strcasecmp(bod, "Connection") &&
+				!strcasecmp(value, "close")) {
+			msg->state.close = 1;
 		}
 	}
 
 	return bod;
 }
 
+/**
+ * Append the last part of the content to the collected body
+ *
+ * @param msg - message struct
+ */
+static int http_keep_body(struct http_message *msg) {
+	if (msg->body_length + msg->length + 1 > msg->state.body_size) {
+		int size = msg->state.body_size ? msg->state.body_size : 4096;
+		char *grown;
+
+		while (size < msg->body_length + msg->length + 1) {
+			size *= 2;
+		}
+
+		if (!(grown = realloc(msg->body, size))) {
+			return -1;
+		}
+
+		msg->body = grown;
+		msg->state.body_size = size;
+	}
+
+	memcpy(msg->body + msg->body_length, msg->content, msg->length);
+	msg->body_length += msg->length;
+	msg->body[msg->body_length] = 0;
+
+	return 0;
+}
+
+/**
+ * Free the buffers of a message; it may be read into again after
+ * it's set to all 0
+ *
+ * @param msg - message struct
+ */
+void http_message_free(struct http_message *msg) {
+	free(msg->state.buf);
+	free(msg->body);
+	msg->state.buf = NULL;
+	msg->state.offset = NULL;
+	msg->body = NULL;
+}
+
 /**
  * Read next part of the response; returns 0 when message is complete;
- * this function blocks until data is available
+ * in non-blocking mode each read waits within the read limit and
+ * -1 is returned when giving up
  *
+ * @param io - non-blocking mode state, may be NULL
  * @param sd - socket
  * @param msg - message struct that gets filled with data, must be
  *              all 0 for the very first call
  */
-int http_read(int sd, struct http_message *msg) {
+static int http_read_io(
+		struct http_io *io,
+		int sd,
+		struct http_message *msg) {
 	if (!msg) {
 		return -1;
 	}
@@ -381,7 +837,10 @@ int http_read(int sd, struct http_message *msg) {
 		/* initialize size of read buffer;
 		 * reserve a byte for the terminating NULL
 		 * character */
-		msg->state.size = sizeof(msg->state.buf) - 1;
+		if (!(msg->state.buf = malloc(HTTP_READ_SIZE))) {
+			return -1;
+		}
+		msg->state.size = HTTP_READ_SIZE - 1;
 		msg->state.offset = msg->state.buf;
 
 		/* initialize remaining length of chunk;
@@ -393,8 +852,11 @@ int http_read(int sd, struct http_message *msg) {
 		msg->header.length = -1;
 	}
 
-	if (msg->state.total == msg->header.length) {
+	if (msg->state.done ||
+			(msg->state.in_content &&
+			msg->state.total == msg->header.length)) {
 		/* return 0 for keep-alive connections */
+		msg->state.done = 1;
 		return 0;
 	}
 
@@ -414,6 +876,10 @@ int http_read(int sd, struct http_message *msg) {
 				msg->state.left -= parsed_until - msg->state.offset;
 				msg->state.offset = parsed_until;
 				msg->state.total += msg->length;
+				if (msg->keep_body && msg->length > 0 &&
+						http_keep_body(msg)) {
+					return -1;
+				}
 				return 1;
 			}
 		}
@@ -431,31 +897,44 @@ int http_read(int sd, struct http_message *msg) {
 
 		/* wait for and read new data from the network */
 		{
-			char *append = msg->state.offset + msg->state.left;
+			char *append;
 			int bytes,
-				size = (msg->state.buf + msg->state.size)-append;
+				size = msg->state.size - msg->state.left;
 
-			/* drop half of the buffer if there's no space left */
+			/* nothing is dropped; what can't be parsed yet
+			 * stays until the buffer is full, then it grows */
 			if (size < 1) {
-				int half = msg->state.size >> 1;
+				char *grown;
 
-				memcpy(
-					msg->state.buf,
-					msg->state.buf + half,
-					half);
-
-				msg->state.offset = msg->state.buf;
-				msg->state.left = half;
+				if (msg->state.size + 1 >= HTTP_MAX_BUFFER ||
+						!(grown = realloc(
+							msg->state.buf,
+							(msg->state.size + 1) * 2))) {
+					return -1;
+				}
 
-				append = msg->state.offset + msg->state.left;
+				msg->state.buf = msg->state.offset = grown;
+				msg->state.size = (msg->state.size + 1) * 2 - 1;
 				size = msg->state.size - msg->state.left;
 			}
 
+			append = msg->state.offset + msg->state.left;
+
+			if (io && http_io_wait(io, sd, 0, io->read_timeout)) {
+				return -1;
+			}
+
+			/* as much as fits, so a big body takes few calls */
 			if ((bytes = recv(
 					sd,
 					append,
 					size,
 					0)) < 1) {
+				/* spurious wake-up */
+				if (bytes < 0 && io && http_would_block()) {
+					continue;
+				}
+
 				/* bytes == 0 means remote socket was closed */
 				return 0;
 			}
@@ -469,16 +948,29 @@ int http_read(int sd, struct http_message *msg) {
 }
 
 /**
- * Send HTTP request
+ * Read next part of the response; returns 0 when message is complete;
+ * this function blocks until data is available
+ *
+ * @param sd - socket
+ * @param msg - message struct that gets filled with data, must be
+ *              all 0 for the very first call
+ */
+int http_read(int sd, struct http_message *msg) {
+	return http_read_io(NULL, sd, msg);
+}
+
+/**
+ * Send HTTP request; the connection is taken from the pool and
+ * should be given back with http_pool_release()
  *
  * @param url - URL
  */
 int http_request(const char *url) {
 	struct http_url *hu;
-	int sd;
+	int sd, reused;
 
 	if (!(hu = http_parse_url(url)) ||
-			(sd = http_connect(hu)) < 0) {
+			(sd = http_pool_connect(url, &reused)) < 0) {
 		/* it's save to free NULL */
 		free(hu);
 		return -1;
@@ -493,13 +985,10 @@ Host: ") ||
 			http_send(sd, hu->host) ||
 			http_send(sd, "\r\n\
 Accept: */*\r\n\
-Connection: close\r\n\
+Connection: keep-alive\r\n\
 \r\n")) {
-#ifdef WIN32
-		closesocket(sd);
-#else
-		close(sd);
-#endif
+		http_close(sd);
+		free(hu);
 		return -1;
 	}
 
@@ -520,6 +1009,15 @@ int http_response(int sd, struct http_message *msg) {
 	fd_set r;
 	struct timeval tv;
 
+	/* nothing to wait for if the message is complete or
+	 * there's still data in the buffer; a kept-alive server
+	 * sends nothing after a body of known length */
+	if (msg->state.done || msg->state.left > 0 ||
+			(msg->state.in_content &&
+			msg->state.total == msg->header.length)) {
+		return http_read(sd, msg);
+	}
+
 	tv.tv_sec = HTTP_TIME_OUT;
 	tv.tv_usec = 0;
 
@@ -533,3 +1031,373 @@ int http_response(int sd, struct http_message *msg) {
 
 	return http_read(sd, msg);
 }
+
+/**
+ * Check if an idle keep-alive socket is still usable; the server
+ * must not have sent anything (EOF included) in the meantime
+ *
+ * @param sd - socket
+ */
+static int http_alive(int sd) {
+	fd_set r;
+	struct timeval tv;
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+
+	FD_ZERO(&r);
+	FD_SET(sd, &r);
+
+	return select(sd + 1, &r, NULL, NULL, &tv) == 0;
+}
+
+/**
+ * Find (or take) the pool entry of a host; pool must be locked
+ *
+ * @param host - host with optional port
+ */
+static struct http_pool_entry *http_pool_entry(const char *host) {
+	struct http_pool_entry *pe;
+	int i;
+
+	if (strlen(host) >= sizeof(pe->host)) {
+		return NULL;
+	}
+
+	for (i = 0; i < HTTP_POOL_HOSTS; ++i) {
+		if (!strcmp(http_pool[i].host, host)) {
+			return &http_pool[i];
+		}
+	}
+
+	for (i = 0; i < HTTP_POOL_HOSTS && *http_pool[i].host; ++i);
+
+	/* no free entry; evict round robin */
+	if (i == HTTP_POOL_HOSTS) {
+		i = http_pool_next;
+		http_pool_next = (http_pool_next + 1) % HTTP_POOL_HOSTS;
+
+		while (http_pool[i].nidle > 0) {
+			http_close(http_pool[i].idle[--http_pool[i].nidle]);
+		}
+	}
+
+	pe = &http_pool[i];
+	memset(pe, 0, sizeof(*pe));
+	strcpy(pe->host, host);
+
+	return pe;
+}
+
+/**
+ * Get a connected socket for the URL; an idle keep-alive socket is
+ * reused if there's a healthy one, otherwise a new connection is made
+ * to the cached address (resolving only the very first time)
+ *
+ * @param io - non-blocking mode state, may be NULL
+ * @param url - URL
+ * @param reused - set to 1 if the socket was reused, may be NULL
+ */
+static int http_pool_connect_io(
+		struct http_io *io,
+		const char *url,
+		int *reused) {
+	struct http_pool_entry *pe, cached;
+	struct http_url *hu;
+	time_t now = time(NULL);
+	int sd = -1;
+
+	if (reused) {
+		*reused = 0;
+	}
+
+	if (!(hu = http_parse_url(url))) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&http_pool_lock);
+
+	if (!(pe = http_pool_entry(hu->host))) {
+		pthread_mutex_unlock(&http_pool_lock);
+		sd = http_resolve(io, hu, NULL);
+		free(hu);
+		return sd;
+	}
+
+	/* newest idle sockets first */
+	while (pe->nidle > 0) {
+		int i = --pe->nidle;
+
+		if (now - pe->since[i] <= HTTP_POOL_MAX_AGE &&
+				http_alive(pe->idle[i])) {
+			sd = pe->idle[i];
+			break;
+		}
+
+		http_close(pe->idle[i]);
+	}
+
+	cached = *pe;
+
+	pthread_mutex_unlock(&http_pool_lock);
+
+	if (sd > -1) {
+		if (reused) {
+			*reused = 1;
+		}
+
+		free(hu);
+
+		if (io && http_set_blocking(sd, 0)) {
+			http_close(sd);
+			return -1;
+		}
+
+		return sd;
+	}
+
+	/* skip name resolution if the address is known */
+	if (cached.resolved) {
+		sd = http_connect_to(
+			io,
+			cached.family,
+			cached.socktype,
+			cached.protocol,
+			(struct sockaddr *) &cached.addr,
+			cached.addrlen);
+	}
+
+	/* resolve (again), unless the time is up already */
+	if (sd < 0 && !(io && io->error)) {
+		sd = http_resolve(io, hu, &cached);
+
+		pthread_mutex_lock(&http_pool_lock);
+
+		if ((pe = http_pool_entry(hu->host))) {
+			pe->resolved = cached.resolved && sd > -1;
+			pe->addr = cached.addr;
+			pe->addrlen = cached.addrlen;
+			pe->family = cached.family;
+			pe->socktype = cached.socktype;
+			pe->protocol = cached.protocol;
+		}
+
+		pthread_mutex_unlock(&http_pool_lock);
+	}
+
+	free(hu);
+
+	return sd;
+}
+
+/**
+ * Get a connected socket for the URL; an idle keep-alive socket is
+ * reused if there's a healthy one, otherwise a new connection is made
+ * to the cached address (resolving only the very first time)
+ *
+ * @param url - URL
+ * @param reused - set to 1 if the socket was reused, may be NULL
+ */
+int http_pool_connect(const char *url, int *reused) {
+	return http_pool_connect_io(NULL, url, reused);
+}
+
+/**
+ * Give a socket back to the pool; it's kept alive only if the
+ * response was read completely and the server didn't ask to close,
+ * otherwise it's closed
+ *
+ * @param url - URL the socket is connected to
+ * @param sd - socket
+ * @param msg - the last response read from the socket, may be NULL
+ */
+void http_pool_release(
+		const char *url,
+		int sd,
+		const struct http_message *msg) {
+	struct http_pool_entry *pe;
+	struct http_url *hu;
+
+	if (sd < 0) {
+		return;
+	}
+
+	if (!msg ||
+			!msg->header.code ||
+			!msg->state.done ||
+			msg->state.close ||
+			!(hu = http_parse_url(url))) {
+		http_close(sd);
+		return;
+	}
+
+	pthread_mutex_lock(&http_pool_lock);
+
+	if ((pe = http_pool_entry(hu->host)) &&
+			pe->nidle < HTTP_POOL_IDLE) {
+		pe->since[pe->nidle] = time(NULL);
+		pe->idle[pe->nidle++] = sd;
+		sd = -1;
+	}
+
+	pthread_mutex_unlock(&http_pool_lock);
+
+	if (sd > -1) {
+		http_close(sd);
+	}
+
+	free(hu);
+}
+
+/**
+ * Close all idle sockets and forget resolved addresses
+ */
+void http_pool_close(void) {
+	int i;
+
+	pthread_mutex_lock(&http_pool_lock);
+
+	for (i = 0; i < HTTP_POOL_HOSTS; ++i) {
+		while (http_pool[i].nidle > 0) {
+			http_close(http_pool[i].idle[--http_pool[i].nidle]);
+		}
+	}
+
+	memset(http_pool, 0, sizeof(http_pool));
+
+	pthread_mutex_unlock(&http_pool_lock);
+}
+
+/**
+ * Initialize non-blocking mode; the total limit starts counting now
+ *
+ * @param io - non-blocking mode state
+ * @param connect - connect limit (ms), 0 means no limit
+ * @param read - max. wait for any data (ms), 0 means no limit
+ * @param total - limit of the whole exchange (ms), 0 means no limit
+ * @param cancel - flag that cancels the request when set, may be NULL
+ */
+int http_io_init(
+		struct http_io *io,
+		int connect,
+		int read,
+		int total,
+		volatile sig_atomic_t *cancel) {
+	memset(io, 0, sizeof(*io));
+	io->connect_timeout = connect;
+	io->read_timeout = read;
+	io->cancel = cancel;
+	io->deadline = total > 0 ? http_now() + total : 0;
+	io->sd = -1;
+
+#ifdef __linux__
+	if ((io->fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		return -1;
+	}
+#else
+	io->fd = -1;
+#endif
+
+	return 0;
+}
+
+/**
+ * Get a connected (non-blocking) socket for the URL from the pool
+ *
+ * @param io - non-blocking mode state
+ * @param url - URL
+ * @param reused - set to 1 if the socket was reused, may be NULL
+ */
+int http_io_connect(struct http_io *io, const char *url, int *reused) {
+	int sd = http_pool_connect_io(io, url, reused);
+
+	if (sd < 0 && !io->error) {
+		io->error = HTTP_IO_FAILED;
+	}
+
+	return sd;
+}
+
+/**
+ * Send HTTP request made of two parts within the limits
+ *
+ * @param io - non-blocking mode state
+ * @param sd - socket
+ * @param head - first part
+ * @param head_length - first part length
+ * @param body - second part
+ * @param body_length - second part length
+ */
+int http_io_send(struct http_io *io, int sd,
+		const char *head, size_t head_length,
+		const char *body, size_t body_length) {
+	if (http_send_io(io, sd, head, head_length, body, body_length)) {
+		if (!io->error) {
+			io->error = HTTP_IO_FAILED;
+		}
+
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Read next part of the response within the limits; returns 0 when
+ * message is complete and -1 if failed, timed out or was cancelled
+ * (see io->error)
+ *
+ * @param io - non-blocking mode state
+ * @param sd - socket
+ * @param msg - message struct, must be all 0 for the very first call
+ */
+int http_io_response(struct http_io *io, int sd, struct http_message *msg) {
+	return http_read_io(io, sd, msg);
+}
+
+/**
+ * Give a socket back to the pool in blocking mode
+ *
+ * @param io - non-blocking mode state
+ * @param url - URL the socket is connected to
+ * @param sd - socket
+ * @param msg - the last response read from the socket, may be NULL
+ */
+void http_io_release(
+		struct http_io *io,
+		const char *url,
+		int sd,
+		const struct http_message *msg) {
+	if (sd < 0) {
+		return;
+	}
+
+	if (io->sd == sd) {
+#ifdef __linux__
+		epoll_ctl(io->fd, EPOLL_CTL_DEL, sd, NULL);
+#endif
+		io->sd = -1;
+	}
+
+	/* an unfinished exchange must not be reused */
+	if (io->error || http_set_blocking(sd, 1)) {
+		msg = NULL;
+	}
+
+	http_pool_release(url, sd, msg);
+}
+
+/**
+ * Free non-blocking mode state
+ *
+ * @param io - non-blocking mode state
+ */
+void http_io_free(struct http_io *io) {
+#ifdef __linux__
+	if (io->fd > -1) {
+		close(io->fd);
+	}
+#endif
+	io->fd = -1;
+	io->sd = -1;
+}
@@ -1,6 +1,13 @@
 #ifndef _http_h_
 #define _http_h_
 
+#include <signal.h>
+#include <stddef.h>
+
+/* content/length is the part of the body read by the last call; it
+ * points into the receive buffer and is valid until the next call;
+ * if keep_body is set before the first call, the whole body is also
+ * collected in body/body_length; free with http_message_free() */
 struct http_message {
 	struct {
 		int code;
@@ -8,16 +15,22 @@ struct http_message {
 	} header;
 	char *content;
 	int length;
+	int keep_body;
+	char *body;
+	int body_length;
 	struct {
 		int in_content;
 		int chunk;
-		char buf[4096];
+		char *buf;
 		int size;
+		int body_size;
 		char *offset;
 		char *last;
 		int free;
 		int left;
 		int total;
+		int done;
+		int close;
 	} state;
 };
 
@@ -31,10 +44,45 @@ struct http_url {
 struct http_url *http_parse_url(const char *);
 int http_connect(struct http_url *);
 int http_send(int, const char *);
+int http_send_parts(int, const char *, size_t, const char *, size_t);
 int http_read(int, struct http_message *);
+void http_message_free(struct http_message *);
 
 /* high level methods */
 int http_request(const char *);
 int http_response(int, struct http_message *);
 
+/* non-blocking mode (epoll where available); limits are in
+ * milliseconds, 0 means no limit */
+enum {
+	HTTP_IO_OK,
+	HTTP_IO_FAILED,
+	HTTP_IO_TIMEOUT,
+	HTTP_IO_CANCELLED
+};
+
+struct http_io {
+	int connect_timeout;
+	int read_timeout;
+	long long deadline;
+	volatile sig_atomic_t *cancel;
+	int error;
+	int fd;
+	int sd;
+};
+
+int http_io_init(struct http_io *, int, int, int, volatile sig_atomic_t *);
+int http_io_connect(struct http_io *, const char *, int *);
+int http_io_send(struct http_io *, int, const char *, size_t,
+	const char *, size_t);
+int http_io_response(struct http_io *, int, struct http_message *);
+void http_io_release(struct http_io *, const char *, int,
+	const struct http_message *);
+void http_io_free(struct http_io *);
+
+/* keep-alive connection pool */
+int http_pool_connect(const char *, int *);
+void http_pool_release(const char *, int, const struct http_message *);
+void http_pool_close(void);
+
 #endif
@@ -0,0 +1,270 @@
+/*
+ *  ingest.c
+ *
+ *  Extends "ingest.h".
+ *
+ *  The queue is a lock-free stack: producers push
+ *  with compare-and-swap, the merge takes the whole
+ *  stack with a single exchange, so there is no ABA.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include "ingest.h"
+
+#define ING_RADIX               (1u << 16)  /* MERGE: Radix sort buckets (16 bits per pass) */
+#define ING_RADIX_MIN           16384u      /* MERGE: Min. # of arches worth radix sorting */
+
+
+/* Pushes a chunk onto the queue */
+static void _ing_psh(ingest_t *ing, chunk_t *chunk)
+{
+    atomic_fetch_add_explicit(&ing->_nput, chunk->_n, memory_order_relaxed);
+
+    chunk_t *head = atomic_load_explicit(&ing->_queue, memory_order_relaxed);
+    do
+    {
+        chunk->_next = head;
+
+    } while(! atomic_compare_exchange_weak_explicit(&ing->_queue, &head, chunk,
+                                                     memory_order_release, memory_order_relaxed));
+}
+
+/* Frees a list of chunks */
+static void _ing_fre(chunk_t *chunk)
+{
+    while(chunk)
+    {
+        chunk_t *next = chunk->_next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+/* Compares keys (ascending) */
+static int _ing_cmp(const void *a, const void *b)
+{
+    const uint32_t ka = *((const uint32_t *) a);
+    const uint32_t kb = *((const uint32_t *) b);
+
+    return (ka > kb) - (ka < kb);
+}
+
+/* Sorts keys with LSD radix sort, 16 bits per pass
+ * (qsort if there are too few to pay off).
+ *
+ *  key         - keys, sorted in place
+ *  tmp         - scratch space, the same size
+ *  n           - # of keys
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _ing_srt(uint32_t *key, uint32_t *tmp, size_t n)
+{
+    if(n < ING_RADIX_MIN)
+    {
+        qsort(key, n, sizeof(uint32_t), _ing_cmp);
+        return 0;
+    }
+
+    size_t *cnt = NULL;
+    if((cnt = (size_t *) malloc(sizeof(size_t) * ING_RADIX)) == NULL)
+        return -1;
+
+    /* Two passes, so the keys end up where they were */
+    for(unsigned shift = 0u; shift < 32u; shift += 16u)
+    {
+        memset(cnt, 0, sizeof(size_t) * ING_RADIX);
+        for(size_t i = 0u; i < n; ++i)
+            ++cnt[(key[i] >> shift) & (ING_RADIX - 1u)];
+
+        size_t sum = 0u;
+        for(size_t d = 0u; d < ING_RADIX; ++d)
+        {
+            const size_t c = cnt[d];
+            cnt[d] = sum;
+            sum += c;
+        }
+
+        for(size_t i = 0u; i < n; ++i)
+            tmp[cnt[(key[i] >> shift) & (ING_RADIX - 1u)]++] = key[i];
+
+        uint32_t *t = key;
+        key = tmp;
+        tmp = t;
+    }
+
+    free(cnt);
+    return 0;
+}
+
+/* Starts new ingestion.
+ *
+ *  graph       - destination
+ *
+ * Returns NULL if failed.
+ */
+ingest_t *ing_new(graph_t *graph)
+{
+    assert(graph);
+
+    ingest_t *ing = NULL;
+    if((ing = (ingest_t *) malloc(sizeof(ingest_t))) == NULL)
+        return NULL;
+
+    ing->_graph = graph;
+    atomic_init(&ing->_queue, NULL);
+    atomic_init(&ing->_nput, 0u);
+
+    return ing;
+}
+
+/* Frees ingestion, arches not merged are lost.
+ * Producers must have been flushed.
+ *
+ *  ing         - the victim
+ */
+void ing_fre(ingest_t *ing)
+{
+    assert(ing);
+
+    _ing_fre(atomic_exchange(&ing->_queue, NULL));
+    free(ing);
+}
+
+/* Initialises a producer.
+ *
+ *  ing         - the ingestion
+ *  o_prod      - OUT, the producer
+ */
+void ing_prd(ingest_t *ing, producer_t *o_prod)
+{
+    assert(ing && o_prod);
+
+    o_prod->_ing = ing;
+    o_prod->_cur = NULL;
+}
+
+/* Puts an arch from A to B (no GPH_LAST, invalid
+ * ones are skipped by the merge).
+ *
+ *  prod        - the producer
+ *  a           - A index
+ *  b           - B index
+ *
+ * Returns 0 or -1 if failed.
+ */
+int ing_put(producer_t *prod, index_t a, index_t b)
+{
+    assert(prod);
+
+    chunk_t *c = prod->_cur;
+
+    /* New chunk, the full one goes to the queue */
+    if(c == NULL || c->_n == ING_CHUNK)
+    {
+        if(c)
+            _ing_psh(prod->_ing, c);
+
+        if((c = prod->_cur = (chunk_t *) malloc(sizeof(chunk_t))) == NULL)
+            return -1;
+        c->_n = 0u;
+    }
+
+    c->_arch[2u * c->_n]      = a;
+    c->_arch[2u * c->_n + 1u] = b;
+    ++(c->_n);
+
+    return 0;
+}
+
+/* Queues the chunk being filled, so it gets
+ * into the next merge.
+ *
+ *  prod        - the producer
+ */
+void ing_flu(producer_t *prod)
+{
+    assert(prod);
+
+    if(prod->_cur == NULL)
+        return;
+
+    _ing_psh(prod->_ing, prod->_cur);
+    prod->_cur = NULL;
+}
+
+/* Merges all the queued arches into the graph.
+ *
+ *  ing         - the ingestion
+ *
+ * Returns # of added arches or -1 if failed
+ * (arches taken by a failed merge are lost).
+ */
+size_t ing_mrg(ingest_t *ing)
+{
+    assert(ing);
+
+    /* All of the queue at once */
+    chunk_t *head = atomic_exchange_explicit(&ing->_queue, NULL, memory_order_acquire);
+    if(head == NULL)
+        return 0u;
+
+    size_t n = 0u;
+    for(const chunk_t *c = head; c; c = c->_next)
+        n += c->_n;
+
+    /* Arches as (A, B) keys, so sorting groups them by A */
+    uint32_t *key = NULL, *tmp = NULL;
+    if((key = (uint32_t *) malloc(sizeof(uint32_t) * n)) == NULL ||
+       (tmp = (uint32_t *) malloc(sizeof(uint32_t) * n)) == NULL)
+    {
+        free(key);
+        _ing_fre(head);
+        return (size_t) -1;
+    }
+
+    size_t k = 0u;
+    for(const chunk_t *c = head; c; c = c->_next)
+    {
+        for(size_t i = 0u; i < c->_n; ++i)
+            key[k++] = ((uint32_t) c->_arch[2u * i] << 16) | c->_arch[2u * i + 1u];
+    }
+    _ing_fre(head);
+
+    if(_ing_srt(key, tmp, n) != 0)
+    {
+        free(key);
+        free(tmp);
+        return (size_t) -1;
+    }
+
+    /* One vertex at a time, B lists go to tmp (deduplicated) */
+    size_t added = 0u;
+    index_t *list = (index_t *) tmp;
+
+    for(size_t i = 0u; i < n; )
+    {
+        const index_t a = (index_t) (key[i] >> 16);
+        size_t nlist = 0u;
+
+        for(; i < n && (index_t) (key[i] >> 16) == a; ++i)
+        {
+            if(nlist == 0u || list[nlist - 1u] != (index_t) key[i])
+                list[nlist++] = (index_t) key[i];
+        }
+
+        const size_t r = gph_ext(ing->_graph, a, list, nlist);
+        if(r == (size_t) -1)
+        {
+            free(key);
+            free(tmp);
+            return (size_t) -1;
+        }
+        added += r;
+    }
+
+    free(key);
+    free(tmp);
+    return added;
+}
@@ -0,0 +1,108 @@
+/*
+ *  ingest.h
+ *
+ *  Bulk arch ingestion from many threads. Each
+ *  producer thread fills its own chunks of arches
+ *  (no locking), full chunks are pushed onto a
+ *  lock-free queue. A merge takes all of them at once,
+ *  sorts and deduplicates the arches and adds them
+ *  to the graph vertex by vertex (see gph_ext()).
+ *
+ *  Producers can go on while a merge is running.
+ *  Merges must not run at once with each other.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_INGEST_H_FILE_
+#define _GRAPH_INGEST_H_FILE_
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graph.h"
+
+#define ING_CHUNK               4096u   /* # of arches per chunk */
+
+
+/* A chunk of arches */
+typedef struct _ing_chunk_t
+{
+    struct _ing_chunk_t *_next;         /* Next queued chunk */
+    size_t      _n;                     /* # of arches */
+    index_t     _arch[2u * ING_CHUNK];  /* Arches, pairs one after another (A0, B0, A1, B1, ...) */
+
+} chunk_t;
+
+/* An ingestion into a graph */
+typedef struct _ing_ingest_t
+{
+    graph_t            *_graph;         /* Destination */
+    _Atomic(chunk_t *)  _queue;         /* Full chunks, newest first */
+    atomic_size_t       _nput;          /* # of arches put so far */
+
+} ingest_t;
+
+/* A producer, one per thread */
+typedef struct _ing_producer_t
+{
+    ingest_t   *_ing;
+    chunk_t    *_cur;                   /* Chunk being filled, NULL if none */
+
+} producer_t;
+
+
+/* Starts new ingestion.
+ *
+ *  graph       - destination
+ *
+ * Returns NULL if failed.
+ */
+ingest_t       *ing_new(graph_t *graph);
+
+/* Frees ingestion, arches not merged are lost.
+ * Producers must have been flushed.
+ *
+ *  ing         - the victim
+ */
+void            ing_fre(ingest_t *ing);
+
+/* Initialises a producer.
+ *
+ *  ing         - the ingestion
+ *  o_prod      - OUT, the producer
+ */
+void            ing_prd(ingest_t *ing, producer_t *o_prod);
+
+/* Puts an arch from A to B (no GPH_LAST, invalid
+ * ones are skipped by the merge).
+ *
+ *  prod        - the producer
+ *  a           - A index
+ *  b           - B index
+ *
+ * Returns 0 or -1 if failed.
+ */
+int             ing_put(producer_t *prod, index_t a, index_t b);
+
+/* Queues the chunk being filled, so it gets
+ * into the next merge.
+ *
+ *  prod        - the producer
+ */
+void            ing_flu(producer_t *prod);
+
+/* Merges all the queued arches into the graph.
+ *
+ *  ing         - the ingestion
+ *
+ * Returns # of added arches or -1 if failed
+ * (arches taken by a failed merge are lost).
+ */
+size_t          ing_mrg(ingest_t *ing);
+
+#endif /* _GRAPH_INGEST_H_FILE_ */
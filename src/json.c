@@ -0,0 +1,566 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+/* parser states */
+enum {
+	JSON_STATE_VALUE,
+	JSON_STATE_VALUE_OR_END,
+	JSON_STATE_KEY,
+	JSON_STATE_KEY_OR_END,
+	JSON_STATE_COLON,
+	JSON_STATE_AFTER,
+	JSON_STATE_STRING,
+	JSON_STATE_ESCAPE,
+	JSON_STATE_UNICODE,
+	JSON_STATE_NUMBER,
+	JSON_STATE_LITERAL
+};
+
+static const char *json_literals[] = {"true", "false", "null"};
+static const enum json_event json_literal_events[] = {
+	JSON_TRUE,
+	JSON_FALSE,
+	JSON_NULL
+};
+
+/**
+ * Initialize parser; values of any number of top-level documents
+ * (e.g. one object per line) are passed to the callback as they
+ * are completed
+ *
+ * @param p - parser
+ * @param callback - event callback
+ * @param arg - passed to the callback
+ */
+void json_init(struct json_parser *p, json_callback callback, void *arg) {
+	memset(p, 0, sizeof(*p));
+	p->callback = callback;
+	p->arg = arg;
+	p->state = JSON_STATE_VALUE;
+}
+
+/**
+ * Free parser memory; the parser can be initialized again
+ *
+ * @param p - parser
+ */
+void json_free(struct json_parser *p) {
+	free(p->buf);
+	p->buf = NULL;
+	p->length = p->size = 0;
+}
+
+/**
+ * Append to scratch buffer
+ *
+ * @param p - parser
+ * @param data - data
+ * @param length - data length
+ */
+static int json_append(struct json_parser *p, const char *data, size_t length) {
+	if (p->length + length + 1 > p->size) {
+		size_t size = p->size ? p->size : 256;
+		char *buf;
+
+		while (p->length + length + 1 > size) {
+			size <<= 1;
+		}
+
+		if (!(buf = realloc(p->buf, size))) {
+			return -1;
+		}
+
+		p->buf = buf;
+		p->size = size;
+	}
+
+	memcpy(p->buf + p->length, data, length);
+	p->length += length;
+	p->buf[p->length] = 0;
+
+	return 0;
+}
+
+/**
+ * Append code point as UTF-8
+ *
+ * @param p - parser
+ * @param cp - code point
+ */
+static int json_append_utf8(struct json_parser *p, unsigned cp) {
+	char u[4];
+	size_t n;
+
+	if (cp < 0x80) {
+		u[0] = (char) cp;
+		n = 1;
+	} else if (cp < 0x800) {
+		u[0] = (char) (0xc0 | (cp >> 6));
+		u[1] = (char) (0x80 | (cp & 0x3f));
+		n = 2;
+	} else if (cp < 0x10000) {
+		u[0] = (char) (0xe0 | (cp >> 12));
+		u[1] = (char) (0x80 | ((cp >> 6) & 0x3f));
+		u[2] = (char) (0x80 | (cp & 0x3f));
+		n = 3;
+	} else {
+		u[0] = (char) (0xf0 | (cp >> 18));
+		u[1] = (char) (0x80 | ((cp >> 12) & 0x3f));
+		u[2] = (char) (0x80 | ((cp >> 6) & 0x3f));
+		u[3] = (char) (0x80 | (cp & 0x3f));
+		n = 4;
+	}
+
+	return json_append(p, u, n);
+}
+
+/**
+ * Pass an event to the callback
+ *
+ * @param p - parser
+ * @param event - the event
+ * @param value - text of the value, may be NULL
+ * @param length - text length
+ */
+static int json_emit(
+		struct json_parser *p,
+		enum json_event event,
+		const char *value,
+		size_t length) {
+	int depth = p->depth;
+
+	if (event == JSON_OBJECT_BEGIN || event == JSON_ARRAY_BEGIN) {
+		if (p->depth >= JSON_MAX_DEPTH) {
+			return -1;
+		}
+
+		p->stack[p->depth++] = event == JSON_OBJECT_BEGIN ? '{' : '[';
+	} else if (event == JSON_OBJECT_END || event == JSON_ARRAY_END) {
+		depth = --p->depth;
+	}
+
+	return p->callback(p->arg, event, value, length, depth);
+}
+
+/**
+ * Set state after a complete value
+ *
+ * @param p - parser
+ */
+static void json_after_value(struct json_parser *p) {
+	p->state = JSON_STATE_AFTER;
+}
+
+/**
+ * Start a value
+ *
+ * @param p - parser
+ * @param c - first character of the value
+ */
+static int json_begin_value(struct json_parser *p, char c) {
+	int i;
+
+	switch (c) {
+	case '{':
+		p->state = JSON_STATE_KEY_OR_END;
+		return json_emit(p, JSON_OBJECT_BEGIN, NULL, 0);
+	case '[':
+		p->state = JSON_STATE_VALUE_OR_END;
+		return json_emit(p, JSON_ARRAY_BEGIN, NULL, 0);
+	case '"':
+		p->state = JSON_STATE_STRING;
+		p->key = 0;
+		return 0;
+	}
+
+	if (c == '-' || (c >= '0' && c <= '9')) {
+		p->state = JSON_STATE_NUMBER;
+		return 0;
+	}
+
+	for (i = 0; i < 3; ++i) {
+		if (c == *json_literals[i]) {
+			p->state = JSON_STATE_LITERAL;
+			p->literal = i;
+			p->matched = 1;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Parse next part of the data; strings and numbers that are complete
+ * within the part are passed to the callback without copying, only
+ * the ones with escapes or split across parts go through a buffer
+ *
+ * @param p - parser
+ * @param data - next part of the data
+ * @param length - part length
+ */
+int json_feed(struct json_parser *p, const char *data, size_t length) {
+	/* begin of the string or number text not copied yet */
+	size_t begin = 0;
+	size_t i;
+	int r = 0;
+
+	if (p->error) {
+		return -1;
+	}
+
+	for (i = 0; i < length && !r; ++i) {
+		char c = data[i];
+
+		switch (p->state) {
+		case JSON_STATE_VALUE:
+		case JSON_STATE_VALUE_OR_END:
+			if (strchr(" \t\r\n", c)) {
+				break;
+			}
+
+			if (c == ']' && p->state == JSON_STATE_VALUE_OR_END) {
+				r = json_emit(p, JSON_ARRAY_END, NULL, 0);
+				json_after_value(p);
+				break;
+			}
+
+			if ((r = json_begin_value(p, c))) {
+				break;
+			}
+
+			begin = c == '"' ? i + 1 : i;
+			p->copying = 0;
+			p->length = 0;
+			break;
+		case JSON_STATE_KEY:
+		case JSON_STATE_KEY_OR_END:
+			if (strchr(" \t\r\n", c)) {
+				break;
+			}
+
+			if (c == '}' && p->state == JSON_STATE_KEY_OR_END) {
+				r = json_emit(p, JSON_OBJECT_END, NULL, 0);
+				json_after_value(p);
+			} else if (c == '"') {
+				p->state = JSON_STATE_STRING;
+				p->key = 1;
+				begin = i + 1;
+				p->copying = 0;
+				p->length = 0;
+			} else {
+				r = -1;
+			}
+			break;
+		case JSON_STATE_COLON:
+			if (c == ':') {
+				p->state = JSON_STATE_VALUE;
+			} else if (!strchr(" \t\r\n", c)) {
+				r = -1;
+			}
+			break;
+		case JSON_STATE_AFTER:
+			if (strchr(" \t\r\n", c)) {
+				break;
+			}
+
+			/* next top-level document */
+			if (!p->depth) {
+				p->state = JSON_STATE_VALUE;
+				--i;
+				break;
+			}
+
+			if (c == ',') {
+				p->state = p->stack[p->depth - 1] == '{' ?
+					JSON_STATE_KEY :
+					JSON_STATE_VALUE;
+			} else if (c == '}' && p->stack[p->depth - 1] == '{') {
+				r = json_emit(p, JSON_OBJECT_END, NULL, 0);
+			} else if (c == ']' && p->stack[p->depth - 1] == '[') {
+				r = json_emit(p, JSON_ARRAY_END, NULL, 0);
+			} else {
+				r = -1;
+			}
+			break;
+		case JSON_STATE_STRING:
+			if (c == '\\') {
+				/* from now on the string needs a buffer */
+				if ((r = json_append(p, data + begin, i - begin))) {
+					break;
+				}
+
+				p->copying = 1;
+				p->state = JSON_STATE_ESCAPE;
+			} else if (c == '"') {
+				const char *value = data + begin;
+				size_t l = i - begin;
+
+				if (p->copying) {
+					if ((r = json_append(p, data + begin, i - begin))) {
+						break;
+					}
+
+					value = p->buf;
+					l = p->length;
+				}
+
+				if (p->key) {
+					p->state = JSON_STATE_COLON;
+					r = json_emit(p, JSON_KEY, value, l);
+				} else {
+					json_after_value(p);
+					r = json_emit(p, JSON_STRING, value, l);
+				}
+			}
+			break;
+		case JSON_STATE_ESCAPE:
+			p->state = JSON_STATE_STRING;
+			begin = i + 1;
+
+			switch (c) {
+			case 'b': r = json_append(p, "\b", 1); break;
+			case 'f': r = json_append(p, "\f", 1); break;
+			case 'n': r = json_append(p, "\n", 1); break;
+			case 'r': r = json_append(p, "\r", 1); break;
+			case 't': r = json_append(p, "\t", 1); break;
+			case 'u':
+				p->state = JSON_STATE_UNICODE;
+				p->code = 0;
+				p->digits = 0;
+				break;
+			default:
+				r = json_append(p, &c, 1);
+			}
+			break;
+		case JSON_STATE_UNICODE:
+			if (c >= '0' && c <= '9') {
+				p->code = (p->code << 4) | (c - '0');
+			} else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+				p->code = (p->code << 4) | ((c | 0x20) - 'a' + 10);
+			} else {
+				r = -1;
+				break;
+			}
+
+			if (++p->digits < 4) {
+				break;
+			}
+
+			p->state = JSON_STATE_STRING;
+			begin = i + 1;
+
+			if (p->code >= 0xd800 && p->code < 0xdc00) {
+				/* high surrogate; the low one should follow */
+				p->high = p->code;
+			} else if (p->code >= 0xdc00 && p->code < 0xe000) {
+				r = p->high ?
+					json_append_utf8(p, 0x10000 +
+						((p->high - 0xd800) << 10) +
+						(p->code - 0xdc00)) :
+					json_append_utf8(p, 0xfffd);
+				p->high = 0;
+			} else {
+				r = json_append_utf8(p, p->code);
+				p->high = 0;
+			}
+			break;
+		case JSON_STATE_NUMBER:
+			if ((c >= '0' && c <= '9') || strchr("+-.eE", c)) {
+				break;
+			}
+
+			if (p->copying) {
+				if ((r = json_append(p, data + begin, i - begin))) {
+					break;
+				}
+
+				r = json_emit(p, JSON_NUMBER, p->buf, p->length);
+			} else {
+				r = json_emit(p, JSON_NUMBER, data + begin, i - begin);
+			}
+
+			/* the delimiter is parsed again */
+			json_after_value(p);
+			--i;
+			break;
+		case JSON_STATE_LITERAL:
+			if (c != json_literals[p->literal][p->matched]) {
+				r = -1;
+				break;
+			}
+
+			if (!json_literals[p->literal][++p->matched]) {
+				json_after_value(p);
+				r = json_emit(p, json_literal_events[p->literal], NULL, 0);
+			}
+			break;
+		}
+	}
+
+	/* keep the unfinished string or number for the next part */
+	if (!r && (p->state == JSON_STATE_STRING ||
+			p->state == JSON_STATE_NUMBER)) {
+		r = json_append(p, data + begin, length - begin);
+		p->copying = 1;
+	}
+
+	if (r) {
+		p->error = 1;
+	}
+
+	return r;
+}
+
+/**
+ * Initialize writer
+ *
+ * @param w - writer
+ */
+void json_writer_init(struct json_writer *w) {
+	memset(w, 0, sizeof(*w));
+}
+
+/**
+ * Make room for more output
+ *
+ * @param w - writer
+ * @param length - bytes to be written (the terminator excluded)
+ */
+static int json_writer_reserve(struct json_writer *w, size_t length) {
+	size_t size;
+	char *buf;
+
+	if (w->error) {
+		return -1;
+	}
+
+	if (w->length + length < w->size) {
+		return 0;
+	}
+
+	for (size = w->size ? w->size : 1024;
+			w->length + length >= size; size <<= 1);
+
+	if (!(buf = realloc(w->buf, size))) {
+		w->error = 1;
+		return -1;
+	}
+
+	w->buf = buf;
+	w->size = size;
+
+	return 0;
+}
+
+/**
+ * Write raw data
+ *
+ * @param w - writer
+ * @param data - data
+ * @param length - data length
+ */
+void json_write(struct json_writer *w, const char *data, size_t length) {
+	if (json_writer_reserve(w, length)) {
+		return;
+	}
+
+	memcpy(w->buf + w->length, data, length);
+	w->length += length;
+	w->buf[w->length] = 0;
+}
+
+/**
+ * Write raw string (e.g. punctuation and keys known to be safe)
+ *
+ * @param w - writer
+ * @param s - string
+ */
+void json_write_raw(struct json_writer *w, const char *s) {
+	json_write(w, s, strlen(s));
+}
+
+/**
+ * Write quoted and escaped string
+ *
+ * @param w - writer
+ * @param s - UTF-8 string
+ */
+void json_write_string(struct json_writer *w, const char *s) {
+	static const char hex[] = "0123456789abcdef";
+	const char *run;
+
+	json_write(w, "\"", 1);
+
+	for (run = s; ; ++s) {
+		unsigned char c = (unsigned char) *s;
+		char escaped[6] = {'\\', 0, '0', '0', 0, 0};
+		size_t l = 2;
+
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		/* bytes that need no escaping are copied at once */
+		json_write(w, run, s - run);
+		run = s + 1;
+
+		switch (c) {
+		case 0:
+			json_write(w, "\"", 1);
+			return;
+		case '"': escaped[1] = '"'; break;
+		case '\\': escaped[1] = '\\'; break;
+		case '\b': escaped[1] = 'b'; break;
+		case '\f': escaped[1] = 'f'; break;
+		case '\n': escaped[1] = 'n'; break;
+		case '\r': escaped[1] = 'r'; break;
+		case '\t': escaped[1] = 't'; break;
+		default:
+			escaped[1] = 'u';
+			escaped[4] = hex[c >> 4];
+			escaped[5] = hex[c & 15];
+			l = 6;
+		}
+
+		json_write(w, escaped, l);
+	}
+}
+
+/**
+ * Write formatted raw text
+ *
+ * @param w - writer
+ * @param format - printf format
+ */
+void json_write_format(struct json_writer *w, const char *format, ...) {
+	va_list ap;
+	int l;
+
+	va_start(ap, format);
+	l = vsnprintf(NULL, 0, format, ap);
+	va_end(ap);
+
+	if (l < 0 || json_writer_reserve(w, l)) {
+		return;
+	}
+
+	va_start(ap, format);
+	vsnprintf(w->buf + w->length, w->size - w->length, format, ap);
+	va_end(ap);
+	w->length += l;
+}
+
+/**
+ * Free writer buffer
+ *
+ * @param w - writer
+ */
+void json_writer_free(struct json_writer *w) {
+	free(w->buf);
+	json_writer_init(w);
+}
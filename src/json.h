@@ -0,0 +1,73 @@
+#ifndef _json_h_
+#define _json_h_
+
+#include <stddef.h>
+
+#ifndef JSON_MAX_DEPTH
+#define JSON_MAX_DEPTH 64
+#endif
+
+/* events passed to the callback */
+enum json_event {
+	JSON_OBJECT_BEGIN,
+	JSON_OBJECT_END,
+	JSON_ARRAY_BEGIN,
+	JSON_ARRAY_END,
+	JSON_KEY,
+	JSON_STRING,
+	JSON_NUMBER,
+	JSON_TRUE,
+	JSON_FALSE,
+	JSON_NULL
+};
+
+/* value/length is the (unescaped) text of keys, strings and numbers;
+ * depth is the nesting level of the event (0 for top-level values);
+ * returning non-zero stops the parser */
+typedef int (*json_callback)(
+	void *arg,
+	enum json_event event,
+	const char *value,
+	size_t length,
+	int depth);
+
+struct json_parser {
+	json_callback callback;
+	void *arg;
+	int state;
+	int key;
+	int depth;
+	char stack[JSON_MAX_DEPTH];
+	int literal;
+	int matched;
+	unsigned code;
+	int digits;
+	unsigned high;
+	int copying;
+	char *buf;
+	size_t length;
+	size_t size;
+	int error;
+};
+
+void json_init(struct json_parser *, json_callback, void *);
+int json_feed(struct json_parser *, const char *, size_t);
+void json_free(struct json_parser *);
+
+/* growable output buffer; error is set by the first failed
+ * allocation and makes all further writes no-ops */
+struct json_writer {
+	char *buf;
+	size_t length;
+	size_t size;
+	int error;
+};
+
+void json_writer_init(struct json_writer *);
+void json_write(struct json_writer *, const char *, size_t);
+void json_write_raw(struct json_writer *, const char *);
+void json_write_string(struct json_writer *, const char *);
+void json_write_format(struct json_writer *, const char *, ...);
+void json_writer_free(struct json_writer *);
+
+#endif
@@ -0,0 +1,617 @@
+/*
+ *  libgraph.c
+ *
+ *  Extends "libgraph.h".
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+
+#include "algo.h"
+#include "generate.h"
+#include "graph.h"
+#include "libgraph.h"
+#include "query.h"
+
+#define LGR_MAX_COMMAND         GLO_MAX_USER_INPUT  /* RUN: Max. command length */
+
+
+/* A graph */
+struct _lgr_graph_t
+{
+    graph_t            *_graph;
+    pthread_mutex_t     _add;       /* So lgr_add() knows the index it has added */
+
+};
+
+
+/* Wraps a graph into a handle.
+ *
+ *  o_graph     - OUT, the handle
+ *  graph       - the graph (taken over), NULL if it could not be made
+ *
+ * Returns LGR_OK or LGR_ERR_MEMORY.
+ */
+static int _lgr_wrp(lgr_t **o_graph, graph_t *graph)
+{
+    *o_graph = NULL;
+    if(graph == NULL)
+        return LGR_ERR_MEMORY;
+
+    lgr_t *h = NULL;
+    if((h = (lgr_t *) malloc(sizeof(lgr_t))) == NULL)
+    {
+        gph_fre(graph);
+        return LGR_ERR_MEMORY;
+    }
+
+    h->_graph = graph;
+    pthread_mutex_init(&h->_add, NULL);
+
+    *o_graph = h;
+    return LGR_OK;
+}
+
+/* Gives # of vertices, safe against concurrent lgr_add() */
+static inline size_t _lgr_len(const lgr_t *graph)
+{
+    return __atomic_load_n(&graph->_graph->_n, __ATOMIC_ACQUIRE);
+}
+
+/* Gives version of the library.
+ *
+ * Returns (LGR_VERSION_MAJOR << 16) | LGR_VERSION_MINOR
+ * of the library actually linked.
+ */
+int lgr_ver(void)
+{
+    return (LGR_VERSION_MAJOR << 16) | LGR_VERSION_MINOR;
+}
+
+/* Describes an error code.
+ *
+ *  err         - LGR_OK or LGR_ERR_*
+ *
+ * Returns static text.
+ */
+const char *lgr_msg(int err)
+{
+    switch (err)
+    {
+    case LGR_OK:            return "Success.";
+    case LGR_ERR_MEMORY:    return "Out of memory.";
+    case LGR_ERR_INDEX:     return "Invalid vertex index.";
+    case LGR_ERR_ARGUMENT:  return "Invalid argument.";
+    case LGR_ERR_IO:        return "File could not be read or written.";
+    case LGR_ERR_FORMAT:    return "File is not a saved graph.";
+    case LGR_ERR_STATE:     return "Not allowed now.";
+    case LGR_ERR_UNKNOWN:   return "Unknown command.";
+    default:                return "Unknown error.";
+    }
+}
+
+/* Creates new, empty graph.
+ *
+ *  o_graph     - OUT, the graph
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_new(lgr_t **o_graph)
+{
+    if(o_graph == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    return _lgr_wrp(o_graph, gph_new(GLO_DEF_GRAPH_SIZE));
+}
+
+/* Builds a graph out of an arch array at once (in
+ * parallel). Lists come out sorted, without duplicates.
+ *
+ *  o_graph     - OUT, the graph
+ *  n           - # of vertices
+ *  arch        - arches, pairs one after another (A0, B0, A1, B1, ...)
+ *  narch       - # of arches (pairs)
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_bld(lgr_t **o_graph, size_t n, const uint32_t *arch, size_t narch)
+{
+    if(o_graph == NULL || n > LGR_MAX_VERTICES || (arch == NULL && narch > 0u))
+        return LGR_ERR_ARGUMENT;
+
+    *o_graph = NULL;
+
+    /* The engine takes 16-bit indexes */
+    index_t *pairs = NULL;
+    if((pairs = (index_t *) malloc(sizeof(index_t) * 2u * (narch + 1u))) == NULL)
+        return LGR_ERR_MEMORY;
+
+    for(size_t i = 0u; i < 2u * narch; ++i)
+    {
+        if(arch[i] >= n)
+        {
+            free(pairs);
+            return LGR_ERR_INDEX;
+        }
+        pairs[i] = (index_t) arch[i];
+    }
+
+    const int ret = _lgr_wrp(o_graph, gph_bld(n, pairs, narch));
+    free(pairs);
+
+    return ret;
+}
+
+/* Generates a random graph: Erdos-Renyi G(n, p).
+ *
+ *  o_graph     - OUT, the graph
+ *  n           - # of vertices
+ *  p           - arch probability
+ *  seed        - generator seed
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_erd(lgr_t **o_graph, size_t n, double p, uint64_t seed)
+{
+    if(o_graph == NULL || n > GEN_MAX_VERTICES || p < 0.0 || p > 1.0)
+        return LGR_ERR_ARGUMENT;
+
+    return _lgr_wrp(o_graph, gen_erd(n, p, seed));
+}
+
+/* Generates a random graph: Barabasi-Albert.
+ *
+ *  o_graph     - OUT, the graph
+ *  n           - # of vertices, more than m
+ *  m           - # of arches per new vertex, at least 1
+ *  seed        - generator seed
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_bar(lgr_t **o_graph, size_t n, size_t m, uint64_t seed)
+{
+    if(o_graph == NULL || n > GEN_MAX_VERTICES || m < 1u || n <= m)
+        return LGR_ERR_ARGUMENT;
+
+    return _lgr_wrp(o_graph, gen_bar(n, m, seed));
+}
+
+/* Generates a random graph: R-MAT.
+ *
+ *  o_graph     - OUT, the graph
+ *  scale       - log2 of # of vertices, up to 15
+ *  narch       - # of arches to be drawn
+ *  a, b, c     - quadrant probabilities (e.g. 0.57, 0.19, 0.19)
+ *  seed        - generator seed
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_rmt(lgr_t **o_graph, size_t scale, size_t narch, double a, double b, double c, uint64_t seed)
+{
+    if(o_graph == NULL || scale > GEN_MAX_RMAT_SCALE || a < 0.0 || b < 0.0 || c < 0.0 || a + b + c > 1.0)
+        return LGR_ERR_ARGUMENT;
+
+    return _lgr_wrp(o_graph, gen_rmt(scale, narch, a, b, c, seed));
+}
+
+/* Generates a 2D grid graph.
+ *
+ *  o_graph     - OUT, the graph
+ *  w, h        - grid dimensions
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_grd(lgr_t **o_graph, size_t w, size_t h)
+{
+    if(o_graph == NULL || (h > 0u && w > GEN_MAX_VERTICES / h))
+        return LGR_ERR_ARGUMENT;
+
+    return _lgr_wrp(o_graph, gen_grd(w, h));
+}
+
+/* Makes a deep copy of a graph.
+ *
+ *  o_graph     - OUT, the copy
+ *  graph       - the original
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_cpy(lgr_t **o_graph, const lgr_t *graph)
+{
+    if(o_graph == NULL || graph == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    return _lgr_wrp(o_graph, gph_cpy(graph->_graph));
+}
+
+/* Frees a graph.
+ *
+ *  graph       - the victim, can be NULL
+ */
+void lgr_fre(lgr_t *graph)
+{
+    if(graph == NULL)
+        return;
+
+    gph_fre(graph->_graph);
+    pthread_mutex_destroy(&graph->_add);
+    free(graph);
+}
+
+/* Turns concurrent mode on or off. Must not be
+ * called while other threads use the graph.
+ *
+ *  graph       - the graph
+ *  on          - 1 - on, 0 - off
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_syn(lgr_t *graph, int on)
+{
+    if(graph == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    return (gph_syn(graph->_graph, on != 0) == 0) ? LGR_OK : LGR_ERR_MEMORY;
+}
+
+/* Gives # of vertices.
+ *
+ *  graph       - the graph
+ *
+ * Returns the number.
+ */
+size_t lgr_len(const lgr_t *graph)
+{
+    return graph ? _lgr_len(graph) : 0u;
+}
+
+/* Adds new, isolated vertex.
+ *
+ *  graph       - the graph
+ *  o_index     - OUT, its index, can be NULL
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_add(lgr_t *graph, uint32_t *o_index)
+{
+    if(graph == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    int ret = LGR_OK;
+    pthread_mutex_lock(&graph->_add);
+
+    const size_t n = graph->_graph->_n;
+    if(n >= LGR_MAX_VERTICES)
+        ret = LGR_ERR_STATE;
+    else if(gph_add(graph->_graph, NULL) != 1u)
+        ret = LGR_ERR_MEMORY;
+    else if(o_index)
+        *o_index = (uint32_t) n;
+
+    pthread_mutex_unlock(&graph->_add);
+    return ret;
+}
+
+/* Deletes a vertex, the following ones are renumbered.
+ *
+ *  graph       - the graph
+ *  index       - the vertex
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_del(lgr_t *graph, uint32_t index)
+{
+    if(graph == NULL)
+        return LGR_ERR_ARGUMENT;
+    if(graph->_graph->_sync)
+        return LGR_ERR_STATE;
+    if(index >= _lgr_len(graph))
+        return LGR_ERR_INDEX;
+
+    return (gph_del(graph->_graph, (index_t) index) != (size_t) -1) ? LGR_OK : LGR_ERR_MEMORY;
+}
+
+/* Adds or deletes arch from A to B.
+ *
+ *  graph       - the graph
+ *  a, b        - the vertices
+ *  op          - LGR_ADD or LGR_DELETE
+ *
+ * Returns 1 if changed, 0 if not (already there or
+ * missing) or LGR_ERR_*.
+ */
+int lgr_con(lgr_t *graph, uint32_t a, uint32_t b, int op)
+{
+    if(graph == NULL || (op != LGR_ADD && op != LGR_DELETE))
+        return LGR_ERR_ARGUMENT;
+
+    const size_t n = _lgr_len(graph);
+    if(a >= n || b >= n)
+        return LGR_ERR_INDEX;
+
+    const size_t r = gph_con(graph->_graph, (index_t) a, (index_t) b, (op == LGR_ADD) ? GPH_ADD : GPH_DELETE);
+    return (r == (size_t) -1) ? LGR_ERR_MEMORY : (int) r;
+}
+
+/* Indicates the type of arch between A and B.
+ *
+ *  graph       - the graph
+ *  a, b        - the vertices
+ *
+ * Returns LGR_NONE/ONEWAY/TWOWAY or LGR_ERR_*.
+ */
+int lgr_typ(const lgr_t *graph, uint32_t a, uint32_t b)
+{
+    if(graph == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    const size_t n = _lgr_len(graph);
+    if(a >= n || b >= n)
+        return LGR_ERR_INDEX;
+
+    switch (gph_typ(graph->_graph, (index_t) a, (index_t) b))
+    {
+    case GPH_ONEWAY:    return LGR_ONEWAY;
+    case GPH_TWOWAY:    return LGR_TWOWAY;
+    case GPH_NONE:      return LGR_NONE;
+    default:            return LGR_ERR_INDEX;
+    }
+}
+
+/* Gives arches coming from a vertex.
+ *
+ *  graph       - the graph
+ *  index       - the vertex
+ *  o_list      - OUT, the vertices they point to, can be NULL
+ *  max         - o_list capacity
+ *  o_n         - OUT, # of arches (may be more than max)
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_adj(const lgr_t *graph, uint32_t index, uint32_t *o_list, size_t max, size_t *o_n)
+{
+    if(graph == NULL || o_n == NULL)
+        return LGR_ERR_ARGUMENT;
+    if(index >= _lgr_len(graph))
+        return LGR_ERR_INDEX;
+
+    const vertex_t *v = graph->_graph->_list[index];
+    *o_n = v->_narch;
+
+    for(size_t i = 0u; o_list && i < v->_narch && i < max; ++i)
+        o_list[i] = v->_arch[i];
+
+    return LGR_OK;
+}
+
+/* Counts triangles of the underlying undirected graph.
+ *
+ *  graph       - the graph
+ *  o_total     - OUT, # of triangles
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_tri(const lgr_t *graph, size_t *o_total)
+{
+    if(graph == NULL || o_total == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    *o_total = alg_tri(graph->_graph, NULL, NULL);
+    return (*o_total == (size_t) -1) ? LGR_ERR_MEMORY : LGR_OK;
+}
+
+/* Finds the shortest path from A to B (breadth-first).
+ *
+ *  graph       - the graph
+ *  a, b        - the vertices
+ *  o_path      - OUT, the path (A first, B last), can be NULL
+ *  max         - o_path capacity
+ *  o_len       - OUT, # of vertices of the path (0 if there is none)
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_pth(const lgr_t *graph, uint32_t a, uint32_t b, uint32_t *o_path, size_t max, size_t *o_len)
+{
+    if(graph == NULL || o_len == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    const size_t n = _lgr_len(graph);
+    if(a >= n || b >= n)
+        return LGR_ERR_INDEX;
+
+    index_t *prev = NULL;
+    if((prev = (index_t *) malloc(sizeof(index_t) * n)) == NULL ||
+       alg_bfs(graph->_graph, (index_t) a, prev, NULL) == (size_t) -1)
+    {
+        free(prev);
+        return LGR_ERR_MEMORY;
+    }
+
+    *o_len = 0u;
+    if(prev[b] != GPH_LAST)
+    {
+        /* Length first, then filled from the end */
+        size_t len = 1u;
+        for(index_t v = (index_t) b; v != a; v = prev[v])
+            ++len;
+
+        *o_len = len;
+        index_t v = (index_t) b;
+        for(size_t i = len; i > 0u; --i, v = prev[v])
+        {
+            if(o_path && i - 1u < max)
+                o_path[i - 1u] = v;
+        }
+    }
+
+    free(prev);
+    return LGR_OK;
+}
+
+/* Saves a graph to a file (the same format as "file" command).
+ *
+ *  graph       - the graph
+ *  path        - file path
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_sav(const lgr_t *graph, const char *path)
+{
+    if(graph == NULL || path == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    FILE *file = NULL;
+    if((file = fopen(path, "w")) == NULL)
+        return LGR_ERR_IO;
+
+    gph_out(graph->_graph, file, GPH_SET_SORT_ASC);
+
+    return (ferror(file) | fclose(file)) ? LGR_ERR_IO : LGR_OK;
+}
+
+/* Loads a graph saved by lgr_sav() or "file" command.
+ * Lines are "<index>: [<B>, <C>, ...]", indexes in order.
+ *
+ *  o_graph     - OUT, the graph
+ *  path        - file path
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_lod(lgr_t **o_graph, const char *path)
+{
+    if(o_graph == NULL || path == NULL)
+        return LGR_ERR_ARGUMENT;
+
+    *o_graph = NULL;
+
+    FILE *file = NULL;
+    if((file = fopen(path, "r")) == NULL)
+        return LGR_ERR_IO;
+
+    index_t *arch = NULL;
+    size_t narch = 0u, nmem = 0u, n = 0u, index = 0u;
+    int ret = LGR_OK;
+    char word[8] = {0, };
+
+    /* An empty graph is saved as "Empty." */
+    if(fscanf(file, " %7[Empty.]", word) == 1)
+        ret = (strcmp(word, "Empty.") == 0) ? LGR_OK : LGR_ERR_FORMAT;
+
+    else while(ret == LGR_OK && fscanf(file, " %zu : [", &index) == 1)
+    {
+        if(index != n || n >= LGR_MAX_VERTICES)
+        {
+            ret = LGR_ERR_FORMAT;
+            break;
+        }
+
+        /* Arches till ']' */
+        int c = 0;
+        while((c = fgetc(file)) != EOF && isspace(c))
+            ;
+        if(c != ']')
+            ungetc(c, file);
+
+        while(c != ']')
+        {
+            unsigned b = 0u;
+            if(fscanf(file, " %u", &b) != 1 || b >= LGR_MAX_VERTICES)
+            {
+                ret = LGR_ERR_FORMAT;
+                break;
+            }
+
+            if(narch == nmem)
+            {
+                index_t *temp = NULL;
+                nmem = nmem ? nmem * 2u : 1024u;
+                if((temp = (index_t *) realloc(arch, sizeof(index_t) * 2u * nmem)) == NULL)
+                {
+                    ret = LGR_ERR_MEMORY;
+                    break;
+                }
+                arch = temp;
+            }
+
+            arch[2u * narch] = (index_t) n;
+            arch[2u * narch + 1u] = (index_t) b;
+            ++narch;
+
+            while((c = fgetc(file)) != EOF && isspace(c))
+                ;
+            if(c != ',' && c != ']')
+            {
+                ret = LGR_ERR_FORMAT;
+                break;
+            }
+        }
+
+        ++n;
+    }
+
+    /* Nothing but whitespace may be left */
+    int c = 0;
+    while((c = fgetc(file)) != EOF && isspace(c))
+        ;
+    if(ret == LGR_OK && (c != EOF || ferror(file)))
+        ret = LGR_ERR_FORMAT;
+    fclose(file);
+
+    /* Arches to vertices that do not exist */
+    for(size_t i = 0u; ret == LGR_OK && i < narch; ++i)
+    {
+        if(arch[2u * i + 1u] >= n)
+            ret = LGR_ERR_FORMAT;
+    }
+
+    if(ret == LGR_OK)
+        ret = _lgr_wrp(o_graph, gph_bld(n, arch, narch));
+
+    free(arch);
+    return ret;
+}
+
+/* Runs a read-only command of the interpreter
+ * (find, tell, list, profile, triangles, path, file).
+ *
+ *  graph       - the graph
+ *  stream      - where the results (and errors) go
+ *  command     - the command, e.g. "list -t"
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+int lgr_run(const lgr_t *graph, FILE *stream, const char *command)
+{
+    if(graph == NULL || stream == NULL || command == NULL || strlen(command) >= LGR_MAX_COMMAND)
+        return LGR_ERR_ARGUMENT;
+
+    /* Words */
+    char line[LGR_MAX_COMMAND];
+    char *argv[QRY_MAX_ARGS + 1u];
+    int argc = 0;
+
+    strcpy(line, command);
+    for(char *c = line; *c && argc < (int) QRY_MAX_ARGS + 1; )
+    {
+        while(*c && isspace((unsigned char) *c))
+            *c++ = '\0';
+        if(*c == '\0')
+            break;
+
+        argv[argc++] = c;
+        while(*c && ! isspace((unsigned char) *c))
+            ++c;
+    }
+
+    if(argc == 0)
+        return LGR_ERR_UNKNOWN;
+
+    switch (qry_run(graph->_graph, stream, argv[0u], argv + 1, argc - 1))
+    {
+    case QRY_RET_SUCCESS:   return LGR_OK;
+    case QRY_RET_UNKNOWN:   return LGR_ERR_UNKNOWN;
+    default:                return LGR_ERR_MEMORY;
+    }
+}
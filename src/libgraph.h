@@ -0,0 +1,276 @@
+/*
+ *  libgraph.h
+ *
+ *  Stable C interface of the graph engine, for
+ *  programs linking libgraph.a or libgraph.so
+ *  (see "make lib"). Graphs are opaque handles,
+ *  vertices are plain indexes (0, 1, ...). Every
+ *  call that can fail returns one of LGR_ERR_*.
+ *
+ *  Handles are not thread-safe, unless put into
+ *  concurrent mode (lgr_syn()), in which lgr_add(),
+ *  lgr_con() and lgr_typ() can be called by many
+ *  threads at once.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_LIBGRAPH_H_FILE_
+#define _GRAPH_LIBGRAPH_H_FILE_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+    #define LGR_API             __attribute__((visibility("default")))
+#else
+    #define LGR_API
+#endif
+
+#define LGR_VERSION_MAJOR       1
+#define LGR_VERSION_MINOR       0
+
+#define LGR_OK                  0       /* Success */
+#define LGR_ERR_MEMORY          -1      /* Out of memory */
+#define LGR_ERR_INDEX           -2      /* Invalid vertex index */
+#define LGR_ERR_ARGUMENT        -3      /* Invalid argument */
+#define LGR_ERR_IO              -4      /* File could not be read or written */
+#define LGR_ERR_FORMAT          -5      /* File is not a saved graph */
+#define LGR_ERR_STATE           -6      /* Not allowed now (e.g. deleting in concurrent mode) */
+#define LGR_ERR_UNKNOWN         -7      /* Unknown command */
+
+#define LGR_NONE                0       /* TYPE: No arch */
+#define LGR_ONEWAY              1       /* TYPE: One way arch (A -> B) XOR (B -> A) */
+#define LGR_TWOWAY              2       /* TYPE: Two way arch (A -> B) AND (B -> A) */
+
+#define LGR_ADD                 1       /* CONNECT: Adds the arch */
+#define LGR_DELETE              2       /* CONNECT: Deletes the arch */
+
+#define LGR_MAX_VERTICES        65534u  /* Max. # of vertices of a graph */
+
+
+/* A graph (opaque) */
+typedef struct _lgr_graph_t lgr_t;
+
+
+/* Gives version of the library.
+ *
+ * Returns (LGR_VERSION_MAJOR << 16) | LGR_VERSION_MINOR
+ * of the library actually linked.
+ */
+LGR_API int         lgr_ver(void);
+
+/* Describes an error code.
+ *
+ *  err         - LGR_OK or LGR_ERR_*
+ *
+ * Returns static text.
+ */
+LGR_API const char *lgr_msg(int err);
+
+/* Creates new, empty graph.
+ *
+ *  o_graph     - OUT, the graph
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_new(lgr_t **o_graph);
+
+/* Builds a graph out of an arch array at once (in
+ * parallel). Lists come out sorted, without duplicates.
+ *
+ *  o_graph     - OUT, the graph
+ *  n           - # of vertices
+ *  arch        - arches, pairs one after another (A0, B0, A1, B1, ...)
+ *  narch       - # of arches (pairs)
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_bld(lgr_t **o_graph, size_t n, const uint32_t *arch, size_t narch);
+
+/* Generates a random graph: Erdos-Renyi G(n, p).
+ *
+ *  o_graph     - OUT, the graph
+ *  n           - # of vertices
+ *  p           - arch probability
+ *  seed        - generator seed
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_erd(lgr_t **o_graph, size_t n, double p, uint64_t seed);
+
+/* Generates a random graph: Barabasi-Albert.
+ *
+ *  o_graph     - OUT, the graph
+ *  n           - # of vertices, more than m
+ *  m           - # of arches per new vertex, at least 1
+ *  seed        - generator seed
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_bar(lgr_t **o_graph, size_t n, size_t m, uint64_t seed);
+
+/* Generates a random graph: R-MAT.
+ *
+ *  o_graph     - OUT, the graph
+ *  scale       - log2 of # of vertices, up to 15
+ *  narch       - # of arches to be drawn
+ *  a, b, c     - quadrant probabilities (e.g. 0.57, 0.19, 0.19)
+ *  seed        - generator seed
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_rmt(lgr_t **o_graph, size_t scale, size_t narch, double a, double b, double c, uint64_t seed);
+
+/* Generates a 2D grid graph.
+ *
+ *  o_graph     - OUT, the graph
+ *  w, h        - grid dimensions
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_grd(lgr_t **o_graph, size_t w, size_t h);
+
+/* Makes a deep copy of a graph.
+ *
+ *  o_graph     - OUT, the copy
+ *  graph       - the original
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_cpy(lgr_t **o_graph, const lgr_t *graph);
+
+/* Frees a graph.
+ *
+ *  graph       - the victim, can be NULL
+ */
+LGR_API void        lgr_fre(lgr_t *graph);
+
+/* Turns concurrent mode on or off. Must not be
+ * called while other threads use the graph.
+ *
+ *  graph       - the graph
+ *  on          - 1 - on, 0 - off
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_syn(lgr_t *graph, int on);
+
+/* Gives # of vertices.
+ *
+ *  graph       - the graph
+ *
+ * Returns the number.
+ */
+LGR_API size_t      lgr_len(const lgr_t *graph);
+
+/* Adds new, isolated vertex.
+ *
+ *  graph       - the graph
+ *  o_index     - OUT, its index, can be NULL
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_add(lgr_t *graph, uint32_t *o_index);
+
+/* Deletes a vertex, the following ones are renumbered.
+ *
+ *  graph       - the graph
+ *  index       - the vertex
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_del(lgr_t *graph, uint32_t index);
+
+/* Adds or deletes arch from A to B.
+ *
+ *  graph       - the graph
+ *  a, b        - the vertices
+ *  op          - LGR_ADD or LGR_DELETE
+ *
+ * Returns 1 if changed, 0 if not (already there or
+ * missing) or LGR_ERR_*.
+ */
+LGR_API int         lgr_con(lgr_t *graph, uint32_t a, uint32_t b, int op);
+
+/* Indicates the type of arch between A and B.
+ *
+ *  graph       - the graph
+ *  a, b        - the vertices
+ *
+ * Returns LGR_NONE/ONEWAY/TWOWAY or LGR_ERR_*.
+ */
+LGR_API int         lgr_typ(const lgr_t *graph, uint32_t a, uint32_t b);
+
+/* Gives arches coming from a vertex.
+ *
+ *  graph       - the graph
+ *  index       - the vertex
+ *  o_list      - OUT, the vertices they point to, can be NULL
+ *  max         - o_list capacity
+ *  o_n         - OUT, # of arches (may be more than max)
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_adj(const lgr_t *graph, uint32_t index, uint32_t *o_list, size_t max, size_t *o_n);
+
+/* Counts triangles of the underlying undirected graph.
+ *
+ *  graph       - the graph
+ *  o_total     - OUT, # of triangles
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_tri(const lgr_t *graph, size_t *o_total);
+
+/* Finds the shortest path from A to B (breadth-first).
+ *
+ *  graph       - the graph
+ *  a, b        - the vertices
+ *  o_path      - OUT, the path (A first, B last), can be NULL
+ *  max         - o_path capacity
+ *  o_len       - OUT, # of vertices of the path (0 if there is none)
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_pth(const lgr_t *graph, uint32_t a, uint32_t b, uint32_t *o_path, size_t max, size_t *o_len);
+
+/* Saves a graph to a file (the same format as "file" command).
+ *
+ *  graph       - the graph
+ *  path        - file path
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_sav(const lgr_t *graph, const char *path);
+
+/* Loads a graph saved by lgr_sav() or "file" command.
+ *
+ *  o_graph     - OUT, the graph
+ *  path        - file path
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_lod(lgr_t **o_graph, const char *path);
+
+/* Runs a read-only command of the interpreter
+ * (find, tell, list, profile, triangles, path, file).
+ *
+ *  graph       - the graph
+ *  stream      - where the results (and errors) go
+ *  command     - the command, e.g. "list -t"
+ *
+ * Returns LGR_OK or LGR_ERR_*.
+ */
+LGR_API int         lgr_run(const lgr_t *graph, FILE *stream, const char *command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GRAPH_LIBGRAPH_H_FILE_ */
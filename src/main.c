@@ -1,19 +1,34 @@
 #include <stdio.h>
+#include <time.h>
 
+#include "algo.h"
 #include "command.h"
+#include "generate.h"
 #include "global.h"
 #include "graph.h"
 #include "misc.h"
+#include "query.h"
+#include "registry.h"
+#include "server.h"
 #include "terminal.h"
 #include "ai.h"
 
-/* GLOBAL GRAPH */
-static graph_t *g_graph = NULL;
+/* GLOBAL GRAPH (registry slot of the one in use, see "registry.h") */
+static graph_t **g_graph = NULL;
+static char g_name[REG_MAX_NAME] = REG_DEF_NAME;
 
 
-/* CMD: For "tell" command */
-/* Prints details */
-void *_command_tell(char **argv, int argc);
+/* Runs a read-only command (see "query.h") on the graph */
+static void *_command_read(const char *name, char **argv, int argc)
+{
+    if(qry_run(*g_graph, stdout, name, argv, argc) == QRY_RET_ERROR)
+    {
+        msc_err("Critical memory error. Closing...");
+        exit(EXIT_FAILURE);
+    }
+
+    return NULL;
+}
 
 
 /* CMD: For "add" command */
@@ -24,11 +39,11 @@ void *_command_add(char **argv, int argc)
 
     /* If argc = 0, the vertex is isolated */
     /* Showing warning only if the graph is not empty */
-    if(argc == 0 && g_graph->_n > 0u)
+    if(argc == 0 && (*g_graph)->_n > 0u)
         msc_war("This vertex will be isolated (0 arches).");
 
     /* Adding fresh vertex */
-    if(gph_add(g_graph, NULL) != 1u)
+    if(gph_add(*g_graph, NULL) != 1u)
     {
         msc_err("Critical memory error. Closing...");
         exit(EXIT_FAILURE);
@@ -48,7 +63,7 @@ void *_command_add(char **argv, int argc)
         }
 
         /* Trying to create a connection */
-        size_t temp = gph_con(g_graph, GPH_LAST, arch, GPH_ADD);
+        size_t temp = gph_con(*g_graph, GPH_LAST, arch, GPH_ADD);
         if(temp == (size_t) -1)
         {
             msc_err("Critical memory error. Closing...");
@@ -62,7 +77,7 @@ void *_command_add(char **argv, int argc)
             msc_err(buf);
 
             /* Deleting */
-            gph_del(g_graph, GPH_LAST);
+            gph_del(*g_graph, GPH_LAST);
             return NULL;
         }
 
@@ -72,7 +87,7 @@ void *_command_add(char **argv, int argc)
     /* Printing info (success) */
     {
         char buf[GLO_MAX_MSG_OUTPUT] = {0, };
-        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Created new vertex (ID = %zu, arches = %zu).", g_graph->_n - 1u, added);
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Created new vertex (ID = %zu, arches = %zu).", (*g_graph)->_n - 1u, added);
         msc_inf(buf);
     }
 
@@ -125,7 +140,7 @@ void *_command_arch(char **argv, int argc)
     }
 
     /* Operation */
-    const size_t result = gph_con(g_graph, a, b, operation);
+    const size_t result = gph_con(*g_graph, a, b, operation);
     if(result == (size_t) -1)
     {
         msc_err("Critical memory error. Closing...");
@@ -133,7 +148,7 @@ void *_command_arch(char **argv, int argc)
     }
 
     /* Bad A index */
-    else if(result == 0u && (a >= g_graph->_n && a != GPH_LAST))
+    else if(result == 0u && (a >= (*g_graph)->_n && a != GPH_LAST))
     {
         /* Printing info (failure) */
         char buf[GLO_MAX_MSG_OUTPUT] = {0, };
@@ -142,7 +157,7 @@ void *_command_arch(char **argv, int argc)
     }
 
     /* Bad B index */
-    else if(result == 0u && (b >= g_graph->_n && b != GPH_LAST))
+    else if(result == 0u && (b >= (*g_graph)->_n && b != GPH_LAST))
     {
         /* Printing info (failure) */
         char buf[GLO_MAX_MSG_OUTPUT] = {0, };
@@ -160,6 +175,52 @@ void *_command_arch(char **argv, int argc)
     return NULL;
 }
 
+/* CMD: For "clone" command */
+/* Clones the graph in use under a new name (lists are shared) */
+void *_command_clone(char **argv, int argc)
+{
+    /* Validation */
+    if(argc < 1)
+    {
+        msc_err("Missing parameter.");
+        return NULL;
+    }
+
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+
+    if(! reg_nam(argv[0u]))
+    {
+        msc_err("Invalid name (up to 31 letters, digits, \'_\' or \'-\').");
+        return NULL;
+    }
+    else if(reg_get(argv[0u]))
+    {
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Graph already exists (%s).", argv[0u]);
+        msc_err(buf);
+        return NULL;
+    }
+
+    graph_t *g = NULL;
+    if((g = gph_cln(*g_graph)) == NULL)
+    {
+        msc_err("Critical memory error. Closing...");
+        exit(EXIT_FAILURE);
+    }
+
+    if(reg_add(argv[0u], g) != REG_RET_SUCCESS)
+    {
+        gph_fre(g);
+        msc_err("Too many graphs.");
+        return NULL;
+    }
+
+    /* Printing info (success) */
+    snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Cloned \'%s\' as \'%s\' (vertices = %zu).", g_name, argv[0u], g->_n);
+    msc_inf(buf);
+
+    return NULL;
+}
+
 /* CMD: For "cls" command */
 /* Cleans the screen */
 void *_command_cls(char **argv, int argc)
@@ -203,7 +264,7 @@ void *_command_del(char **argv, int argc)
             msc_err("Expected positive integer or \'last\'.");
             return NULL;
         }
-        else if(index != GPH_LAST && index >= g_graph->_n)
+        else if(index != GPH_LAST && index >= (*g_graph)->_n)
         {
             /* Printing info (failure) */
             char buf[GLO_MAX_MSG_OUTPUT] = {0, };
@@ -222,7 +283,7 @@ void *_command_del(char **argv, int argc)
     /* For each index */
     for(int i = 0; i < argc; ++i)
     {
-        const size_t result = gph_del(g_graph, tab[i]);
+        const size_t result = gph_del(*g_graph, tab[i]);
 
             if(result == (size_t) -1)
             {
@@ -253,80 +314,87 @@ void *_command_exit(char **argv, int argc)
     exit(EXIT_SUCCESS);
 }
 
+/* CMD: For "file" command */
+/* Saves the graph to a file */
+void *_command_file(char **argv, int argc)
+{
+    return _command_read("file", argv, argc);
+}
+
 /* CMD: For "find" command */
 /* Finds a connection (arch) */
 void *_command_find(char **argv, int argc)
 {
-    /* Validation */
-    if(argc < 2)
+    return _command_read("find", argv, argc);
+}
+
+/* CMD: For "gen" command */
+/* Replaces the graph with a generated one */
+void *_command_gen(char **argv, int argc)
+{
+    /* Params and flags */
+    gen_spec_t spec;
+    char err[GLO_MAX_MSG_OUTPUT] = {0, };
+
+    if(gen_prs(argv, argc, &spec, err) != 0)
     {
-        msc_err("Missing parameters.");
+        msc_err(err);
         return NULL;
     }
 
+    /* Asking (no force, graph not empty) */
+    if(! spec._force && (*g_graph)->_n > 0u)
+    {
+        /* Input */
+        char c = 0;
+        do
+        {
+            msc_war("Do you really want to replace the graph? y/n [ ]");
+            cur_move(UP, 1u);
+            cur_move(RIGHT, strlen("Do you really want to replace the graph? y/n [ ]") + 1u);
 
-    index_t a = 0u, b = 0u;
-    int result = 0;
+            c = getchar();
+            fflush(stdin);
 
-    /* 1st param */
-    if(strcmp(argv[0u], "last") == 0)
-        a = GPH_LAST;
+        } while (tolower(c) != 'y' && tolower(c) != 'n');
 
-    else if(sscanf(argv[0u], "%hu", &a) < 1)
-    {
-        msc_err("Expected positive integer or \'last\'.");
-        return NULL;
+        if(tolower(c) == 'y')
+            /* OK */;
+        else
+            return NULL; /* No permission */
     }
 
-    /* 2nd param */
-    if(strcmp(argv[1u], "last") == 0)
-        b = GPH_LAST;
-
-    else if(sscanf(argv[1u], "%hu", &b) < 1)
+    /* Generating */
+    graph_t *g = NULL;
+    if((g = gen_run(&spec)) == NULL)
     {
-        msc_err("Expected positive integer or \'last\'.");
+        msc_err("Not enough memory, the graph is kept.");
         return NULL;
     }
 
-    /* Operation */
-    result = gph_typ(g_graph, a, b);
+    gph_fre(*g_graph);
+    *g_graph = g;
 
-    /* Bad A index */
-    if(result == (size_t) -1 && (a >= g_graph->_n && a != GPH_LAST))
+    /* Printing info (success) */
     {
-        /* Printing info (failure) */
-        char buf[GLO_MAX_MSG_OUTPUT] = {0, };
-        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Invalid vertex index (%hu).", a);
-        msc_err(buf);
-    }
+        size_t narch = 0u;
+        for(size_t i = 0u; i < (*g_graph)->_n; ++i)
+            narch += (*g_graph)->_list[i]->_narch;
 
-    /* Bad B index */
-    else if(result == (size_t) -1 && (b >= g_graph->_n && b != GPH_LAST))
-    {
-        /* Printing info (failure) */
         char buf[GLO_MAX_MSG_OUTPUT] = {0, };
-        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Invalid vertex index (%hu).", b);
-        msc_err(buf);
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Generated graph (vertices = %zu, arches = %zu, seed = %llu).", (*g_graph)->_n, narch,
+                 (unsigned long long) spec._seed);
+        msc_inf(buf);
     }
 
-    /* Valid indexes */
-    else
-    {
-        switch (result)
-        {
-        case GPH_ONEWAY:
-            msc_inf("One-way connection found (A --> B).");
-            return NULL;
-
-        case GPH_TWOWAY:
-            msc_inf("Two-way connection found (A <-> B).");
-            return NULL;
+    return NULL;
+}
 
-        default:
-            msc_inf("No connection found.");
-            return NULL;
-        }
-    }
+/* CMD: For "graphs" command */
+/* Lists the graphs */
+void *_command_graphs(char **argv, int argc)
+{
+    reg_out(stdout, g_name);
 
     return NULL;
 }
@@ -338,19 +406,39 @@ void *_command_help(char **argv, int argc)
     fprintf(stdout, "\nBasic Graph Generator - Help                                                 \n\n");
     fprintf(stdout, "\tadd      [A B C ...]         - adds new vertex pointing to A, B, C ... vertices\n");
     fprintf(stdout, "\tarch     <add/del> <A> <B>   - adds/deletes an arch from A to B                \n");
+    fprintf(stdout, "\tclone    <name>              - clones the graph in use (lists are shared)      \n");
     fprintf(stdout, "\tcls                          - clears the screen                               \n");
     fprintf(stdout, "\tdel      <A>                 - deletes A vertex, updating whole graph          \n");
     fprintf(stdout, "\texit                         - closes the program                              \n");
     fprintf(stdout, "\tfile     <name>              - saves the graph to the given file               \n");
     fprintf(stdout, "\tfind     <A> <B>             - looks for an A to B arch                        \n");
+    fprintf(stdout, "\tgen      er   <n> <p>        - generates Erdos-Renyi graph (arch probability p) \n");
+    fprintf(stdout, "\tgen      ba   <n> <m>        - generates Barabasi-Albert graph (m arches/vertex)\n");
+    fprintf(stdout, "\tgen      rmat <s> <e> [a b c]- generates R-MAT graph (2^s vertices, e arches)  \n");
+    fprintf(stdout, "\tgen      grid <w> <h>        - generates w x h grid graph                      \n");
+    fprintf(stdout, "\t         ... [-s seed] [-f]  - (-s - generator seed, -f - with force)          \n");
+    fprintf(stdout, "\tgraphs                       - lists the graphs (* - the one in use)           \n");
     fprintf(stdout, "\thelp                         - who knows...                                    \n");
     fprintf(stdout, "\tlist     [-t]                - prints the graph (-t - with \'tell\')           \n");
     fprintf(stdout, "\tnew      [-f]                - clears the graph (-f - with force )             \n");
+    fprintf(stdout, "\tpath     <A> <B>             - finds the shortest path from A to B             \n");
+    fprintf(stdout, "\tprofile                      - prints degree distribution and graph profile    \n");
+    fprintf(stdout, "\tquery    [command ...]       - runs file/find/list/path/profile/tell/triangles in the\n");
+    fprintf(stdout, "\t                             background, on the graph as it is now (no command - lists them)\n");
     fprintf(stdout, "\tset      <A>: [B C D ...]    - updates A vertex                                \n");
     fprintf(stdout, "\tsize     <n> [-f]            - resizes the graph (-f - with force )            \n");
     fprintf(stdout, "\ttell                         - prints info about the graph                     \n");
-    fprintf(stdout, "\tai                           - opens AI prompt that can generate commands from user input\n");
-    fprintf(stdout, "\taimodel                      - changes used ollama model\n");
+    fprintf(stdout, "\ttriangles [-v]               - counts triangles (-v - per vertex clustering)   \n");
+    fprintf(stdout, "\tuse      <name>              - switches to the graph (a new one is empty)      \n");
+    fprintf(stdout, "\tai       [-s] [-g] [-b] [-n] [-a] [-j] - opens AI prompt that can generate commands from user input\n");
+    fprintf(stdout, "\t                             (-s - streamed, -g - tell it the graph, -b - queued as a background job,\n");
+    fprintf(stdout, "\t                              -n - do not answer from the cache, -a - review as a diff and apply all at once,\n");
+    fprintf(stdout, "\t                              -j - the same, but the AI answers with JSON edits instead of commands;\n");
+    fprintf(stdout, "\t                              Ctrl-C cancels)\n");
+    fprintf(stdout, "\taicache  [-c]                - tells how many answers are cached (-c - clears the cache)\n");
+    fprintf(stdout, "\taimodel                      - changes used ollama model (and resets the conversation)\n");
+    fprintf(stdout, "\taireset                      - starts new AI conversation (the context is kept between prompts)\n");
+    fprintf(stdout, "\tjobs                         - lists background AI jobs with their progress and latency\n");
     fprintf(stdout, "\n");
     return NULL;
 }
@@ -359,36 +447,7 @@ void *_command_help(char **argv, int argc)
 /* Prints the graph */
 void *_command_list(char **argv, int argc)
 {
-#define FLAG_TELL       (1 << 0)
-
-    /* Check flags */
-    int settings = 0;
-    for(int i = 0; i < argc; ++i)
-    {
-        if(strcmp(argv[i], "-t") == 0)
-            settings |= FLAG_TELL;
-
-        /* Wrong flag */
-        else
-        {
-            /* Printing info (failure) */
-            char buf[GLO_MAX_MSG_OUTPUT] = {0, };
-            snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Invalid flag (%s).", argv[i]);
-            msc_err(buf);
-            return NULL;
-        }
-    }
-
-    /* Printing */
-    gph_out(g_graph, stdout, GPH_SET_SORT_ASC | GPH_SET_MARK_DUAL);
-
-    /* Optional: tell */
-    if(settings & FLAG_TELL)
-        _command_tell(NULL, 0);
-
-    return NULL;
-
-#undef FLAG_TELL
+    return _command_read("list", argv, argc);
 }
 
 /* CMD: For "new" command */
@@ -439,8 +498,8 @@ void *_command_new(char **argv, int argc)
 
     /* Deleting */
 
-    gph_fre(g_graph);
-    if((g_graph = gph_new(GLO_DEF_GRAPH_SIZE)) == NULL)
+    gph_fre(*g_graph);
+    if((*g_graph = gph_new(GLO_DEF_GRAPH_SIZE)) == NULL)
     {
         msc_err("Critical memory error. Closing...");
         exit(EXIT_FAILURE);
@@ -456,7 +515,58 @@ void *_command_new(char **argv, int argc)
 #undef FLAG_FORCE
 }
 
+/* CMD: For "path" command */
+/* Finds the shortest path from A to B */
+void *_command_path(char **argv, int argc)
+{
+    return _command_read("path", argv, argc);
+}
+
+/* CMD: For "profile" command */
+/* Prints degree distribution and graph profile */
+void *_command_profile(char **argv, int argc)
+{
+    return _command_read("profile", argv, argc);
+}
+
+/* CMD: For "query" command */
+/* Runs a read-only command in the background, on a snapshot of the graph */
+void *_command_query(char **argv, int argc)
+{
+    /* No query: listing the running ones */
+    if(argc < 1)
+    {
+        if(qry_lst(stdout) == 0u)
+            msc_inf("No queries running.");
+        return NULL;
+    }
+
+    int id = 0;
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+
+    switch (qry_sub(*g_graph, argv, argc, &id))
+    {
+    case QRY_RET_SUCCESS:
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Query #%d queued.", id);
+        msc_inf(buf);
+        break;
+
+    case QRY_RET_UNKNOWN:
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Not a read-only command (%s).", argv[0u]);
+        msc_err(buf);
+        break;
+
+    case QRY_RET_BUSY:
+        msc_err("Too many queries running. Try again later.");
+        break;
 
+    default:
+        msc_err("Critical memory error. Closing...");
+        exit(EXIT_FAILURE);
+    }
+
+    return NULL;
+}
 
 /* CMD: For "set" command */
 /* Changes chosen vertex */
@@ -498,7 +608,7 @@ void *_command_set(char **argv, int argc)
     argv[0u][strlen(argv[0u]) - 1u] = ':';
 
     /* Checking if the target index is good */
-    if(index >= g_graph->_n && index != GPH_LAST)
+    if(index >= (*g_graph)->_n && index != GPH_LAST)
     {
         /* Printing info (failure) */
         char buf[GLO_MAX_MSG_OUTPUT] = {0, };
@@ -518,7 +628,7 @@ void *_command_set(char **argv, int argc)
             msc_err("Expected positive integer or \'last\'.");
             return NULL;
         }
-        else if(arch >= g_graph->_n && arch != GPH_LAST)
+        else if(arch >= (*g_graph)->_n && arch != GPH_LAST)
         {
             /* Printing info (failure) */
             char buf[GLO_MAX_MSG_OUTPUT] = {0, };
@@ -529,15 +639,14 @@ void *_command_set(char **argv, int argc)
     }
 
     if(index == GPH_LAST)
-        index = g_graph->_n - 1u;
+        index = (*g_graph)->_n - 1u;
 
     /* The params (should be) good */
     /* Now the target vertex can be reset */
-    free(g_graph->_list[index]->_arch);
-    free(g_graph->_list[index]);
+    gph_vfr(*g_graph, (*g_graph)->_list[index]);
 
     /* Alloc */
-    if((g_graph->_list[index] = gph_new_vtx(NULL, 0u)) == NULL)
+    if(((*g_graph)->_list[index] = gph_new_vtx(NULL, 0u)) == NULL)
     {
         msc_err("Critical memory error. Closing...");
         exit(EXIT_FAILURE);
@@ -558,7 +667,7 @@ void *_command_set(char **argv, int argc)
             return NULL;
         }
 
-        size_t result = gph_con(g_graph, index, arch, GPH_ADD);
+        size_t result = gph_con(*g_graph, index, arch, GPH_ADD);
         if(result == (size_t) -1)
         {
             msc_err("Critical memory error. Closing...");
@@ -618,17 +727,17 @@ void *_command_size(char **argv, int argc)
     }
 
     /* Previous size */
-    const size_t prevs = g_graph->_n;
+    const size_t prevs = (*g_graph)->_n;
 
     /* No changes */
-    if(n == g_graph->_n)
+    if(n == (*g_graph)->_n)
     {
         msc_inf("Nothing changed.");
         return NULL;
     }
 
     /* Deleting */
-    else if(n < g_graph->_n)
+    else if(n < (*g_graph)->_n)
     {
         /* Asking (no force) */
         if(! (settings & FLAG_FORCE))
@@ -653,9 +762,9 @@ void *_command_size(char **argv, int argc)
         }
 
         /* Deleting approved */
-        while(g_graph->_n > n)
+        while((*g_graph)->_n > n)
         {
-            if(gph_del(g_graph, GPH_LAST) > 1u)
+            if(gph_del(*g_graph, GPH_LAST) > 1u)
             {
                 msc_err("Could not finish this operation.");
                 return NULL;
@@ -666,9 +775,9 @@ void *_command_size(char **argv, int argc)
     /* Adding */
     else
     {
-        while(g_graph->_n < n)
+        while((*g_graph)->_n < n)
         {
-            if(gph_add(g_graph, NULL) != 1u)
+            if(gph_add(*g_graph, NULL) != 1u)
             {
                 msc_err("Could not finish this operation.");
                 return NULL;
@@ -679,7 +788,7 @@ void *_command_size(char **argv, int argc)
     /* Success */
     {
         char buf[GLO_MAX_MSG_OUTPUT];
-        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "%s %zu vertex(vertices).", ((prevs < g_graph->_n) ? "Added" : "Deleted"), abs((long long int) prevs - (long long int) g_graph->_n));
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "%s %zu vertex(vertices).", ((prevs < (*g_graph)->_n) ? "Added" : "Deleted"), abs((long long int) prevs - (long long int) (*g_graph)->_n));
         msc_inf(buf);
     }
 
@@ -688,21 +797,69 @@ void *_command_size(char **argv, int argc)
 #undef FLAG_FORCE
 }
 
+/* CMD: For "use" command */
+/* Switches to another graph (a new, empty one if there is none) */
+void *_command_use(char **argv, int argc)
+{
+    /* Validation */
+    if(argc < 1)
+    {
+        msc_err("Missing parameter.");
+        return NULL;
+    }
+
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+    graph_t **slot = reg_get(argv[0u]);
+
+    /* New one */
+    if(slot == NULL)
+    {
+        if(! reg_nam(argv[0u]))
+        {
+            msc_err("Invalid name (up to 31 letters, digits, \'_\' or \'-\').");
+            return NULL;
+        }
+
+        graph_t *g = NULL;
+        if((g = gph_new(GLO_DEF_GRAPH_SIZE)) == NULL)
+        {
+            msc_err("Critical memory error. Closing...");
+            exit(EXIT_FAILURE);
+        }
+
+        if(reg_add(argv[0u], g) != REG_RET_SUCCESS)
+        {
+            gph_fre(g);
+            msc_err("Too many graphs.");
+            return NULL;
+        }
+
+        slot = reg_get(argv[0u]);
+    }
+
+    g_graph = slot;
+    snprintf(g_name, REG_MAX_NAME, "%s", argv[0u]);
+    ai_bind_graph(g_graph);
+
+    /* Printing info (success) */
+    snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Using graph \'%s\' (vertices = %zu).", g_name, (*g_graph)->_n);
+    msc_inf(buf);
+
+    return NULL;
+}
+
 /* CMD: For "tell" command */
 /* Prints details */
 void *_command_tell(char **argv, int argc)
 {
-    /* Getting info */
-    size_t oway = 0u, tway = 0u, isol = 0u;
-    gph_cnt(g_graph, &oway, &tway, &isol);
-
-    /* Just printing info */
-    fprintf(stdout, "\tsize:               %zu\n", g_graph->_n);
-    fprintf(stdout, "\t1-way arches:       %zu\n", oway);
-    fprintf(stdout, "\t2-way arches:       %zu\n", tway);
-    fprintf(stdout, "\tisolated vertices:  %zu\n", isol);
+    return _command_read("tell", argv, argc);
+}
 
-    return NULL;
+/* CMD: For "triangles" command */
+/* Counts triangles and clustering coefficients */
+void *_command_triangles(char **argv, int argc)
+{
+    return _command_read("triangles", argv, argc);
 }
 
 
@@ -713,44 +870,61 @@ int main(int argc, char **argv)
 //#define MAIN_DBG
 #ifdef MAIN_DBG
 
-    g_graph = gph_new(128);
-    if(! g_graph)
+    graph_t *graph = gph_new(128);
+    if(! graph)
     {
         return 1;
     }
 
     size_t r = 0u;
 
-    r += gph_add(g_graph, NULL);
-    r += gph_add(g_graph, NULL);
-    r += gph_add(g_graph, NULL);
-    r += gph_add(g_graph, NULL);
-    r += gph_add(g_graph, NULL);
-    r += gph_add(g_graph, NULL);
+    r += gph_add(graph, NULL);
+    r += gph_add(graph, NULL);
+    r += gph_add(graph, NULL);
+    r += gph_add(graph, NULL);
+    r += gph_add(graph, NULL);
+    r += gph_add(graph, NULL);
 
-    r += gph_con(g_graph, 0, 1, GPH_ADD);
-    r += gph_con(g_graph, 1, 2, GPH_ADD);
-    r += gph_con(g_graph, 2, 3, GPH_ADD);
-    r += gph_con(g_graph, 3, 4, GPH_ADD);
+    r += gph_con(graph, 0, 1, GPH_ADD);
+    r += gph_con(graph, 1, 2, GPH_ADD);
+    r += gph_con(graph, 2, 3, GPH_ADD);
+    r += gph_con(graph, 3, 4, GPH_ADD);
 
-    gph_out(g_graph, stdout, 0);
+    gph_out(graph, stdout, 0);
     printf("%zu\n", r);
 
 #else
+    /* Daemon mode */
+    if(argc > 1 && strcmp(argv[1u], "-s") == 0)
+    {
+        if(argc != 3)
+        {
+            msc_err("Usage: graph.out -s <socket path>");
+            return EXIT_FAILURE;
+        }
+
+        return (srv_run(argv[2u], 0u) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     /* Atexit */
     atexit((void (*)(void))_command_exit);
 
     /* Graph */
-    g_graph = gph_new(GLO_DEF_GRAPH_SIZE);
-    if(g_graph == NULL)
+    graph_t *graph = gph_new(GLO_DEF_GRAPH_SIZE);
+    if(graph == NULL || reg_add(g_name, graph) != REG_RET_SUCCESS)
     {
         msc_err("Critical memory error. Closing...");
         exit(EXIT_FAILURE);
     }
+    g_graph = reg_get(g_name);
+
+    /* The AI can be told about the graph */
+    ai_bind_graph(g_graph);
 
     /* Commands */
     cmd_add("add",      _command_add);
     cmd_add("arch",     _command_arch);
+    cmd_add("clone",    _command_clone);
     cmd_add("cls",      _command_cls);
     cmd_add("del",      _command_del);
 
@@ -758,20 +932,37 @@ int main(int argc, char **argv)
     cmd_add("quit",     _command_exit);
     cmd_add("q",        _command_exit);
 
+    cmd_add("file",     _command_file);
     cmd_add("find",     _command_find);
+    cmd_add("gen",      _command_gen);
+    cmd_add("graphs",   _command_graphs);
     cmd_add("help",     _command_help);
     cmd_add("list",     _command_list);
     cmd_add("new",      _command_new);
+    cmd_add("path",     _command_path);
+    cmd_add("profile",  _command_profile);
+    cmd_add("query",    _command_query);
     cmd_add("set",      _command_set);
     cmd_add("size",     _command_size);
     cmd_add("tell",     _command_tell);
+    cmd_add("triangles",_command_triangles);
+    cmd_add("use",      _command_use);
     cmd_add("ai",       _command_ai);
     cmd_add("aitest",   _command_ai_test);
     cmd_add("aimodel",  _command_ai_model);
+    cmd_add("aireset",  _command_ai_reset);
+    cmd_add("jobs",     _command_jobs);
+    cmd_add("aicache",  _command_ai_cache);
 
     /* Input loop */
     while(1)
     {
+        /* Answers of background AI requests are confirmed between commands */
+        ai_review();
+
+        /* So are results of background queries */
+        qry_rev();
+
         char *input = NULL;
         if((input = msc_inp()) == NULL)
         {
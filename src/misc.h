@@ -14,6 +14,12 @@
 #include <assert.h>
 #include <stdio.h>
 
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
 #include "global.h"
 #include "terminal.h"
 
@@ -75,4 +81,24 @@ static inline char *msc_inp(void)
     return buffer;
 }
 
+/* Gives # of worker threads worth starting.
+ *
+ *  Returns # of online CPUs, limited to [1, GLO_MAX_THREADS].
+ */
+static inline size_t msc_cpu(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long n = (long) info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    if(n < 1)
+        return 1u;
+
+    return ((size_t) n > GLO_MAX_THREADS) ? GLO_MAX_THREADS : (size_t) n;
+}
+
 #endif /* _GRAPH_MISC_H_FILE_ */
\ No newline at end of file
@@ -0,0 +1,708 @@
+/*
+ *  query.c
+ *
+ *  Extends "query.h".
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "algo.h"
+#include "epoch.h"
+#include "misc.h"
+#include "query.h"
+
+#define QRY_JOB_QUEUED          0       /* JOB: Waiting for a worker */
+#define QRY_JOB_RUNNING         1       /* JOB: Being run */
+#define QRY_JOB_DONE            2       /* JOB: Finished, results not printed yet */
+#define QRY_JOB_FAILED          3       /* JOB: Out of memory */
+
+
+/* Query function alias */
+typedef int (*qry_func_t)(const graph_t *, FILE *, char **, int);
+
+/* A query */
+typedef struct _qry_query_t
+{
+    const char     *_name;
+    qry_func_t      _fnexe;
+
+} query_t;
+
+/* A queued query */
+typedef struct _qry_job_t
+{
+    int             _id;
+    int             _state;                     /* QRY_JOB_* */
+    const query_t  *_query;
+    char            _line[GLO_MAX_USER_INPUT];  /* The query, as typed */
+    char            _args[GLO_MAX_USER_INPUT];  /* Its arguments, one after another */
+    char           *_argv[QRY_MAX_ARGS];
+    int             _argc;
+
+    int             _slot;                      /* Reader slot, keeps the snapshot alive */
+    const snap_t   *_snap;
+    FILE           *_out;                       /* Results */
+    double          _sec;                       /* Run time */
+
+    struct _qry_job_t *_next;
+
+} qry_job_t;
+
+
+/* Queued queries, in order */
+static qry_job_t *g_jobs = NULL;
+static int g_nid = 0;
+static int g_started = 0;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+
+/* What the current snapshot has been copied from */
+static const graph_t *g_src = NULL;
+static size_t g_src_n = 0u;
+static uint32_t g_src_stamp = 0u;
+
+
+/* Gives monotonic time in seconds */
+static double _qry_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* Reports an error: straight to stderr when
+ * run in the foreground, to the results otherwise */
+static void _qry_err(FILE *stream, const char *msg)
+{
+    if(stream == stdout)
+        msc_err(msg);
+    else
+        fprintf(stream, "E: %s\n", msg);
+}
+
+/* Reports an info, the same way as _qry_err() */
+static void _qry_inf(FILE *stream, const char *msg)
+{
+    if(stream == stdout)
+        msc_inf(msg);
+    else
+        fprintf(stream, "I: %s\n", msg);
+}
+
+/* Reads a vertex index (or 'last').
+ *
+ *  stream      - where errors go
+ *  text        - the argument
+ *  o_index     - OUT, the index
+ *
+ * Returns 0 or -1 if invalid.
+ */
+static int _qry_idx(FILE *stream, const char *text, index_t *o_index)
+{
+    if(strcmp(text, "last") == 0)
+        *o_index = GPH_LAST;
+
+    else if(sscanf(text, "%hu", o_index) < 1)
+    {
+        _qry_err(stream, "Expected positive integer or \'last\'.");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Reports an invalid vertex index */
+static void _qry_bad(FILE *stream, index_t index)
+{
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+    snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Invalid vertex index (%hu).", index);
+    _qry_err(stream, buf);
+}
+
+/* Reports an invalid flag */
+static void _qry_flg(FILE *stream, const char *flag)
+{
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+    snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Invalid flag (%s).", flag);
+    _qry_err(stream, buf);
+}
+
+/* QUERY: "find", looks for a connection (arch) */
+static int _qry_find(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+    /* Validation */
+    if(argc < 2)
+    {
+        _qry_err(stream, "Missing parameters.");
+        return 0;
+    }
+
+    index_t a = 0u, b = 0u;
+    if(_qry_idx(stream, argv[0u], &a) != 0 || _qry_idx(stream, argv[1u], &b) != 0)
+        return 0;
+
+    /* Operation */
+    const int result = gph_typ(graph, a, b);
+
+    /* Bad A index */
+    if(result == -1 && (a >= graph->_n && a != GPH_LAST))
+        _qry_bad(stream, a);
+
+    /* Bad B index */
+    else if(result == -1 && (b >= graph->_n && b != GPH_LAST))
+        _qry_bad(stream, b);
+
+    /* Valid indexes */
+    else if(result == GPH_ONEWAY)
+        _qry_inf(stream, "One-way connection found (A --> B).");
+
+    else if(result == GPH_TWOWAY)
+        _qry_inf(stream, "Two-way connection found (A <-> B).");
+
+    else
+        _qry_inf(stream, "No connection found.");
+
+    return 0;
+}
+
+/* QUERY: "tell", prints details */
+static int _qry_tell(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+    /* Getting info */
+    size_t oway = 0u, tway = 0u, isol = 0u;
+    gph_cnt(graph, &oway, &tway, &isol);
+
+    /* Just printing info */
+    fprintf(stream, "\tsize:               %zu\n", graph->_n);
+    fprintf(stream, "\t1-way arches:       %zu\n", oway);
+    fprintf(stream, "\t2-way arches:       %zu\n", tway);
+    fprintf(stream, "\tisolated vertices:  %zu\n", isol);
+
+    return 0;
+}
+
+/* QUERY: "list", prints the graph */
+static int _qry_list(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+#define FLAG_TELL       (1 << 0)
+
+    /* Check flags */
+    int settings = 0;
+    for(int i = 0; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-t") == 0)
+            settings |= FLAG_TELL;
+
+        /* Wrong flag */
+        else
+        {
+            _qry_flg(stream, argv[i]);
+            return 0;
+        }
+    }
+
+    /* Printing */
+    gph_out(graph, stream, GPH_SET_SORT_ASC | GPH_SET_MARK_DUAL);
+
+    /* Optional: tell */
+    if(settings & FLAG_TELL)
+        return _qry_tell(graph, stream, NULL, 0);
+
+    return 0;
+
+#undef FLAG_TELL
+}
+
+/* QUERY: "profile", prints degree distribution and graph profile */
+static int _qry_profile(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+    profile_t prf;
+    if(alg_prf(graph, &prf) != 0)
+        return -1;
+
+    /* Just printing info */
+    fprintf(stream, "\tsize:               %zu\n", prf._n);
+    fprintf(stream, "\tarches:             %zu\n", prf._narch);
+    fprintf(stream, "\tself-loops:         %zu\n", prf._loops);
+    fprintf(stream, "\tmean degree:        %.4f\n", prf._mean);
+    fprintf(stream, "\tmax. out-degree:    %zu\n", prf._out_max);
+    fprintf(stream, "\tmax. in-degree:     %zu\n", prf._in_max);
+    fprintf(stream, "\tdensity:            %.6f\n", prf._density);
+    fprintf(stream, "\treciprocity:        %.4f\n", prf._recip);
+    fprintf(stream, "\tmemory (lists):     %zu B\n", prf._mem);
+    fprintf(stream, "\tmemory (matrix):    %zu B\n", prf._mem_mtx);
+
+    /* Histograms, non-empty buckets only */
+    fprintf(stream, "\n\t%-20s%-16s%s\n", "degree", "out", "in");
+    for(size_t b = 0u; b < ALG_PRF_BUCKETS; ++b)
+    {
+        if(prf._out_hist[b] == 0u && prf._in_hist[b] == 0u)
+            continue;
+
+        char range[GLO_MAX_MSG_OUTPUT] = {0, };
+        if(b < 2u)
+            snprintf(range, GLO_MAX_MSG_OUTPUT - 1u, "%zu", b);
+        else
+            snprintf(range, GLO_MAX_MSG_OUTPUT - 1u, "%zu-%zu", (size_t) 1u << (b - 1u), ((size_t) 1u << b) - 1u);
+
+        fprintf(stream, "\t%-20s%-16zu%zu\n", range, prf._out_hist[b], prf._in_hist[b]);
+    }
+
+    return 0;
+}
+
+/* QUERY: "triangles", counts triangles and clustering coefficients */
+static int _qry_triangles(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+#define FLAG_VERBOSE     (1 << 0)
+
+    /* Check flags */
+    int settings = 0;
+    for(int i = 0; i < argc; ++i)
+    {
+        if(strcmp(argv[i], "-v") == 0)
+            settings |= FLAG_VERBOSE;
+
+        /* Wrong flag */
+        else
+        {
+            _qry_flg(stream, argv[i]);
+            return 0;
+        }
+    }
+
+    const size_t n = graph->_n;
+    size_t *tri = NULL, *deg = NULL;
+
+    if((tri = (size_t *) malloc(sizeof(size_t) * (n + 1u))) == NULL ||
+       (deg = (size_t *) malloc(sizeof(size_t) * (n + 1u))) == NULL)
+    {
+        free(tri);
+        return -1;
+    }
+
+    const size_t total = alg_tri(graph, tri, deg);
+    if(total == (size_t) -1)
+    {
+        free(tri);
+        free(deg);
+        return -1;
+    }
+
+    /* Coefficients */
+    double triples = 0.0, local = 0.0;
+    for(size_t i = 0u; i < n; ++i)
+    {
+        const double pairs = (double) deg[i] * ((double) deg[i] - 1.0) / 2.0;
+        const double coeff = (deg[i] > 1u) ? (double) tri[i] / pairs : 0.0;
+
+        triples += (deg[i] > 1u) ? pairs : 0.0;
+        local   += coeff;
+
+        if(settings & FLAG_VERBOSE)
+            fprintf(stream, "%16zu: triangles = %zu, clustering = %.4f\n", i, tri[i], coeff);
+    }
+
+    /* Just printing info */
+    fprintf(stream, "\ttriangles:          %zu\n", total);
+    fprintf(stream, "\ttransitivity:       %.4f\n", (triples > 0.0) ? 3.0 * (double) total / triples : 0.0);
+    fprintf(stream, "\tavg. clustering:    %.4f\n", (n > 0u) ? local / (double) n : 0.0);
+
+    free(tri);
+    free(deg);
+    return 0;
+
+#undef FLAG_VERBOSE
+}
+
+/* QUERY: "path", finds the shortest path from A to B */
+static int _qry_path(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+    /* Validation */
+    if(argc < 2)
+    {
+        _qry_err(stream, "Missing parameters.");
+        return 0;
+    }
+
+    index_t a = 0u, b = 0u;
+    if(_qry_idx(stream, argv[0u], &a) != 0 || _qry_idx(stream, argv[1u], &b) != 0)
+        return 0;
+
+    if(graph->_n > 0u && a == GPH_LAST)
+        a = (index_t) (graph->_n - 1u);
+    if(graph->_n > 0u && b == GPH_LAST)
+        b = (index_t) (graph->_n - 1u);
+
+    if(a >= graph->_n)
+    {
+        _qry_bad(stream, a);
+        return 0;
+    }
+    if(b >= graph->_n)
+    {
+        _qry_bad(stream, b);
+        return 0;
+    }
+
+    index_t *prev = NULL, *path = NULL;
+
+    if((prev = (index_t *) malloc(sizeof(index_t) * graph->_n)) == NULL ||
+       (path = (index_t *) malloc(sizeof(index_t) * graph->_n)) == NULL ||
+       alg_bfs(graph, a, prev, NULL) == (size_t) -1)
+    {
+        free(prev);
+        free(path);
+        return -1;
+    }
+
+    if(prev[b] == GPH_LAST)
+        _qry_inf(stream, "No path found.");
+
+    else
+    {
+        /* Walking back from B */
+        size_t len = 0u;
+        for(index_t v = b; ; v = prev[v])
+        {
+            path[len++] = v;
+            if(v == a)
+                break;
+        }
+
+        fprintf(stream, "\tlength:             %zu\n", len - 1u);
+        fprintf(stream, "\tpath:               ");
+        for(size_t i = len; i > 0u; --i)
+            fprintf(stream, (i > 1u) ? "%hu -> " : "%hu\n", path[i - 1u]);
+    }
+
+    free(prev);
+    free(path);
+    return 0;
+}
+
+/* QUERY: "file", saves the graph to the given file */
+static int _qry_file(const graph_t *graph, FILE *stream, char **argv, int argc)
+{
+    /* Validation */
+    if(argc < 1)
+    {
+        _qry_err(stream, "Missing parameters.");
+        return 0;
+    }
+
+    FILE *file = NULL;
+    if((file = fopen(argv[0u], "w")) == NULL)
+    {
+        char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Could not open the file (%s).", argv[0u]);
+        _qry_err(stream, buf);
+        return 0;
+    }
+
+    gph_out(graph, file, GPH_SET_SORT_ASC);
+
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+    if(fclose(file) != 0)
+    {
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Could not write the file (%s).", argv[0u]);
+        _qry_err(stream, buf);
+        return 0;
+    }
+
+    snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Saved %zu vertex(vertices) to %s.", graph->_n, argv[0u]);
+    _qry_inf(stream, buf);
+    return 0;
+}
+
+/* All the queries */
+static const query_t g_queries[] =
+{
+    {"file",        _qry_file},
+    {"find",        _qry_find},
+    {"list",        _qry_list},
+    {"path",        _qry_path},
+    {"profile",     _qry_profile},
+    {"tell",        _qry_tell},
+    {"triangles",   _qry_triangles},
+};
+
+/* Looks a query up by name, NULL if there is none */
+static const query_t *_qry_get(const char *name)
+{
+    for(size_t i = 0u; i < sizeof(g_queries) / sizeof(g_queries[0u]); ++i)
+        if(strcmp(g_queries[i]._name, name) == 0)
+            return &g_queries[i];
+
+    return NULL;
+}
+
+/* WORKER: runs queued queries, one at a time */
+static void *_qry_work(void *arg)
+{
+    (void) arg;
+
+    while(1)
+    {
+        /* The oldest queued one */
+        pthread_mutex_lock(&g_lock);
+        qry_job_t *job = NULL;
+        while(1)
+        {
+            for(job = g_jobs; job && job->_state != QRY_JOB_QUEUED; job = job->_next)
+                ;
+            if(job)
+                break;
+
+            pthread_cond_wait(&g_cond, &g_lock);
+        }
+        job->_state = QRY_JOB_RUNNING;
+        pthread_mutex_unlock(&g_lock);
+
+        const double t0 = _qry_now();
+        const int ret = job->_query->_fnexe(job->_snap->_graph, job->_out, job->_argv, job->_argc);
+        const double sec = _qry_now() - t0;
+
+        /* Not reading the snapshot anymore */
+        epc_lev(job->_slot);
+
+        pthread_mutex_lock(&g_lock);
+        job->_sec = sec;
+        job->_state = (ret == 0) ? QRY_JOB_DONE : QRY_JOB_FAILED;
+        pthread_mutex_unlock(&g_lock);
+    }
+
+    return NULL;
+}
+
+/* Starts the workers (once).
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _qry_start(void)
+{
+    if(g_started)
+        return 0;
+
+    for(size_t i = 0u; i < QRY_WORKERS; ++i)
+    {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, _qry_work, NULL) != 0)
+            return (i > 0u) ? 0 : -1;
+
+        pthread_detach(thread);
+    }
+
+    g_started = 1;
+    return 0;
+}
+
+/* Publishes a snapshot of the graph if it has changed.
+ *
+ *  graph       - the graph
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _qry_pub(const graph_t *graph)
+{
+    /* Any change gives some vertex a new stamp (but deleting an unreferenced last one) */
+    if(g_src == graph && g_src_n == graph->_n && g_src_stamp == gph_stp())
+        return 0;
+
+    graph_t *copy = NULL;
+    if((copy = gph_cpy(graph)) == NULL)
+        return -1;
+
+    if(epc_pub(copy) != 0)
+    {
+        gph_fre(copy);
+        return -1;
+    }
+
+    g_src = graph;
+    g_src_n = graph->_n;
+    g_src_stamp = gph_stp();
+    return 0;
+}
+
+/* Runs a query straight away. Results go to the
+ * stream, so do errors (to stderr if it is stdout).
+ *
+ *  graph       - the graph
+ *  stream      - output stream
+ *  name        - the query ("find", "tell", ...)
+ *  argv        - its arguments
+ *  argc        - their #
+ *
+ * Returns appropiate QRY_RET_* value.
+ */
+int qry_run(const graph_t *graph, FILE *stream, const char *name, char **argv, int argc)
+{
+    assert(graph && stream && name);
+
+    const query_t *query = NULL;
+    if((query = _qry_get(name)) == NULL)
+        return QRY_RET_UNKNOWN;
+
+    return (query->_fnexe(graph, stream, argv, argc) == 0) ? QRY_RET_SUCCESS : QRY_RET_ERROR;
+}
+
+/* Queues a query. A new snapshot is published
+ * first if the graph has changed since the last one.
+ *
+ *  graph       - the graph
+ *  argv        - the query with its arguments ("list", "-t")
+ *  argc        - # of words
+ *  o_id        - OUT, # of the query
+ *
+ * Returns appropiate QRY_RET_* value.
+ */
+int qry_sub(const graph_t *graph, char **argv, int argc, int *o_id)
+{
+    assert(graph && argv && argc > 0 && o_id);
+
+    const query_t *query = NULL;
+    if((query = _qry_get(argv[0u])) == NULL)
+        return QRY_RET_UNKNOWN;
+
+    qry_job_t *job = NULL;
+    if((job = (qry_job_t *) calloc(1u, sizeof(qry_job_t))) == NULL)
+        return QRY_RET_ERROR;
+
+    /* Arguments, kept along with the job (words over QRY_MAX_ARGS are ignored) */
+    size_t off = 0u, len = 0u;
+    for(int i = 0; i < argc && i <= (int) QRY_MAX_ARGS; ++i)
+    {
+        const size_t n = strlen(argv[i]);
+        if(off + n + 1u > GLO_MAX_USER_INPUT || len + n + 2u > GLO_MAX_USER_INPUT)
+            break;
+
+        len += (size_t) snprintf(job->_line + len, GLO_MAX_USER_INPUT - len, (i > 0) ? " %s" : "%s", argv[i]);
+        if(i > 0)
+        {
+            memcpy(job->_args + off, argv[i], n + 1u);
+            job->_argv[job->_argc++] = job->_args + off;
+        }
+        off += n + 1u;
+    }
+
+    if(_qry_start() != 0 || _qry_pub(graph) != 0 || (job->_out = tmpfile()) == NULL)
+    {
+        free(job);
+        return QRY_RET_ERROR;
+    }
+
+    /* The snapshot stays until the query is done */
+    if((job->_slot = epc_ent(&job->_snap)) < 0)
+    {
+        fclose(job->_out);
+        free(job);
+        return QRY_RET_BUSY;
+    }
+
+    job->_query = query;
+    job->_state = QRY_JOB_QUEUED;
+
+    pthread_mutex_lock(&g_lock);
+    job->_id = ++g_nid;
+    *o_id = job->_id;
+
+    qry_job_t **link = &g_jobs;
+    while(*link)
+        link = &(*link)->_next;
+    *link = job;
+
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+
+    return QRY_RET_SUCCESS;
+}
+
+/* Prints results of finished queries (in order)
+ * and frees snapshots no query needs anymore.
+ * To be called by the thread editing the graph.
+ */
+void qry_rev(void)
+{
+    /* Taking finished ones out of the list */
+    qry_job_t *done = NULL, **tail = &done;
+
+    pthread_mutex_lock(&g_lock);
+    qry_job_t **link = &g_jobs;
+    while(*link)
+    {
+        qry_job_t *job = *link;
+        if(job->_state == QRY_JOB_DONE || job->_state == QRY_JOB_FAILED)
+        {
+            *link = job->_next;
+            job->_next = NULL;
+            *tail = job;
+            tail = &job->_next;
+        }
+        else
+            link = &job->_next;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if(done == NULL)
+        return;
+
+    while(done)
+    {
+        qry_job_t *job = done;
+        done = job->_next;
+
+        char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+        if(job->_state == QRY_JOB_FAILED)
+        {
+            snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Query #%d (%s) ran out of memory.", job->_id, job->_line);
+            msc_err(buf);
+        }
+        else
+        {
+            snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Query #%d (%s) done in %.3f ms (snapshot #%llu).",
+                     job->_id, job->_line, job->_sec * 1e3, (unsigned long long) job->_snap->_id);
+            msc_inf(buf);
+
+            /* Results */
+            char chunk[4096];
+            size_t n = 0u;
+            rewind(job->_out);
+            while((n = fread(chunk, 1u, sizeof(chunk), job->_out)) > 0u)
+                fwrite(chunk, 1u, n, stdout);
+        }
+
+        fclose(job->_out);
+        free(job);
+    }
+
+    epc_rcl();
+}
+
+/* Lists queued and running queries.
+ *
+ *  stream      - output stream
+ *
+ * Returns # of listed queries.
+ */
+size_t qry_lst(FILE *stream)
+{
+    size_t n = 0u;
+
+    pthread_mutex_lock(&g_lock);
+    for(const qry_job_t *job = g_jobs; job; job = job->_next, ++n)
+    {
+        const char *state = (job->_state == QRY_JOB_QUEUED)  ? "queued"  :
+                            (job->_state == QRY_JOB_RUNNING) ? "running" : "done";
+
+        fprintf(stream, "\t#%-6d%-10ssnapshot #%-8llu%s\n", job->_id, state,
+                (unsigned long long) job->_snap->_id, job->_line);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    return n;
+}
@@ -0,0 +1,74 @@
+/*
+ *  query.h
+ *
+ *  Read-only commands (queries): find, tell, list,
+ *  profile, triangles, path and file. They can be
+ *  run straight away on any graph or queued to
+ *  worker threads, which run them on a snapshot of
+ *  the graph (see "epoch.h") taken at the moment of
+ *  queuing, so the graph can be edited meanwhile.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_QUERY_H_FILE_
+#define _GRAPH_QUERY_H_FILE_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "graph.h"
+
+#define QRY_WORKERS             4u      /* # of worker threads */
+#define QRY_MAX_ARGS            16u     /* Max. # of words of a queued query */
+
+#define QRY_RET_ERROR           -1      /* Critical memory error */
+#define QRY_RET_SUCCESS         0       /* Query run (or queued) */
+#define QRY_RET_UNKNOWN         1       /* Not a query */
+#define QRY_RET_BUSY            2       /* Too many queries running, not queued */
+
+
+/* Runs a query straight away. Results go to the
+ * stream, so do errors (to stderr if it is stdout).
+ *
+ *  graph       - the graph
+ *  stream      - output stream
+ *  name        - the query ("find", "tell", ...)
+ *  argv        - its arguments
+ *  argc        - their #
+ *
+ * Returns appropiate QRY_RET_* value.
+ */
+int             qry_run(const graph_t *graph, FILE *stream, const char *name, char **argv, int argc);
+
+/* Queues a query. A new snapshot is published
+ * first if the graph has changed since the last one.
+ *
+ *  graph       - the graph
+ *  argv        - the query with its arguments ("list", "-t")
+ *  argc        - # of words
+ *  o_id        - OUT, # of the query
+ *
+ * Returns appropiate QRY_RET_* value.
+ */
+int             qry_sub(const graph_t *graph, char **argv, int argc, int *o_id);
+
+/* Prints results of finished queries (in order)
+ * and frees snapshots no query needs anymore.
+ * To be called by the thread editing the graph.
+ */
+void            qry_rev(void);
+
+/* Lists queued and running queries.
+ *
+ *  stream      - output stream
+ *
+ * Returns # of listed queries.
+ */
+size_t          qry_lst(FILE *stream);
+
+#endif /* _GRAPH_QUERY_H_FILE_ */
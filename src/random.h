@@ -0,0 +1,87 @@
+/*
+ *  random.h
+ *
+ *  Fast, seeded pseudo-random number
+ *  generator (xoshiro256**). Same seed
+ *  gives the same sequence on every platform.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_RANDOM_H_FILE_
+#define _GRAPH_RANDOM_H_FILE_
+
+#include <assert.h>
+#include <stdint.h>
+
+/* Generator state */
+typedef struct _gph_rnd_t
+{
+    uint64_t    _s[4];          /* The state, never all 0 */
+
+} rnd_t;
+
+
+/* Rotates left */
+static inline uint64_t _rnd_rol(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* Seeds the generator (splitmix64 expansion).
+ *
+ *  rnd         - the generator
+ *  seed        - any value
+ */
+static inline void rnd_ini(rnd_t *rnd, uint64_t seed)
+{
+    assert(rnd);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        rnd->_s[i] = z ^ (z >> 31);
+    }
+}
+
+/* Gives next 64 random bits.
+ *
+ *  rnd         - the generator
+ */
+static inline uint64_t rnd_u64(rnd_t *rnd)
+{
+    const uint64_t result = _rnd_rol(rnd->_s[1] * 5u, 7) * 9u;
+    const uint64_t t = rnd->_s[1] << 17;
+
+    rnd->_s[2] ^= rnd->_s[0];
+    rnd->_s[3] ^= rnd->_s[1];
+    rnd->_s[1] ^= rnd->_s[2];
+    rnd->_s[0] ^= rnd->_s[3];
+    rnd->_s[2] ^= t;
+    rnd->_s[3]  = _rnd_rol(rnd->_s[3], 45);
+
+    return result;
+}
+
+/* Gives random number from [0, n), n must fit in 32 bits.
+ *
+ *  rnd         - the generator
+ *  n           - the bound
+ */
+static inline uint32_t rnd_bnd(rnd_t *rnd, uint32_t n)
+{
+    return (uint32_t) (((rnd_u64(rnd) >> 32) * (uint64_t) n) >> 32);
+}
+
+/* Gives random number from [0, 1).
+ *
+ *  rnd         - the generator
+ */
+static inline double rnd_dbl(rnd_t *rnd)
+{
+    return (double) (rnd_u64(rnd) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif /* _GRAPH_RANDOM_H_FILE_ */
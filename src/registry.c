@@ -0,0 +1,126 @@
+/*
+ *  registry.c
+ *
+ *  Extends "registry.h".
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include "registry.h"
+
+/* A named graph */
+typedef struct _reg_entry_t
+{
+    char        _name[REG_MAX_NAME];
+    graph_t    *_graph;
+
+} reg_entry_t;
+
+
+/* GRAPHS */
+static reg_entry_t g_entries[REG_MAX_GRAPHS];
+static size_t g_nentries = 0u;
+
+
+/* Tells if a name can be used.
+ *
+ *  name        - the name
+ *
+ * Returns 1 if it can, 0 otherwise.
+ */
+int reg_nam(const char *name)
+{
+    assert(name);
+
+    const size_t len = strlen(name);
+    if(len == 0u || len >= REG_MAX_NAME)
+        return 0;
+
+    for(const char *c = name; *c; ++c)
+    {
+        if(! isalnum((unsigned char) *c) && *c != '_' && *c != '-')
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Registers a graph under a new name.
+ *
+ *  name        - the name
+ *  graph       - the graph (taken over if registered)
+ *
+ * Returns appropiate REG_RET_* value.
+ */
+int reg_add(const char *name, graph_t *graph)
+{
+    assert(name && graph);
+
+    if(! reg_nam(name))
+        return REG_RET_INVALID;
+    if(reg_get(name))
+        return REG_RET_EXISTS;
+    if(g_nentries == REG_MAX_GRAPHS)
+        return REG_RET_FULL;
+
+    reg_entry_t *e = &g_entries[g_nentries++];
+    strcpy(e->_name, name);
+    e->_graph = graph;
+
+    return REG_RET_SUCCESS;
+}
+
+/* Finds a graph.
+ *
+ *  name        - its name
+ *
+ * Returns a pointer to the registered graph or
+ * NULL if there is none.
+ */
+graph_t **reg_get(const char *name)
+{
+    assert(name);
+
+    for(size_t i = 0u; i < g_nentries; ++i)
+    {
+        if(strcmp(g_entries[i]._name, name) == 0)
+            return &g_entries[i]._graph;
+    }
+
+    return NULL;
+}
+
+/* Lists the graphs with their sizes.
+ *
+ *  stream      - output stream
+ *  cur         - name of the graph in use (marked), can be NULL
+ *
+ * Returns # of graphs.
+ */
+size_t reg_out(FILE *stream, const char *cur)
+{
+    assert(stream);
+
+    for(size_t i = 0u; i < g_nentries; ++i)
+    {
+        const graph_t *g = g_entries[i]._graph;
+
+        size_t narch = 0u;
+        for(size_t j = 0u; j < g->_n; ++j)
+            narch += g->_list[j]->_narch;
+
+        const int used = (cur && strcmp(cur, g_entries[i]._name) == 0);
+        const int shared = (g->_arefs && __atomic_load_n(g->_arefs, __ATOMIC_ACQUIRE) > 1u);
+
+        fprintf(stream, "%c %-*s vertices = %-8zu arches = %-10zu%s\n", used ? '*' : ' ', (int) REG_MAX_NAME,
+                g_entries[i]._name, g->_n, narch, shared ? " (shares lists)" : "");
+    }
+
+    return g_nentries;
+}
+
+/* Forgets all the graphs (they are not freed) */
+void reg_clr(void)
+{
+    g_nentries = 0u;
+}
@@ -0,0 +1,76 @@
+/*
+ *  registry.h
+ *
+ *  Named graphs of a session. The registry owns
+ *  the graphs, the interpreter works on one of
+ *  them at a time (see "use" and "clone" commands).
+ *  Clones share lists with the original (gph_cln()).
+ *  In server mode it holds the current versions,
+ *  guarded by the server (see "server.h").
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_REGISTRY_H_FILE_
+#define _GRAPH_REGISTRY_H_FILE_
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graph.h"
+
+#define REG_MAX_GRAPHS          32u     /* Max. # of graphs */
+#define REG_MAX_NAME            32u     /* Max. length of a name (with '\0') */
+#define REG_DEF_NAME            "main"  /* Name of the graph a session starts with */
+
+#define REG_RET_ERROR           -1      /* Critical memory error */
+#define REG_RET_SUCCESS         0       /* Done */
+#define REG_RET_INVALID         1       /* Invalid name */
+#define REG_RET_FULL            2       /* Too many graphs */
+#define REG_RET_EXISTS          3       /* Name already taken */
+
+
+/* Tells if a name can be used (up to REG_MAX_NAME - 1
+ * letters, digits, '_' or '-').
+ *
+ *  name        - the name
+ *
+ * Returns 1 if it can, 0 otherwise.
+ */
+int             reg_nam(const char *name);
+
+/* Registers a graph under a new name.
+ *
+ *  name        - the name
+ *  graph       - the graph (taken over if registered)
+ *
+ * Returns appropiate REG_RET_* value.
+ */
+int             reg_add(const char *name, graph_t *graph);
+
+/* Finds a graph.
+ *
+ *  name        - its name
+ *
+ * Returns a pointer to the registered graph (it can
+ * be replaced through it) or NULL if there is none.
+ */
+graph_t       **reg_get(const char *name);
+
+/* Lists the graphs with their sizes.
+ *
+ *  stream      - output stream
+ *  cur         - name of the graph in use (marked), can be NULL
+ *
+ * Returns # of graphs.
+ */
+size_t          reg_out(FILE *stream, const char *cur);
+
+/* Forgets all the graphs (they are not freed) */
+void            reg_clr(void);
+
+#endif /* _GRAPH_REGISTRY_H_FILE_ */
@@ -0,0 +1,1012 @@
+/*
+ *  server.c
+ *
+ *  Extends "server.h".
+ *
+ *  The main thread waits (poll) on the listening
+ *  socket and on idle connections. A connection with
+ *  data is handed to a worker, which runs all the
+ *  complete lines, sends the responses at once and
+ *  gives the connection back through a pipe, which
+ *  also wakes the main thread up on signals.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#include "server.h"
+
+#ifdef _WIN32
+
+#include "misc.h"
+
+int srv_run(const char *path, size_t nworkers)
+{
+    msc_err("Server mode is not supported on Windows.");
+    return -1;
+}
+
+#else
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "edit.h"
+#include "generate.h"
+#include "misc.h"
+#include "query.h"
+#include "registry.h"
+
+#define SRV_MAX_ARGS            (QRY_MAX_ARGS + 1u)     /* Max. # of words of a command */
+
+
+/* A version of a graph, freed when nobody uses it */
+typedef struct _srv_ver_t
+{
+    graph_t    *_graph;
+    size_t      _refs;                  /* Current + readers (under g_lock) */
+
+} srv_ver_t;
+
+/* A named graph (the registry holds its current version) */
+typedef struct _srv_graph_t
+{
+    char                _name[REG_MAX_NAME];
+    graph_t           **_slot;          /* Registry slot (under g_lock) */
+    srv_ver_t          *_cur;           /* Current version (under g_lock) */
+    pthread_mutex_t     _edit;          /* Serialises editors */
+
+} srv_graph_t;
+
+/* A client */
+typedef struct _srv_conn_t
+{
+    int                 _fd;
+    srv_graph_t        *_graph;         /* Graph in use */
+    char                _in[SRV_MAX_LINE];
+    size_t              _nin;           /* # of buffered chars (no full line) */
+    int                 _skip;          /* 1 - skipping a too long line */
+
+    struct _srv_conn_t *_next;
+
+} srv_conn_t;
+
+
+/* GRAPHS (never removed, so pointers stay valid), in registry order */
+static srv_graph_t g_graphs[REG_MAX_GRAPHS];
+static size_t g_ngraphs = 0u;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;     /* Also guards the registry */
+
+/* CONNECTIONS: to be served, served (to be given back) */
+static srv_conn_t *g_todo = NULL, *g_todo_last = NULL;
+static srv_conn_t *g_done = NULL;
+static pthread_mutex_t g_conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_conn_cond = PTHREAD_COND_INITIALIZER;
+
+static int g_wake[2] = {-1, -1};
+static volatile sig_atomic_t g_sig = 0;     /* Set by signals, read by the main thread */
+static int g_stop = 0;                      /* Tells workers to end (under g_conn_lock) */
+
+
+/* Stops the server (signal handler) */
+static void _srv_sig(int sig)
+{
+    const int err = errno;
+
+    /* If the pipe is full, the main thread is woken up anyway */
+    g_sig = 1;
+    const ssize_t r = write(g_wake[1u], "s", 1u);
+    (void) r;
+
+    errno = err;
+}
+
+/* Wakes the main thread up */
+static void _srv_wak(void)
+{
+    const ssize_t r = write(g_wake[1u], "w", 1u);
+    (void) r;
+}
+
+/* Gives up a version */
+static void _srv_rel(srv_ver_t *v)
+{
+    pthread_mutex_lock(&g_lock);
+    const size_t refs = --(v->_refs);
+    pthread_mutex_unlock(&g_lock);
+
+    if(refs == 0u)
+    {
+        gph_fre(v->_graph);
+        free(v);
+    }
+}
+
+/* Takes the current version of a graph (to be given up with _srv_rel()) */
+static srv_ver_t *_srv_acq(srv_graph_t *graph)
+{
+    pthread_mutex_lock(&g_lock);
+    srv_ver_t *v = graph->_cur;
+    ++(v->_refs);
+    pthread_mutex_unlock(&g_lock);
+
+    return v;
+}
+
+/* Makes a graph the current version.
+ *
+ *  graph       - the named graph
+ *  g           - new version (taken over)
+ *
+ * Returns 0 or -1 if failed (g is freed).
+ */
+static int _srv_pub(srv_graph_t *graph, graph_t *g)
+{
+    srv_ver_t *v = NULL;
+    if((v = (srv_ver_t *) malloc(sizeof(srv_ver_t))) == NULL)
+    {
+        gph_fre(g);
+        return -1;
+    }
+
+    v->_graph = g;
+    v->_refs = 1u;
+
+    pthread_mutex_lock(&g_lock);
+    srv_ver_t *old = graph->_cur;
+    graph->_cur = v;
+    *(graph->_slot) = g;
+    pthread_mutex_unlock(&g_lock);
+
+    if(old)
+        _srv_rel(old);
+
+    return 0;
+}
+
+/* Finds a graph by name (under g_lock).
+ *
+ *  name        - the name
+ *
+ * Returns NULL if there is none.
+ */
+static srv_graph_t *_srv_fnd(const char *name)
+{
+    graph_t **slot = reg_get(name);
+
+    for(size_t i = 0u; slot && i < g_ngraphs; ++i)
+    {
+        if(g_graphs[i]._slot == slot)
+            return &g_graphs[i];
+    }
+
+    return NULL;
+}
+
+/* Registers a new graph (under g_lock).
+ *
+ *  name        - its name
+ *  g           - the graph (taken over if registered)
+ *  o_graph     - OUT, the named graph
+ *
+ * Returns appropiate REG_RET_* value.
+ */
+static int _srv_add(const char *name, graph_t *g, srv_graph_t **o_graph)
+{
+    srv_ver_t *v = NULL;
+    if((v = (srv_ver_t *) malloc(sizeof(srv_ver_t))) == NULL)
+        return REG_RET_ERROR;
+
+    const int r = reg_add(name, g);
+    if(r != REG_RET_SUCCESS)
+    {
+        free(v);
+        return r;
+    }
+
+    v->_graph = g;
+    v->_refs = 1u;
+
+    srv_graph_t *graph = &g_graphs[g_ngraphs++];
+    snprintf(graph->_name, REG_MAX_NAME, "%s", name);
+    graph->_slot = reg_get(name);
+    graph->_cur = v;
+    pthread_mutex_init(&graph->_edit, NULL);
+
+    *o_graph = graph;
+    return REG_RET_SUCCESS;
+}
+
+/* Finds a graph by name, new (empty) one is made if there
+ * is none.
+ *
+ *  name        - the name
+ *
+ * Returns NULL if failed (too many or out of memory).
+ */
+static srv_graph_t *_srv_get(const char *name)
+{
+    pthread_mutex_lock(&g_lock);
+
+    srv_graph_t *graph = _srv_fnd(name);
+    graph_t *g = NULL;
+
+    if(graph == NULL && (g = gph_new(GLO_DEF_GRAPH_SIZE)) != NULL && _srv_add(name, g, &graph) != REG_RET_SUCCESS)
+        gph_fre(g);
+
+    pthread_mutex_unlock(&g_lock);
+    return graph;
+}
+
+/* Ends a response */
+static void _srv_end(FILE *out)
+{
+    fputs(".\n", out);
+}
+
+/* Responds with an error */
+static void _srv_err(FILE *out, const char *msg)
+{
+    fprintf(out, "E: %s\n", msg);
+    _srv_end(out);
+}
+
+/* Responds with an info */
+static void _srv_inf(FILE *out, const char *msg)
+{
+    fprintf(out, "I: %s\n", msg);
+    _srv_end(out);
+}
+
+/* Runs edit commands (one after another) on the graph in use.
+ * They are applied at once, unless one of them is invalid -
+ * then the ones before it are, as if run one by one.
+ *
+ *  conn        - the client
+ *  line        - the commands
+ *  n           - their #
+ *  out         - responses
+ */
+static void _srv_edt(srv_conn_t *conn, char **line, size_t n, FILE *out)
+{
+    srv_graph_t *graph = conn->_graph;
+    size_t from = 0u;
+
+    while(from < n)
+    {
+        batch_t *batch = NULL;
+        if((batch = edt_new()) == NULL)
+            break;
+
+        for(size_t i = from; i < n; ++i)
+        {
+            if(edt_prs(batch, line[i]) != EDT_PRS_EDIT)
+                break;
+        }
+
+        /* Applied on a copy, which replaces the graph */
+        pthread_mutex_lock(&graph->_edit);
+        srv_ver_t *v = _srv_acq(graph);
+
+        edt_sum_t sum;
+        size_t bad = 0u, done = 0u;
+        int why = EDT_BAD_NONE;
+        int nomem = (batch->_n < n - from);
+        graph_t *g = nomem ? NULL : edt_apl(v->_graph, batch, &sum, &bad, &why);
+
+        if(g)
+            done = batch->_n;
+        else if(nomem || bad == batch->_n)
+            nomem = 1;
+
+        /* The ones before the invalid one */
+        else if(bad > 0u)
+        {
+            batch->_n = bad;
+            if((g = edt_apl(v->_graph, batch, &sum, &bad, NULL)) != NULL)
+                done = batch->_n;
+            else
+                nomem = 1;
+        }
+
+        if(g && _srv_pub(graph, g) != 0)
+            nomem = 1;
+
+        _srv_rel(v);
+        pthread_mutex_unlock(&graph->_edit);
+
+        if(nomem)
+        {
+            edt_fre(batch);
+            break;
+        }
+
+        /* One response per edit (cut, so no "more" line is added) */
+        for(size_t i = 0u; i < done; ++i)
+        {
+            batch->_n = i + 1u;
+            fputs("I: ", out);
+            edt_out(batch, out, i, 1u);
+            _srv_end(out);
+        }
+
+        from += done;
+        if(from < n)
+        {
+            _srv_err(out, edt_why(why));
+            ++from;
+        }
+
+        edt_fre(batch);
+    }
+
+    /* Out of memory, the rest is not run */
+    for(; from < n; ++from)
+        _srv_err(out, "Not enough memory.");
+}
+
+/* Runs "gen" command on the graph in use */
+static void _srv_gen(srv_conn_t *conn, char **argv, int argc, FILE *out)
+{
+    gen_spec_t spec;
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+
+    if(gen_prs(argv, argc, &spec, buf) != 0)
+    {
+        _srv_err(out, buf);
+        return;
+    }
+
+    graph_t *g = NULL;
+    if((g = gen_run(&spec)) == NULL)
+    {
+        _srv_err(out, "Not enough memory.");
+        return;
+    }
+
+    size_t narch = 0u;
+    for(size_t i = 0u; i < g->_n; ++i)
+        narch += g->_list[i]->_narch;
+
+    snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Generated graph (vertices = %zu, arches = %zu, seed = %llu).", g->_n, narch,
+             (unsigned long long) spec._seed);
+
+    pthread_mutex_lock(&conn->_graph->_edit);
+    const int r = _srv_pub(conn->_graph, g);
+    pthread_mutex_unlock(&conn->_graph->_edit);
+
+    if(r != 0)
+        _srv_err(out, "Not enough memory.");
+    else
+        _srv_inf(out, buf);
+}
+
+/* Runs "use" command */
+static void _srv_use(srv_conn_t *conn, char **argv, int argc, FILE *out)
+{
+    if(argc != 1)
+    {
+        _srv_err(out, "Expected <name>.");
+        return;
+    }
+
+    const char *name = argv[0u];
+    if(! reg_nam(name))
+    {
+        _srv_err(out, "Invalid name (up to 31 letters, digits, '_' or '-').");
+        return;
+    }
+
+    srv_graph_t *graph = NULL;
+    if((graph = _srv_get(name)) == NULL)
+    {
+        _srv_err(out, "Too many graphs.");
+        return;
+    }
+
+    conn->_graph = graph;
+
+    srv_ver_t *v = _srv_acq(graph);
+    fprintf(out, "I: Using graph \'%s\' (vertices = %zu).\n", graph->_name, v->_graph->_n);
+    _srv_end(out);
+    _srv_rel(v);
+}
+
+/* Runs "clone" command: the graph in use is cloned under a new name */
+static void _srv_cln(srv_conn_t *conn, char **argv, int argc, FILE *out)
+{
+    if(argc != 1)
+    {
+        _srv_err(out, "Expected <name>.");
+        return;
+    }
+
+    const char *name = argv[0u];
+    if(! reg_nam(name))
+    {
+        _srv_err(out, "Invalid name (up to 31 letters, digits, '_' or '-').");
+        return;
+    }
+
+    /* The published version is only read, clients go on meanwhile */
+    srv_ver_t *v = _srv_acq(conn->_graph);
+    graph_t *g = gph_shr(v->_graph);
+    _srv_rel(v);
+
+    if(g == NULL)
+    {
+        _srv_err(out, "Not enough memory.");
+        return;
+    }
+
+    srv_graph_t *graph = NULL;
+    pthread_mutex_lock(&g_lock);
+    const int r = _srv_add(name, g, &graph);
+    pthread_mutex_unlock(&g_lock);
+
+    char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+    if(r == REG_RET_SUCCESS)
+    {
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Cloned '%s' as '%s' (vertices = %zu).", conn->_graph->_name, name, g->_n);
+        _srv_inf(out, buf);
+        return;
+    }
+
+    gph_fre(g);
+    if(r == REG_RET_EXISTS)
+    {
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Graph already exists (%s).", name);
+        _srv_err(out, buf);
+    }
+    else
+        _srv_err(out, (r == REG_RET_FULL) ? "Too many graphs." : "Not enough memory.");
+}
+
+/* Runs "graphs" command */
+static void _srv_lst(srv_conn_t *conn, FILE *out)
+{
+    /* Current versions, none is freed meanwhile */
+    pthread_mutex_lock(&g_lock);
+    reg_out(out, conn->_graph->_name);
+    pthread_mutex_unlock(&g_lock);
+
+    _srv_end(out);
+}
+
+/* Runs a command that is not an edit.
+ *
+ *  conn        - the client
+ *  line        - the command
+ *  invalid     - 1 if it is a malformed edit
+ *  out         - responses
+ *
+ * Returns 1 if the client is leaving, 0 otherwise.
+ */
+static int _srv_cmd(srv_conn_t *conn, char *line, int invalid, FILE *out)
+{
+    /* Words */
+    char *argv[SRV_MAX_ARGS];
+    int argc = 0;
+
+    for(char *c = line; *c; )
+    {
+        while(*c && isspace((unsigned char) *c))
+            *c++ = '\0';
+        if(*c == '\0')
+            break;
+
+        if(argc == (int) SRV_MAX_ARGS)
+        {
+            _srv_err(out, "Too many words.");
+            return 0;
+        }
+
+        argv[argc++] = c;
+        while(*c && ! isspace((unsigned char) *c))
+            ++c;
+    }
+
+    if(argc == 0)
+        return 0;
+
+    if(invalid)
+        _srv_err(out, "Malformed edit command. Check \'help\'.");
+
+    else if(strcmp(argv[0u], "exit") == 0 || strcmp(argv[0u], "quit") == 0 || strcmp(argv[0u], "q") == 0)
+    {
+        _srv_inf(out, "Bye.");
+        return 1;
+    }
+
+    else if(strcmp(argv[0u], "use") == 0)
+        _srv_use(conn, argv + 1, argc - 1, out);
+
+    else if(strcmp(argv[0u], "graphs") == 0)
+        _srv_lst(conn, out);
+
+    else if(strcmp(argv[0u], "clone") == 0)
+        _srv_cln(conn, argv + 1, argc - 1, out);
+
+    else if(strcmp(argv[0u], "gen") == 0)
+        _srv_gen(conn, argv + 1, argc - 1, out);
+
+    else if(strcmp(argv[0u], "help") == 0)
+    {
+        fprintf(out, "add arch del set size new gen - edit the graph in use (no confirmation)\n");
+        fprintf(out, "file find list path profile tell triangles - read-only commands\n");
+        fprintf(out, "use <name> - switches to the graph, clone <name> - copies it, graphs - lists them\n");
+        fprintf(out, "exit - disconnects\n");
+        _srv_end(out);
+    }
+
+    /* Read-only: on the current version, no locking */
+    else
+    {
+        srv_ver_t *v = _srv_acq(conn->_graph);
+        const int r = qry_run(v->_graph, out, argv[0u], argv + 1, argc - 1);
+        _srv_rel(v);
+
+        if(r == QRY_RET_UNKNOWN)
+            _srv_err(out, "Unknown command. Check \'help\'.");
+        else if(r == QRY_RET_ERROR)
+            _srv_err(out, "Not enough memory.");
+        else
+            _srv_end(out);
+    }
+
+    return 0;
+}
+
+/* Runs complete lines.
+ *
+ *  conn        - the client
+ *  line        - the lines ('\0' ended)
+ *  n           - their #
+ *  out         - responses
+ *
+ * Returns 1 if the client is leaving, 0 otherwise.
+ */
+static int _srv_exe(srv_conn_t *conn, char **line, size_t n, FILE *out)
+{
+    batch_t *probe = NULL;
+    if((probe = edt_new()) == NULL)
+        return 1;
+
+    for(size_t i = 0u; i < n; )
+    {
+        /* Edits one after another go together */
+        size_t j = i;
+        int r = EDT_PRS_OTHER;
+
+        while(j < n && (r = edt_prs(probe, line[j])) == EDT_PRS_EDIT)
+            ++j;
+
+        probe->_n = probe->_npool = 0u;
+
+        if(j > i)
+        {
+            _srv_edt(conn, line + i, j - i, out);
+            i = j;
+            continue;
+        }
+
+        if(r == EDT_PRS_ERROR)
+        {
+            _srv_err(out, "Not enough memory.");
+            ++i;
+        }
+        else if(_srv_cmd(conn, line[i++], r == EDT_PRS_INVALID, out) != 0)
+        {
+            edt_fre(probe);
+            return 1;
+        }
+    }
+
+    edt_fre(probe);
+    return 0;
+}
+
+/* Sends the whole buffer.
+ *
+ * Returns 0 or -1 if failed.
+ */
+static int _srv_snd(int fd, const char *buf, size_t len)
+{
+    while(len > 0u)
+    {
+        const ssize_t r = send(fd, buf, len, MSG_NOSIGNAL);
+        if(r < 0 && errno == EINTR)
+            continue;
+        if(r <= 0)
+            return -1;
+
+        buf += r;
+        len -= (size_t) r;
+    }
+
+    return 0;
+}
+
+/* Serves a client that has sent something.
+ *
+ *  conn        - the client
+ *
+ * Returns 1 if the connection is to be closed, 0 otherwise.
+ */
+static int _srv_srv(srv_conn_t *conn)
+{
+    const ssize_t r = recv(conn->_fd, conn->_in + conn->_nin, SRV_MAX_LINE - conn->_nin, 0);
+    if(r < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    if(r <= 0)
+        return 1;
+
+    conn->_nin += (size_t) r;
+
+    char *buf = NULL;
+    size_t len = 0u;
+    FILE *out = NULL;
+    if((out = open_memstream(&buf, &len)) == NULL)
+        return 1;
+
+    /* Complete lines */
+    char *line[SRV_MAX_LINE];
+    size_t n = 0u, start = 0u;
+    int leave = 0;
+
+    for(size_t i = 0u; i < conn->_nin; ++i)
+    {
+        if(conn->_in[i] != '\n')
+            continue;
+
+        conn->_in[i] = '\0';
+        if(i > start && conn->_in[i - 1u] == '\r')
+            conn->_in[i - 1u] = '\0';
+
+        if(conn->_skip)
+            conn->_skip = 0;
+        else
+            line[n++] = conn->_in + start;
+
+        start = i + 1u;
+    }
+
+    leave = _srv_exe(conn, line, n, out);
+
+    /* The rest waits for its end */
+    conn->_nin -= start;
+    memmove(conn->_in, conn->_in + start, conn->_nin);
+
+    if(conn->_nin == SRV_MAX_LINE)
+    {
+        if(! conn->_skip)
+            _srv_err(out, "Line too long.");
+
+        conn->_skip = 1;
+        conn->_nin = 0u;
+    }
+
+    fclose(out);
+    if(_srv_snd(conn->_fd, buf, len) != 0)
+        leave = 1;
+
+    free(buf);
+    return leave;
+}
+
+/* Worker thread */
+static void *_srv_wrk(void *arg)
+{
+    while(1)
+    {
+        pthread_mutex_lock(&g_conn_lock);
+        while(g_todo == NULL && ! g_stop)
+            pthread_cond_wait(&g_conn_cond, &g_conn_lock);
+
+        srv_conn_t *conn = g_todo;
+        if(conn == NULL)
+        {
+            pthread_mutex_unlock(&g_conn_lock);
+            break;
+        }
+
+        if((g_todo = conn->_next) == NULL)
+            g_todo_last = NULL;
+        pthread_mutex_unlock(&g_conn_lock);
+
+        /* A closed one is given back too, so it is no longer counted */
+        if(_srv_srv(conn) != 0)
+        {
+            close(conn->_fd);
+            conn->_fd = -1;
+        }
+
+        pthread_mutex_lock(&g_conn_lock);
+        conn->_next = g_done;
+        g_done = conn;
+        pthread_mutex_unlock(&g_conn_lock);
+
+        _srv_wak();
+    }
+
+    return NULL;
+}
+
+/* Serves clients till SIGINT or SIGTERM.
+ *
+ *  path        - socket path (an old socket there is removed)
+ *  nworkers    - # of worker threads, 0 - default
+ *
+ * Returns 0 or -1 if failed.
+ */
+int srv_run(const char *path, size_t nworkers)
+{
+    assert(path);
+
+    if(nworkers == 0u)
+        nworkers = (msc_cpu() > SRV_MIN_WORKERS) ? msc_cpu() : SRV_MIN_WORKERS;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if(strlen(path) >= sizeof(addr.sun_path))
+    {
+        msc_err("Socket path too long.");
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* The graph clients start with */
+    if(_srv_get(REG_DEF_NAME) == NULL)
+    {
+        msc_err("Critical memory error. Closing...");
+        return -1;
+    }
+
+    /* Old socket (only a socket) */
+    struct stat st;
+    if(lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    int lsn = -1;
+    if((lsn = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+       bind(lsn, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+       listen(lsn, (int) SRV_MAX_CLIENTS) != 0)
+    {
+        char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Could not listen on %s (%s).", path, strerror(errno));
+        msc_err(buf);
+
+        if(lsn >= 0)
+            close(lsn);
+        return -1;
+    }
+
+    if(pipe(g_wake) != 0)
+    {
+        msc_err("Could not create a pipe.");
+        close(lsn);
+        unlink(path);
+        return -1;
+    }
+    fcntl(g_wake[0u], F_SETFL, O_NONBLOCK);
+    fcntl(g_wake[1u], F_SETFL, O_NONBLOCK);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = _srv_sig;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    /* Workers (signals go to the main thread only) */
+    pthread_t *worker = NULL;
+    size_t nstarted = 0u;
+    sigset_t set, old;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+
+    if((worker = (pthread_t *) malloc(sizeof(pthread_t) * nworkers)) != NULL)
+    {
+        for(; nstarted < nworkers; ++nstarted)
+        {
+            if(pthread_create(&worker[nstarted], NULL, _srv_wrk, NULL) != 0)
+                break;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    int ret = 0;
+    if(nstarted == 0u)
+    {
+        msc_err("Could not start worker threads.");
+        g_sig = 1;
+        ret = -1;
+    }
+    else
+    {
+        char buf[GLO_MAX_MSG_OUTPUT] = {0, };
+        snprintf(buf, GLO_MAX_MSG_OUTPUT - 1u, "Listening on %s (%zu workers). Ctrl-C stops.", path, nstarted);
+        msc_inf(buf);
+        fflush(stdout);
+    }
+
+    /* Idle connections, the others are with workers */
+    srv_conn_t *idle[SRV_MAX_CLIENTS];
+    struct pollfd pfd[2u + SRV_MAX_CLIENTS];
+    size_t nidle = 0u, nconn = 0u;
+
+    while(! g_sig)
+    {
+        pfd[0u].fd = lsn;
+        pfd[0u].events = POLLIN;
+        pfd[1u].fd = g_wake[0u];
+        pfd[1u].events = POLLIN;
+
+        for(size_t i = 0u; i < nidle; ++i)
+        {
+            pfd[2u + i].fd = idle[i]->_fd;
+            pfd[2u + i].events = POLLIN;
+        }
+
+        const size_t npfd = 2u + nidle;
+        if(poll(pfd, npfd, -1) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            msc_err("Could not wait for clients.");
+            ret = -1;
+            break;
+        }
+
+        /* Given back by workers */
+        if(pfd[1u].revents & POLLIN)
+        {
+            char drain[64];
+            while(read(g_wake[0u], drain, sizeof(drain)) > 0)
+                ;
+
+            pthread_mutex_lock(&g_conn_lock);
+            srv_conn_t *done = g_done;
+            g_done = NULL;
+            pthread_mutex_unlock(&g_conn_lock);
+
+            while(done)
+            {
+                srv_conn_t *next = done->_next;
+                if(done->_fd < 0)
+                {
+                    free(done);
+                    --nconn;
+                }
+                else
+                    idle[nidle++] = done;
+
+                done = next;
+            }
+        }
+
+        /* Clients with data go to workers */
+        size_t keep = 0u;
+        for(size_t i = 0u; i < npfd - 2u; ++i)
+        {
+            srv_conn_t *conn = idle[i];
+
+            if(pfd[2u + i].revents == 0)
+            {
+                idle[keep++] = conn;
+                continue;
+            }
+
+            conn->_next = NULL;
+            pthread_mutex_lock(&g_conn_lock);
+            if(g_todo_last)
+                g_todo_last->_next = conn;
+            else
+                g_todo = conn;
+            g_todo_last = conn;
+            pthread_cond_signal(&g_conn_cond);
+            pthread_mutex_unlock(&g_conn_lock);
+        }
+
+        /* Given back just now (not polled yet) */
+        for(size_t i = npfd - 2u; i < nidle; ++i)
+            idle[keep++] = idle[i];
+        nidle = keep;
+
+        /* New client */
+        if(pfd[0u].revents & POLLIN)
+        {
+            const int fd = accept(lsn, NULL, NULL);
+            srv_conn_t *conn = NULL;
+
+            if(fd < 0)
+                continue;
+
+            if(nconn >= SRV_MAX_CLIENTS || (conn = (srv_conn_t *) malloc(sizeof(srv_conn_t))) == NULL)
+            {
+                static const char busy[] = "E: Too many clients.\n.\n";
+                (void) _srv_snd(fd, busy, sizeof(busy) - 1u);
+                close(fd);
+                continue;
+            }
+
+            conn->_fd = fd;
+            conn->_nin = 0u;
+            conn->_skip = 0;
+            conn->_next = NULL;
+            pthread_mutex_lock(&g_lock);
+            conn->_graph = &g_graphs[0u];
+            pthread_mutex_unlock(&g_lock);
+
+            idle[nidle++] = conn;
+            ++nconn;
+        }
+    }
+
+    /* Stopping */
+    pthread_mutex_lock(&g_conn_lock);
+    g_stop = 1;
+    pthread_cond_broadcast(&g_conn_cond);
+    pthread_mutex_unlock(&g_conn_lock);
+
+    for(size_t i = 0u; i < nstarted; ++i)
+        pthread_join(worker[i], NULL);
+    free(worker);
+
+    /* Not served */
+    while(g_todo)
+    {
+        srv_conn_t *next = g_todo->_next;
+        close(g_todo->_fd);
+        free(g_todo);
+        g_todo = next;
+    }
+    while(g_done)
+    {
+        srv_conn_t *next = g_done->_next;
+        if(g_done->_fd >= 0)
+            close(g_done->_fd);
+        free(g_done);
+        g_done = next;
+    }
+    for(size_t i = 0u; i < nidle; ++i)
+    {
+        close(idle[i]->_fd);
+        free(idle[i]);
+    }
+
+    close(lsn);
+    unlink(path);
+    close(g_wake[0u]);
+    close(g_wake[1u]);
+
+    /* Graphs */
+    for(size_t i = 0u; i < g_ngraphs; ++i)
+    {
+        _srv_rel(g_graphs[i]._cur);
+        pthread_mutex_destroy(&g_graphs[i]._edit);
+    }
+    g_ngraphs = 0u;
+    reg_clr();
+
+    if(ret == 0)
+        msc_inf("Server stopped.");
+
+    return ret;
+}
+
+#endif /* _WIN32 */
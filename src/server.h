@@ -0,0 +1,59 @@
+/*
+ *  server.h
+ *
+ *  Daemon mode: the interpreter served on a Unix
+ *  domain socket (graph.out -s <path>). Graphs are
+ *  kept in memory by name (see "registry.h"), so
+ *  clients do not pay for loading them again. Many clients are served at
+ *  once by a pool of worker threads.
+ *
+ *  Clients send commands one per line, any number of
+ *  them at once (pipelined). Each non-empty line gets
+ *  its own response: the output of the command ("E: "
+ *  lines for errors) followed by a line with just ".".
+ *
+ *  Commands are the ones of the interpreter (add,
+ *  arch, del, set, size, new, gen and the read-only
+ *  ones, see "query.h"), no confirmation is asked.
+ *  Besides:
+ *
+ *      use <name>      - switches to the graph (made empty if new)
+ *      clone <name>    - registers a clone of the graph in use
+ *      graphs          - lists the graphs
+ *      exit            - closes the connection
+ *
+ *  Published graphs are never changed: edits are
+ *  applied on a copy which then replaces the graph
+ *  (see "edit.h"), so queries run with no locking.
+ *  Edits sent one after another are applied at once.
+ *
+ *  By Aleksander Slepowronski.
+ */
+
+#ifndef _GRAPH_SERVER_H_FILE_
+#define _GRAPH_SERVER_H_FILE_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "graph.h"
+
+#define SRV_MAX_LINE            4096u   /* Max. length of a command line */
+#define SRV_MAX_CLIENTS         256u    /* Max. # of connected clients */
+#define SRV_MIN_WORKERS         4u      /* Min. # of worker threads */
+
+
+/* Serves clients till SIGINT or SIGTERM.
+ *
+ *  path        - socket path (an old socket there is removed)
+ *  nworkers    - # of worker threads, 0 - default
+ *
+ * Returns 0 or -1 if failed.
+ */
+int             srv_run(const char *path, size_t nworkers);
+
+#endif /* _GRAPH_SERVER_H_FILE_ */